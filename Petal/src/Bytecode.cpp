@@ -0,0 +1,253 @@
+﻿//  ------------------------------------------------------------------------------
+//
+//  Petal
+//     Copyright 2023 Matthew Rogers
+//
+//     Licensed under the Apache License, Version 2.0 (the "License");
+//     you may not use this file except in compliance with the License.
+//     You may obtain a copy of the License at
+//
+//         http://www.apache.org/licenses/LICENSE-2.0
+//
+//     Unless required by applicable law or agreed to in writing, software
+//     distributed under the License is distributed on an "AS IS" BASIS,
+//     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//     See the License for the specific language governing permissions and
+//     limitations under the License.
+//
+//  File Name: Bytecode.cpp
+//  Date File Created: 10/17/2026
+//  Author: Matt
+//
+//  ------------------------------------------------------------------------------
+
+#include "Bytecode.h"
+#include "Operations.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cassert>
+#include <iomanip>
+#include <limits>
+
+namespace ptl
+{
+namespace
+{
+
+constexpr std::array<opcode_info, opcode_count> opcode_infos{ [] {
+    using enum operand_kind;
+
+    std::array<opcode_info, opcode_count> ret{};
+
+    const auto set = [&](opcode op, std::string_view name, operand_kind a, operand_kind b, operand_kind c) {
+        ret[(u32) op] = { name, a, b, c };
+    };
+
+    set(opcode::move, "move", reg, reg, none);
+    set(opcode::load_number, "load_number", reg, constant, none);
+    set(opcode::load_string, "load_string", reg, constant, none);
+    set(opcode::load_function, "load_function", reg, constant, none);
+    set(opcode::load_global, "load_global", reg, constant, none);
+    set(opcode::store_global, "store_global", reg, constant, none);
+
+    set(opcode::add, "add", reg, reg, reg);
+    set(opcode::sub, "sub", reg, reg, reg);
+    set(opcode::mul, "mul", reg, reg, reg);
+    set(opcode::div, "div", reg, reg, reg);
+    set(opcode::idiv, "idiv", reg, reg, reg);
+    set(opcode::mod, "mod", reg, reg, reg);
+    set(opcode::band, "band", reg, reg, reg);
+    set(opcode::bor, "bor", reg, reg, reg);
+    set(opcode::bxor, "bxor", reg, reg, reg);
+    set(opcode::bsl, "bsl", reg, reg, reg);
+    set(opcode::bsr, "bsr", reg, reg, reg);
+    set(opcode::eq, "eq", reg, reg, reg);
+    set(opcode::ne, "ne", reg, reg, reg);
+    set(opcode::lt, "lt", reg, reg, reg);
+    set(opcode::gt, "gt", reg, reg, reg);
+    set(opcode::le, "le", reg, reg, reg);
+    set(opcode::ge, "ge", reg, reg, reg);
+
+    set(opcode::neg, "neg", reg, reg, none);
+    set(opcode::bnot, "bnot", reg, reg, none);
+    set(opcode::lnot, "lnot", reg, reg, none);
+    set(opcode::truth, "truth", reg, reg, none);
+    set(opcode::inc, "inc", reg, none, none);
+    set(opcode::dec, "dec", reg, none, none);
+
+    set(opcode::concat, "concat", reg, reg, reg);
+    set(opcode::to_string, "to_string", reg, reg, none);
+    set(opcode::eq_str, "eq_str", reg, reg, reg);
+    set(opcode::ne_str, "ne_str", reg, reg, reg);
+    set(opcode::lt_str, "lt_str", reg, reg, reg);
+    set(opcode::gt_str, "gt_str", reg, reg, reg);
+    set(opcode::le_str, "le_str", reg, reg, reg);
+    set(opcode::ge_str, "ge_str", reg, reg, reg);
+
+    set(opcode::new_array, "new_array", reg, reg, count);
+    set(opcode::array_get, "array_get", reg, reg, reg);
+    set(opcode::array_set, "array_set", reg, reg, reg);
+    set(opcode::array_size, "array_size", reg, reg, none);
+
+    set(opcode::jump, "jump", none, offset, none);
+    set(opcode::jump_if, "jump_if", reg, offset, none);
+    set(opcode::jump_if_not, "jump_if_not", reg, offset, none);
+    set(opcode::call, "call", reg, reg, count);
+    set(opcode::ret, "ret", reg, none, none);
+    set(opcode::ret_void, "ret_void", none, none, none);
+    set(opcode::compile_lazy, "compile_lazy", constant, none, none);
+
+    return ret;
+}() };
+
+static_assert(opcode_infos[(u32) opcode::ret_void].name == "ret_void");
+
+} // anonymous namespace
+
+const opcode_info& get_opcode_info(opcode op)
+{
+    return opcode_infos[(u32) op];
+}
+
+code_builder::code_builder(function_code& code) :
+    m_code{ code }, m_storage{ *(code.storage = create_scope<code_storage>()) }
+{}
+
+u32 code_builder::emit(opcode op, i16 a, i16 b, i16 c)
+{
+    m_storage.code.push_back({ op, a, b, c });
+    m_storage.lines.push_back(m_line);
+    update_views();
+    return (u32) m_storage.code.size() - 1;
+}
+
+u32 code_builder::emit_jump(opcode op, i16 condition)
+{
+    return emit(op, condition);
+}
+
+void code_builder::patch_jump(u32 jump, u32 target)
+{
+    m_storage.code[jump].set_offset((i32) target - (i32) (jump + 1));
+}
+
+void code_builder::emit_jump_to(opcode op, u32 target, i16 condition)
+{
+    patch_jump(emit_jump(op, condition), target);
+}
+
+i16 code_builder::number_constant(f64 value)
+{
+    // Keyed by the bits so 0 and -0 stay apart and NaN finds itself
+    const u64 key{ std::bit_cast<u64>(value) };
+    if (m_storage.numbers.size() == max_constants && !m_number_constants.contains(key))
+    {
+        m_too_many_constants = true;
+        return 0;
+    }
+
+    const auto [it, inserted]{ m_number_constants.try_emplace(key, (i16) (u16) m_storage.numbers.size()) };
+    if (inserted)
+    {
+        m_storage.numbers.push_back(value);
+        update_views();
+    }
+    return it->second;
+}
+
+i16 code_builder::string_constant(std::string_view value)
+{
+    if (m_storage.strings.size() == max_constants && !m_string_constants.contains(std::string{ value }))
+    {
+        m_too_many_constants = true;
+        return 0;
+    }
+
+    const auto [it, inserted]{ m_string_constants.try_emplace(std::string{ value }, (i16) (u16) m_storage.strings.size()) };
+    if (inserted)
+    {
+        m_storage.strings.push_back({ (u32) m_storage.string_pool.size(), (u32) value.size() });
+        m_storage.string_pool += value;
+        update_views();
+    }
+    return it->second;
+}
+
+i16 code_builder::allocate_temp()
+{
+    assert(m_next_temp < std::numeric_limits<i16>::max());
+    const i16 ret{ m_next_temp++ };
+    m_max_temp = std::max(m_max_temp, m_next_temp);
+    return ret;
+}
+
+void code_builder::finish(u32 local_count)
+{
+    assert(local_count <= (u32) max_locals);
+
+    // Temporaries start at max_locals + 1 while compiling, move them right above the locals (and the return slot)
+    const i16  shift{ (i16) (max_locals - (i16) local_count) };
+    const auto relocate = [&](operand_kind kind, i16& operand) {
+        if (kind == operand_kind::reg && is_temp(operand))
+            operand -= shift;
+    };
+
+    for (instruction& inst : m_storage.code)
+    {
+        const opcode_info& info{ get_opcode_info(inst.op) };
+        relocate(info.a, inst.a);
+        relocate(info.b, inst.b);
+        relocate(info.c, inst.c);
+    }
+
+    m_code.frame_size = (u32) (m_max_temp - shift);
+}
+
+void code_builder::update_views()
+{
+    m_code.code        = m_storage.code;
+    m_code.lines       = m_storage.lines;
+    m_code.numbers     = m_storage.numbers;
+    m_code.strings     = m_storage.strings;
+    m_code.string_pool = m_storage.string_pool;
+}
+
+void disassemble(const function_code& code, std::ostream& os)
+{
+    os << (code.name.empty() ? "<top level>" : code.name) << ": " << code.param_count << " params, " << code.frame_size
+       << " registers" << std::endl;
+
+    for (u32 pc{ 0 }; pc < code.code.size(); ++pc)
+    {
+        const instruction& inst{ code.code[pc] };
+        const opcode_info& info{ get_opcode_info(inst.op) };
+
+        os << std::setw(6) << pc << "  " << std::left << std::setw(14) << info.name << std::right;
+
+        const auto operand = [&](operand_kind kind, i16 value) {
+            switch (kind)
+            {
+            case operand_kind::none: break;
+            case operand_kind::reg: os << " r" << value; break;
+            case operand_kind::constant: os << " #" << value; break;
+            case operand_kind::offset: os << " -> " << (i32) pc + 1 + inst.offset(); break;
+            case operand_kind::count: os << " " << value; break;
+            }
+        };
+        operand(info.a, inst.a);
+        operand(info.b, inst.b);
+        if (info.b != operand_kind::offset)
+            operand(info.c, inst.c);
+
+        if (inst.op == opcode::load_number)
+            os << "  ; " << ops::to_string(code.numbers[(u16) inst.b]);
+        else if (inst.op == opcode::load_string)
+            os << "  ; \"" << code.string((u16) inst.b) << '"';
+
+        os << std::endl;
+    }
+}
+
+} // namespace ptl
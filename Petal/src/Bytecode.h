@@ -0,0 +1,248 @@
+﻿//  ------------------------------------------------------------------------------
+//
+//  Petal
+//     Copyright 2023 Matthew Rogers
+//
+//     Licensed under the Apache License, Version 2.0 (the "License");
+//     you may not use this file except in compliance with the License.
+//     You may obtain a copy of the License at
+//
+//         http://www.apache.org/licenses/LICENSE-2.0
+//
+//     Unless required by applicable law or agreed to in writing, software
+//     distributed under the License is distributed on an "AS IS" BASIS,
+//     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//     See the License for the specific language governing permissions and
+//     limitations under the License.
+//
+//  File Name: Bytecode.h
+//  Date File Created: 10/17/2026
+//  Author: Matt
+//
+//  ------------------------------------------------------------------------------
+
+#pragma once
+
+#include "Common.h"
+
+#include <ostream>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace ptl
+{
+
+// Register machine code. Every instruction names up to three operands a, b and c. Registers are frame relative:
+// parameters are at -1, -2, ... (identifier_info::index of a param), 0 holds the return value, locals follow from 1
+// (identifier_info::index of a local) and temporaries come after the locals. Every instruction works on one static
+// type, the compiler picks the variant, so nothing is type checked while running
+enum struct opcode : u8
+{
+    move,          // R(a) = R(b)
+    load_number,   // R(a) = numbers[b]
+    load_string,   // R(a) = strings[b]
+    load_function, // R(a) = function b of the program
+    load_global,   // R(a) = globals[b]
+    store_global,  // globals[b] = R(a)
+
+    add, // R(a) = R(b) + R(c), same shape for every number operator down to ge
+    sub,
+    mul,
+    div,
+    idiv,
+    mod,
+    band,
+    bor,
+    bxor,
+    bsl,
+    bsr,
+    eq,
+    ne,
+    lt,
+    gt,
+    le,
+    ge,
+
+    neg,   // R(a) = -R(b)
+    bnot,  // R(a) = ~R(b)
+    lnot,  // R(a) = !R(b)
+    truth, // R(a) = R(b) != 0
+    inc,   // ++R(a)
+    dec,   // --R(a)
+
+    concat,    // R(a) = R(b) .. R(c)
+    to_string, // R(a) = string of the number R(b)
+    eq_str,    // R(a) = R(b) == R(c), same shape down to ge_str
+    ne_str,
+    lt_str,
+    gt_str,
+    le_str,
+    ge_str,
+
+    new_array,  // R(a) = array of R(b) elements, filled as array_fill c says
+    array_get,  // R(a) = R(b)[R(c)]
+    array_set,  // R(a)[R(b)] = R(c)
+    array_size, // R(a) = size of R(b)
+
+    jump,        // pc += bc
+    jump_if,     // if R(a): pc += bc
+    jump_if_not, // if !R(a): pc += bc
+    call,        // calls R(a) with c arguments, the first in R(b + c - 1) down to the last in R(b) so they line up with
+                 // the callee's -1, -2, ... The callee's frame starts at R(b + c), which receives the result
+    ret,         // returns R(a)
+    ret_void,    // returns nothing
+
+    compile_lazy, // stands in for the code of function a until it's compiled, see virtual_machine::set_lazy_compiler
+};
+
+inline constexpr u32 opcode_count{ (u32) opcode::compile_lazy + 1 };
+
+enum struct operand_kind : u8
+{
+    none,
+    reg,
+    constant, // index into the function's numbers or strings, or a function or global index
+    offset,   // jump distance, b and c together
+    count,    // argument count or array_fill
+};
+
+struct opcode_info
+{
+    std::string_view name{};
+    operand_kind     a{};
+    operand_kind     b{};
+    operand_kind     c{};
+};
+
+const opcode_info& get_opcode_info(opcode op);
+
+enum struct array_fill : u8
+{
+    number, // 0
+    string, // ""
+    none,   // for arrays of arrays and functions, every element has to be set before use
+};
+
+struct instruction
+{
+    opcode op{};
+    i16    a{};
+    i16    b{};
+    i16    c{};
+
+    // Jump distance relative to the next instruction, kept in b and c
+    [[nodiscard]] i32 offset() const { return (i32) ((u32) (u16) b | ((u32) (u16) c << 16)); }
+    void              set_offset(i32 offset)
+    {
+        b = (i16) (u16) ((u32) offset & 0xFFFF);
+        c = (i16) (u16) ((u32) offset >> 16);
+    }
+};
+
+static_assert(sizeof(instruction) == 8);
+
+// A string constant, a range of function_code::string_pool
+struct string_range
+{
+    u32 offset{};
+    u32 length{};
+};
+
+// The arrays of a function_code emitted by a code_builder
+struct code_storage
+{
+    std::vector<instruction>  code{};
+    std::vector<u32>          lines{};
+    std::vector<f64>          numbers{};
+    std::vector<string_range> strings{};
+    std::string               string_pool{};
+};
+
+// One compiled function, or the top level code of a script. The arrays are views, into storage or into the mapping of
+// the module_image the function was loaded from, so moving a function_code keeps them valid
+struct function_code
+{
+    std::string                   name{};
+    u32                           param_count{};
+    u32                           frame_size{}; // registers from 0 up
+    std::span<const instruction>  code{};
+    std::span<const u32>          lines{}; // source line of every instruction, for runtime errors
+    std::span<const f64>          numbers{};
+    std::span<const string_range> strings{};
+    std::string_view              string_pool{};
+    scope<code_storage>           storage{}; // null when the arrays are in a module image
+
+    [[nodiscard]] std::string_view string(u32 idx) const
+    {
+        return string_pool.substr(strings[idx].offset, strings[idx].length);
+    }
+};
+
+struct program
+{
+    std::vector<function_code> functions{};
+    u32                        global_count{};
+};
+
+// Emits one function_code. Temporaries are handed out in stack order from a range of their own and only moved
+// above the locals by finish(), so locals can keep being declared while the function is compiled
+class code_builder
+{
+public:
+    static constexpr i16 max_locals{ 0x3FFF };
+
+    // Constants of each pool and globals an operand can address, both are read as u16
+    static constexpr u32 max_constants{ 0x10000 };
+    static constexpr u32 max_globals{ 0x10000 };
+
+    // code gets storage of its own, its arrays are kept up to date as instructions and constants are added
+    explicit code_builder(function_code& code);
+
+    u32 emit(opcode op, i16 a = 0, i16 b = 0, i16 c = 0);
+
+    // Jumps, a forward one is emitted with emit_jump and pointed at its target later with patch_jump
+    u32  emit_jump(opcode op, i16 condition = 0);
+    void patch_jump(u32 jump, u32 target);
+    void emit_jump_to(opcode op, u32 target, i16 condition = 0);
+
+    [[nodiscard]] u32 here() const { return (u32) m_storage.code.size(); }
+
+    // Constant pool indices, equal constants share an entry. Past max_constants distinct ones the pool is full, 0 comes
+    // back and too_many_constants is set, the code must not be run then
+    i16 number_constant(f64 value);
+    i16 string_constant(std::string_view value);
+
+    [[nodiscard]] bool too_many_constants() const { return m_too_many_constants; }
+
+    i16               allocate_temp();
+    [[nodiscard]] i16 temp_mark() const { return m_next_temp; }
+    void              release_temps(i16 mark) { m_next_temp = mark; }
+
+    [[nodiscard]] static bool is_temp(i16 reg) { return reg > max_locals; }
+
+    // Line recorded for the instructions emitted from now on
+    void set_line(u32 line) { m_line = line; }
+
+    // Puts the temporaries right above local_count locals and sets the frame size
+    void finish(u32 local_count);
+
+private:
+    void update_views();
+
+    function_code&                       m_code;
+    code_storage&                        m_storage;
+    std::unordered_map<u64, i16>         m_number_constants{};
+    std::unordered_map<std::string, i16> m_string_constants{};
+    i16                                  m_next_temp{ max_locals + 1 };
+    i16                                  m_max_temp{ max_locals + 1 };
+    u32                                  m_line{};
+    bool                                 m_too_many_constants{};
+};
+
+// One instruction per line, with the constants it uses
+void disassemble(const function_code& code, std::ostream& os);
+
+} // namespace ptl
@@ -0,0 +1,557 @@
+﻿//  ------------------------------------------------------------------------------
+//
+//  Petal
+//     Copyright 2023 Matthew Rogers
+//
+//     Licensed under the Apache License, Version 2.0 (the "License");
+//     you may not use this file except in compliance with the License.
+//     You may obtain a copy of the License at
+//
+//         http://www.apache.org/licenses/LICENSE-2.0
+//
+//     Unless required by applicable law or agreed to in writing, software
+//     distributed under the License is distributed on an "AS IS" BASIS,
+//     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//     See the License for the specific language governing permissions and
+//     limitations under the License.
+//
+//  File Name: Compiler.cpp
+//  Date File Created: 10/17/2026
+//  Author: Matt
+//
+//  ------------------------------------------------------------------------------
+
+#include "Compiler.h"
+#include "Debug/Errors.h"
+
+#include <string>
+#include <vector>
+
+namespace ptl
+{
+namespace
+{
+
+bool is_string(type_handle type)
+{
+    return type == type_registry::string_handle();
+}
+
+opcode number_opcode(node_operation operation)
+{
+    switch (operation)
+    {
+    case node_operation::add:
+    case node_operation::add_assign: return opcode::add;
+    case node_operation::sub:
+    case node_operation::sub_assign: return opcode::sub;
+    case node_operation::mul:
+    case node_operation::mul_assign: return opcode::mul;
+    case node_operation::div:
+    case node_operation::div_assign: return opcode::div;
+    case node_operation::idiv:
+    case node_operation::idiv_assign: return opcode::idiv;
+    case node_operation::mod:
+    case node_operation::mod_assign: return opcode::mod;
+    case node_operation::band:
+    case node_operation::band_assign: return opcode::band;
+    case node_operation::bor:
+    case node_operation::bor_assign: return opcode::bor;
+    case node_operation::bxor:
+    case node_operation::bxor_assign: return opcode::bxor;
+    case node_operation::bsl:
+    case node_operation::bsl_assign: return opcode::bsl;
+    case node_operation::bsr:
+    case node_operation::bsr_assign: return opcode::bsr;
+    case node_operation::eq: return opcode::eq;
+    case node_operation::ne: return opcode::ne;
+    case node_operation::lt: return opcode::lt;
+    case node_operation::gt: return opcode::gt;
+    case node_operation::le: return opcode::le;
+    case node_operation::ge: return opcode::ge;
+    default: return opcode::concat;
+    }
+}
+
+// The string variant of a comparison opcode
+opcode string_comparison(opcode op)
+{
+    return (opcode) ((u32) opcode::eq_str + ((u32) op - (u32) opcode::eq));
+}
+
+static_assert((u32) opcode::ge - (u32) opcode::eq == (u32) opcode::ge_str - (u32) opcode::eq_str);
+
+} // anonymous namespace
+
+i16 expression_compiler::compile(const node& n)
+{
+    if (n.is_identifier())
+    {
+        const identifier_info* info{ lookup(n) };
+        if (!info)
+            return m_code.allocate_temp();
+        if (!info->is_global)
+            return (i16) (i32) info->index;
+    }
+
+    // A by value copy needs no register of its own when it is only read
+    if (n.is_node_operation() && n.get_node_operation() == node_operation::param)
+        return compile(*n.children()[0]);
+
+    const i16 ret{ m_code.allocate_temp() };
+    compile_into(n, ret);
+    return ret;
+}
+
+void expression_compiler::compile_into(const node& n, i16 target)
+{
+    m_code.set_line(n.line_number());
+
+    std::visit(overloaded{ [&](const string_literal val) {
+                              m_code.emit(opcode::load_string, target,
+                                          m_code.string_constant(m_context.symbols().name(val.value)));
+                          },
+                           [&](const f64 val) { m_code.emit(opcode::load_number, target, m_code.number_constant(val)); },
+                           [&](const identifier) {
+                               if (const identifier_info * info{ lookup(n) }; info && info->is_global)
+                                   m_code.emit(opcode::load_global, target, (i16) info->index);
+                               else if (info)
+                                   move(target, (i16) (i32) info->index);
+                           },
+                           [&](const node_operation) { compile_operation(n, target); } },
+               n.value());
+}
+
+void expression_compiler::compile_discard(const node& n)
+{
+    const i16 mark{ m_code.temp_mark() };
+
+    if (n.is_node_operation())
+    {
+        switch (n.get_node_operation())
+        {
+        case node_operation::preinc:
+        case node_operation::predec:
+        case node_operation::postinc:
+        case node_operation::postdec: compile_inc_dec(n, discard); break;
+        case node_operation::assign:
+        case node_operation::add_assign:
+        case node_operation::sub_assign:
+        case node_operation::mul_assign:
+        case node_operation::div_assign:
+        case node_operation::idiv_assign:
+        case node_operation::mod_assign:
+        case node_operation::band_assign:
+        case node_operation::bor_assign:
+        case node_operation::bxor_assign:
+        case node_operation::bsl_assign:
+        case node_operation::bsr_assign:
+        case node_operation::concat_assign: compile_assignment(n, discard); break;
+        case node_operation::comma:
+            for (const node_ptr child : n.children())
+            {
+                compile_discard(*child);
+            }
+            break;
+        case node_operation::call: compile_call(n, discard); break;
+        default: compile_into(n, m_code.allocate_temp()); break;
+        }
+    } else if (n.is_identifier())
+    {
+        // A lone identifier does nothing, but it still has to be declared
+        (void) lookup(n);
+    }
+
+    m_code.release_temps(mark);
+}
+
+u32 expression_compiler::compile_jump(const node& n, bool when)
+{
+    const i16 mark{ m_code.temp_mark() };
+    const i16 condition{ compile_as(n, type_registry::number_handle()) };
+    m_code.release_temps(mark);
+
+    return m_code.emit_jump(when ? opcode::jump_if : opcode::jump_if_not, condition);
+}
+
+i16 expression_compiler::compile_as(const node& n, type_handle type)
+{
+    if (is_string(type) && !is_string(n.type_id()))
+    {
+        const i16 ret{ m_code.allocate_temp() };
+        compile_into_as(n, type, ret);
+        return ret;
+    }
+
+    return compile(n);
+}
+
+void expression_compiler::compile_into_as(const node& n, type_handle type, i16 target)
+{
+    if (is_string(type) && !is_string(n.type_id()))
+    {
+        const i16 mark{ m_code.temp_mark() };
+        const i16 number{ compile(n) };
+        m_code.emit(opcode::to_string, target, number);
+        m_code.release_temps(mark);
+        return;
+    }
+
+    compile_into(n, target);
+}
+
+void expression_compiler::compile_operation(const node& n, i16 target)
+{
+    const type_handle               number_handle{ type_registry::number_handle() };
+    const type_handle               string_handle{ type_registry::string_handle() };
+    const std::span<const node_ptr> children{ n.children() };
+    const i16                       mark{ m_code.temp_mark() };
+
+    switch (const node_operation operation{ n.get_node_operation() })
+    {
+    case node_operation::param: compile_into(*children[0], target); break;
+    case node_operation::preinc:
+    case node_operation::predec:
+    case node_operation::postinc:
+    case node_operation::postdec: compile_inc_dec(n, target); break;
+    case node_operation::positive: compile_into_as(*children[0], number_handle, target); break;
+    case node_operation::negative:
+    case node_operation::bnot:
+    case node_operation::lnot:
+    {
+        const opcode op{ operation == node_operation::negative ? opcode::neg
+                         : operation == node_operation::bnot   ? opcode::bnot
+                                                               : opcode::lnot };
+        m_code.emit(op, target, compile_as(*children[0], number_handle));
+        break;
+    }
+    case node_operation::add:
+    case node_operation::sub:
+    case node_operation::mul:
+    case node_operation::div:
+    case node_operation::idiv:
+    case node_operation::mod:
+    case node_operation::band:
+    case node_operation::bor:
+    case node_operation::bxor:
+    case node_operation::bsl:
+    case node_operation::bsr:
+    {
+        const i16 lhs{ compile_as(*children[0], number_handle) };
+        const i16 rhs{ compile_as(*children[1], number_handle) };
+        m_code.set_line(n.line_number());
+        m_code.emit(number_opcode(operation), target, lhs, rhs);
+        break;
+    }
+    case node_operation::eq:
+    case node_operation::ne:
+    case node_operation::lt:
+    case node_operation::gt:
+    case node_operation::le:
+    case node_operation::ge:
+    {
+        // Same rule as the type checker: numbers only when both sides are numbers, strings otherwise
+        const bool numbers{ children[0]->type_id() == number_handle && children[1]->type_id() == number_handle };
+        const type_handle type{ numbers ? number_handle : string_handle };
+        const i16         lhs{ compile_as(*children[0], type) };
+        const i16         rhs{ compile_as(*children[1], type) };
+        const opcode      op{ number_opcode(operation) };
+        m_code.set_line(n.line_number());
+        m_code.emit(numbers ? op : string_comparison(op), target, lhs, rhs);
+        break;
+    }
+    case node_operation::land:
+    case node_operation::lor: compile_logical(n, target); break;
+    case node_operation::concat:
+    {
+        const i16 lhs{ compile_as(*children[0], string_handle) };
+        const i16 rhs{ compile_as(*children[1], string_handle) };
+        m_code.set_line(n.line_number());
+        m_code.emit(opcode::concat, target, lhs, rhs);
+        break;
+    }
+    case node_operation::assign:
+    case node_operation::add_assign:
+    case node_operation::sub_assign:
+    case node_operation::mul_assign:
+    case node_operation::div_assign:
+    case node_operation::idiv_assign:
+    case node_operation::mod_assign:
+    case node_operation::band_assign:
+    case node_operation::bor_assign:
+    case node_operation::bxor_assign:
+    case node_operation::bsl_assign:
+    case node_operation::bsr_assign:
+    case node_operation::concat_assign: compile_assignment(n, target); break;
+    case node_operation::comma:
+        for (size_t i{ 0 }; i + 1 < children.size(); ++i)
+        {
+            compile_discard(*children[i]);
+        }
+        compile_into(*children.back(), target);
+        break;
+    case node_operation::index:
+    {
+        const i16 array{ compile(*children[0]) };
+        const i16 index{ compile_as(*children[1], number_handle) };
+        m_code.set_line(n.line_number());
+        m_code.emit(opcode::array_get, target, array, index);
+        break;
+    }
+    case node_operation::ternary: compile_ternary(n, target); break;
+    case node_operation::call: compile_call(n, target); break;
+    }
+
+    m_code.release_temps(mark);
+}
+
+void expression_compiler::compile_inc_dec(const node& n, i16 target)
+{
+    const node_operation operation{ n.get_node_operation() };
+    const bool           post{ operation == node_operation::postinc || operation == node_operation::postdec };
+    const opcode         op{ operation == node_operation::preinc || operation == node_operation::postinc ? opcode::inc
+                                                                                                        : opcode::dec };
+
+    const lvalue_ref ref{ compile_lvalue(*n.children()[0]) };
+    const i16        value{ load(ref) };
+
+    if (post && target != discard)
+        move(target, value);
+
+    m_code.set_line(n.line_number());
+    m_code.emit(op, value);
+    store(ref, value);
+
+    if (!post && target != discard)
+        move(target, value);
+}
+
+void expression_compiler::compile_assignment(const node& n, i16 target)
+{
+    const std::span<const node_ptr> children{ n.children() };
+    const node_operation            operation{ n.get_node_operation() };
+    const type_handle               type{ children[0]->type_id() };
+
+    const lvalue_ref ref{ compile_lvalue(*children[0]) };
+
+    i16 value{};
+    if (operation == node_operation::assign)
+    {
+        if (ref.where == lvalue_ref::kind::local)
+        {
+            compile_into_as(*children[1], type, ref.reg);
+            value = ref.reg;
+        } else
+        {
+            value = compile_as(*children[1], type);
+        }
+    } else
+    {
+        const bool concat{ operation == node_operation::concat_assign };
+        const i16  current{ load(ref) };
+        const i16  rhs{ compile_as(*children[1], concat ? type_registry::string_handle() : type_registry::number_handle()) };
+
+        m_code.set_line(n.line_number());
+        m_code.emit(concat ? opcode::concat : number_opcode(operation), current, current, rhs);
+        value = current;
+    }
+
+    store(ref, value);
+    if (target != discard)
+        move(target, value);
+}
+
+void expression_compiler::compile_logical(const node& n, i16 target)
+{
+    const bool                      is_and{ n.get_node_operation() == node_operation::land };
+    const std::span<const node_ptr> children{ n.children() };
+
+    // The left operand is parked in a temporary, target may be a local the right operand still reads
+    const i16 value{ code_builder::is_temp(target) ? target : m_code.allocate_temp() };
+
+    compile_into_as(*children[0], type_registry::number_handle(), value);
+    const u32 short_circuit{ m_code.emit_jump(is_and ? opcode::jump_if_not : opcode::jump_if, value) };
+    compile_into_as(*children[1], type_registry::number_handle(), value);
+    m_code.patch_jump(short_circuit, m_code.here());
+
+    m_code.set_line(n.line_number());
+    m_code.emit(opcode::truth, target, value);
+}
+
+void expression_compiler::compile_ternary(const node& n, i16 target)
+{
+    const std::span<const node_ptr> children{ n.children() };
+
+    const u32 to_else{ compile_jump(*children[0], false) };
+    compile_into_as(*children[1], n.type_id(), target);
+    const u32 to_end{ m_code.emit_jump(opcode::jump) };
+
+    m_code.patch_jump(to_else, m_code.here());
+    compile_into_as(*children[2], n.type_id(), target);
+    m_code.patch_jump(to_end, m_code.here());
+}
+
+void expression_compiler::compile_call(const node& n, i16 target)
+{
+    const std::span<const node_ptr> children{ n.children() };
+    const function_type*            ft{ m_context.types().get_if<function_type>(children[0]->type_id()) };
+    if (!ft)
+    {
+        m_context.diagnostics().report(error::semantic("Expression is not callable", n.line_number(), n.char_index()));
+        return;
+    }
+
+    const i16 callee{ compile(*children[0]) };
+    const i16 argc{ (i16) (children.size() - 1) };
+
+    // By reference arguments are copied in and written back after the call, their places are worked out first
+    std::vector<std::pair<i16, lvalue_ref>> by_ref{};
+    for (i16 i{ 0 }; i < argc && i < (i16) ft->parameter_type_id.size(); ++i)
+    {
+        if (ft->parameter_type_id[i].by_ref)
+            by_ref.emplace_back(i, compile_lvalue(*children[i + 1]));
+    }
+
+    // The window is argc arguments and the callee's result slot, the temporaries are consecutive
+    const i16 window{ m_code.allocate_temp() };
+    for (i16 i{ 0 }; i < argc; ++i)
+    {
+        m_code.allocate_temp();
+    }
+
+    auto next_ref{ by_ref.begin() };
+    for (i16 i{ 0 }; i < argc; ++i)
+    {
+        const i16 slot{ (i16) (window + argc - 1 - i) };
+        const i16 mark{ m_code.temp_mark() };
+        if (next_ref != by_ref.end() && next_ref->first == i)
+        {
+            // Copied in from the place worked out above, evaluating the argument again would repeat its side effects
+            move(slot, load((next_ref++)->second));
+        }
+        else
+        {
+            const type_handle type{ i < (i16) ft->parameter_type_id.size() ? ft->parameter_type_id[i].type_id
+                                                                           : children[i + 1]->type_id() };
+            compile_into_as(*children[i + 1], type, slot);
+        }
+        m_code.release_temps(mark);
+    }
+
+    m_code.set_line(n.line_number());
+    m_code.emit(opcode::call, callee, window, argc);
+
+    for (const auto& [i, ref] : by_ref)
+    {
+        store(ref, (i16) (window + argc - 1 - i));
+    }
+
+    if (target != discard && ft->return_type_id != type_registry::void_handle())
+        move(target, (i16) (window + argc));
+}
+
+const identifier_info* expression_compiler::lookup(const node& n)
+{
+    const identifier_info* info{ m_context.find(n.get_identifier()) };
+    if (!info)
+    {
+        const std::string msg{ "Undeclared identifier '" + std::string{ m_context.symbols().name(n.get_identifier()) } + "'" };
+        m_context.diagnostics().report(error::semantic(msg.c_str(), n.line_number(), n.char_index()));
+    }
+
+    return info;
+}
+
+expression_compiler::lvalue_ref expression_compiler::compile_lvalue(const node& n)
+{
+    if (n.is_identifier())
+    {
+        const identifier_info* info{ lookup(n) };
+        if (!info)
+            return { lvalue_ref::kind::none };
+        if (info->is_global)
+            return { lvalue_ref::kind::global, 0, (i16) info->index };
+        return { lvalue_ref::kind::local, (i16) (i32) info->index, 0 };
+    }
+
+    if (n.is_node_operation() && n.get_node_operation() == node_operation::index)
+    {
+        const i16 array{ compile(*n.children()[0]) };
+        const i16 index{ compile_as(*n.children()[1], type_registry::number_handle()) };
+        return { lvalue_ref::kind::element, array, index };
+    }
+
+    if (n.is_node_operation() && n.get_node_operation() == node_operation::ternary)
+    {
+        // The condition is kept in its own temporary, a store through the other branch must not change which one is picked.
+        // Only the picked branch's place is worked out, so its side effects run once
+        const i16 condition{ m_code.allocate_temp() };
+        compile_into_as(*n.children()[0], type_registry::number_handle(), condition);
+
+        lvalue_ref ret{ lvalue_ref::kind::ternary, condition, 0 };
+        const u32  to_else{ m_code.emit_jump(opcode::jump_if_not, condition) };
+        ret.branches.push_back(compile_lvalue(*n.children()[1]));
+        const u32 to_end{ m_code.emit_jump(opcode::jump) };
+
+        m_code.patch_jump(to_else, m_code.here());
+        ret.branches.push_back(compile_lvalue(*n.children()[2]));
+        m_code.patch_jump(to_end, m_code.here());
+        return ret;
+    }
+
+    m_context.diagnostics().report(error::semantic("Expression cannot be assigned to", n.line_number(), n.char_index()));
+    return { lvalue_ref::kind::none };
+}
+
+i16 expression_compiler::load(const lvalue_ref& ref)
+{
+    if (ref.where == lvalue_ref::kind::local)
+        return ref.reg;
+
+    const i16 ret{ m_code.allocate_temp() };
+    if (ref.where == lvalue_ref::kind::global)
+        m_code.emit(opcode::load_global, ret, ref.index);
+    else if (ref.where == lvalue_ref::kind::element)
+        m_code.emit(opcode::array_get, ret, ref.reg, ref.index);
+    else if (ref.where == lvalue_ref::kind::ternary)
+    {
+        const u32 to_else{ m_code.emit_jump(opcode::jump_if_not, ref.reg) };
+        move(ret, load(ref.branches[0]));
+        const u32 to_end{ m_code.emit_jump(opcode::jump) };
+
+        m_code.patch_jump(to_else, m_code.here());
+        move(ret, load(ref.branches[1]));
+        m_code.patch_jump(to_end, m_code.here());
+    }
+    return ret;
+}
+
+void expression_compiler::store(const lvalue_ref& ref, i16 value)
+{
+    switch (ref.where)
+    {
+    case lvalue_ref::kind::local: move(ref.reg, value); break;
+    case lvalue_ref::kind::global: m_code.emit(opcode::store_global, value, ref.index); break;
+    case lvalue_ref::kind::element: m_code.emit(opcode::array_set, ref.reg, ref.index, value); break;
+    case lvalue_ref::kind::ternary:
+    {
+        const u32 to_else{ m_code.emit_jump(opcode::jump_if_not, ref.reg) };
+        store(ref.branches[0], value);
+        const u32 to_end{ m_code.emit_jump(opcode::jump) };
+
+        m_code.patch_jump(to_else, m_code.here());
+        store(ref.branches[1], value);
+        m_code.patch_jump(to_end, m_code.here());
+        break;
+    }
+    case lvalue_ref::kind::none: break;
+    }
+}
+
+void expression_compiler::move(i16 target, i16 source)
+{
+    if (target != source && target != discard)
+        m_code.emit(opcode::move, target, source);
+}
+
+} // namespace ptl
@@ -0,0 +1,100 @@
+﻿//  ------------------------------------------------------------------------------
+//
+//  Petal
+//     Copyright 2023 Matthew Rogers
+//
+//     Licensed under the Apache License, Version 2.0 (the "License");
+//     you may not use this file except in compliance with the License.
+//     You may obtain a copy of the License at
+//
+//         http://www.apache.org/licenses/LICENSE-2.0
+//
+//     Unless required by applicable law or agreed to in writing, software
+//     distributed under the License is distributed on an "AS IS" BASIS,
+//     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//     See the License for the specific language governing permissions and
+//     limitations under the License.
+//
+//  File Name: Compiler.h
+//  Date File Created: 10/17/2026
+//  Author: Matt
+//
+//  ------------------------------------------------------------------------------
+
+#pragma once
+
+#include "Common.h"
+#include "Bytecode.h"
+#include "ExpressionTree.h"
+
+#include <limits>
+#include <vector>
+
+namespace ptl
+{
+
+// Lowers typed expression trees to register code. Locals and parameters are used in place through their
+// identifier_info::index, globals go through load_global and store_global. The static type of every node picks the
+// instruction, and the one implicit conversion (number to string) is emitted where the type checker allowed it.
+// Errors go to the context's diagnostics like the type checker's, the code emitted for a broken tree must not be run
+class expression_compiler
+{
+public:
+    expression_compiler(compiler_context& context, code_builder& code) : m_context{ context }, m_code{ code } {}
+
+    // Register holding n's value: a local's own register or a new temporary. Temporaries are handed back with
+    // code_builder::release_temps, the returned register must not be written to
+    i16 compile(const node& n);
+
+    // n's value written to target
+    void compile_into(const node& n, i16 target);
+
+    // n evaluated for its side effects only, e.g. an expression statement
+    void compile_discard(const node& n);
+
+    // Emits a jump that is taken when n's truth equals when, for code_builder::patch_jump
+    u32 compile_jump(const node& n, bool when);
+
+    // Like compile, converted to type where the type checker allowed it, e.g. a value returned from a function
+    i16 compile_as(const node& n, type_handle type);
+
+private:
+    // Where an assignable expression lives
+    struct lvalue_ref
+    {
+        enum struct kind : u8
+        {
+            local,
+            global,
+            element,
+            ternary,
+            none, // not assignable, already reported
+        };
+
+        kind                    where{};
+        i16                     reg{};      // the local, the array, or the register holding a ternary's condition
+        i16                     index{};    // the global's index, or the register holding the element index
+        std::vector<lvalue_ref> branches{}; // a ternary's two places, the condition picks one on every load and store
+    };
+
+    static constexpr i16 discard{ std::numeric_limits<i16>::min() };
+
+    void compile_into_as(const node& n, type_handle type, i16 target);
+    void compile_operation(const node& n, i16 target);
+    void compile_inc_dec(const node& n, i16 target);
+    void compile_assignment(const node& n, i16 target);
+    void compile_logical(const node& n, i16 target);
+    void compile_ternary(const node& n, i16 target);
+    void compile_call(const node& n, i16 target);
+
+    const identifier_info* lookup(const node& n);
+    lvalue_ref             compile_lvalue(const node& n);
+    i16                    load(const lvalue_ref& ref);
+    void                   store(const lvalue_ref& ref, i16 value);
+    void                   move(i16 target, i16 source);
+
+    compiler_context& m_context;
+    code_builder&     m_code;
+};
+
+} // namespace ptl
@@ -23,96 +23,99 @@
 
 #include "CompilerContext.h"
 
-#include <utility>
+#include <algorithm>
+#include <cassert>
 
 namespace ptl
 {
-const identifier_info* identifier_lookup::find(const std::string& name) const
-{
-    if (const auto it{ m_identifiers.find(name) }; it != m_identifiers.end())
-        return &it->second;
-    return nullptr;
-}
 
-
-const identifier_info* identifier_lookup::insert(std::string name, type_handle type_id, u32 index, bool is_global,
-                                                 bool is_constant)
+type_handle compiler_context::get_handle(const type_t& t)
 {
-    return &m_identifiers.emplace(std::move(name), identifier_info{ type_id, index, is_global, is_constant }).first->second;
+    return m_types->get_handle(t);
 }
 
-const identifier_info* global_identifier_lookup::create_identifier(std::string name, type_handle type_id, bool is_constant)
+bool compiler_context::declared_in_scope(symbol_id name) const
 {
-    return insert(std::move(name), type_id, size(), true, is_constant);
+    const u32 first_binding{ m_scopes.empty() ? 0 : m_scopes.back().first_binding };
+    const u32 existing{ name < m_innermost.size() ? m_innermost[name] : no_binding };
+    return existing != no_binding && existing >= first_binding;
 }
 
-const identifier_info* local_identifier_lookup::find(const std::string& name) const
+const identifier_info* compiler_context::create_identifier(symbol_id name, type_handle type_id, bool is_constant)
 {
-    if (const identifier_info * ret{ identifier_lookup::find(name) })
-        return ret;
-    return m_parent ? m_parent->find(name) : nullptr;
+    // Redeclaring a name in the same scope keeps the first declaration
+    if (declared_in_scope(name))
+        return &m_bindings[m_innermost[name]].info;
+
+    if (m_scopes.empty())
+        return bind(name, type_id, (i32) m_global_count++, true, is_constant);
+    return bind(name, type_id, m_scopes.back().next_local_index++, false, is_constant);
 }
 
-const identifier_info* local_identifier_lookup::create_identifier(std::string name, type_handle type_id, bool is_constant)
+const identifier_info* compiler_context::create_param(symbol_id name, type_handle type_id)
 {
-    return insert(std::move(name), type_id, m_next_identifier_index++, false, is_constant);
+    assert(!m_scopes.empty() && m_scopes.back().is_function);
+    return bind(name, type_id, m_scopes.back().next_param_index--, false, false);
 }
 
-const identifier_info* function_identifier_lookup::create_param(std::string name, type_handle type_id)
+void compiler_context::enter_scope()
 {
-    return insert(std::move(name), type_id, m_next_param_index++, false, false);
+    // Sibling scopes reuse the same local indices, a nested scope continues after its parent's locals
+    const i32 next_local_index{ m_scopes.empty() ? 1 : m_scopes.back().next_local_index };
+    m_scopes.push_back({ (u32) m_bindings.size(), next_local_index, -1, false });
 }
 
-type_handle compiler_context::get_handle(const type_t& t)
+void compiler_context::enter_function()
 {
-    return m_types.get_handle(t);
+    m_scopes.push_back({ (u32) m_bindings.size(), 1, -1, true });
 }
 
-const identifier_info* compiler_context::find(const std::string& name) const
+bool compiler_context::leave_scope()
 {
-    if (m_locals)
-    {
-        if (const identifier_info * ret{ m_locals->find(name) })
-            return ret;
-    }
+    if (m_scopes.empty())
+        return false;
 
-    return m_globals.find(name);
-}
+    const u32 first_binding{ m_scopes.back().first_binding };
+    m_scopes.pop_back();
 
-const identifier_info* compiler_context::create_identifier(std::string name, type_handle type_id, bool is_constant)
-{
-    if (m_locals)
-        return m_locals->create_identifier(std::move(name), type_id, is_constant);
-    return m_globals.create_identifier(std::move(name), type_id, is_constant);
-}
+    while (m_bindings.size() > first_binding)
+    {
+        const binding& b{ m_bindings.back() };
+        m_innermost[b.name] = b.shadowed;
+        m_bindings.pop_back();
+    }
 
-const identifier_info* compiler_context::create_param(std::string name, type_handle type_id) const
-{
-    return m_params->create_param(std::move(name), type_id);
+    return true;
 }
 
-void compiler_context::enter_scope()
+void compiler_context::move_symbols(std::span<const symbol_id> map, symbol_table& symbols)
 {
-    m_locals = create_scope<local_identifier_lookup>(std::move(m_locals));
-}
+    std::vector<u32> innermost(symbols.size(), no_binding);
+    for (symbol_id id{ 0 }; id < (symbol_id) m_innermost.size(); ++id)
+    {
+        if (m_innermost[id] != no_binding)
+            innermost[map[id]] = m_innermost[id];
+    }
+    for (binding& b : m_bindings)
+    {
+        b.name = map[b.name];
+    }
 
-void compiler_context::enter_function()
-{
-    scope params{ create_scope<function_identifier_lookup>() };
-    m_params = params.get();
-    m_locals = std::move(params);
+    m_innermost = std::move(innermost);
+    m_symbols   = &symbols;
+    m_own_symbols.reset();
 }
 
-bool compiler_context::leave_scope()
+const identifier_info* compiler_context::bind(symbol_id name, type_handle type_id, i32 index, bool is_global,
+                                              bool is_constant)
 {
-    if (!m_locals)
-        return false;
-
-    if (m_params == m_locals.get())
-        m_params = nullptr;
-    m_locals = m_locals->detach_parent();
+    if (name >= m_innermost.size())
+        m_innermost.resize(std::max<size_t>(m_symbols->size(), name + 1), no_binding);
 
-    return true;
+    const u32 ret{ (u32) m_bindings.size() };
+    m_bindings.push_back({ name, m_innermost[name], { type_id, (u32) index, is_global, is_constant } });
+    m_innermost[name] = ret;
+    return &m_bindings[ret].info;
 }
 
 } // namespace ptl
@@ -24,10 +24,13 @@
 #pragma once
 
 #include "Common.h"
+#include "SymbolTable.h"
+#include "Debug/Errors.h"
 #include "Types.h"
+#include "Util/Arena.h"
 
-#include <unordered_map>
-#include <string>
+#include <span>
+#include <vector>
 
 namespace ptl
 {
@@ -40,76 +43,97 @@ struct identifier_info
     bool        is_constant{};
 };
 
-class identifier_lookup
+class compiler_context
 {
 public:
-    virtual ~identifier_lookup() = default;
-    [[nodiscard]] virtual const identifier_info* find(const std::string& name) const;
-
-    virtual const identifier_info* create_identifier(std::string name, type_handle type_id, bool is_constant) = 0;
+    compiler_context() :
+        m_own_symbols{ create_scope<symbol_table>() }, m_symbols{ m_own_symbols.get() },
+        m_own_types{ create_scope<type_registry>() }, m_types{ m_own_types.get() }
+    {}
 
-protected:
-    const identifier_info*      insert(std::string name, type_handle type_id, u32 index, bool is_global, bool is_constant);
-    [[nodiscard]] constexpr u32 size() const { return (u32) m_identifiers.size(); }
+    // Shares types with other compilations, which may run on other threads
+    explicit compiler_context(type_registry& types) :
+        m_own_symbols{ create_scope<symbol_table>() }, m_symbols{ m_own_symbols.get() }, m_types{ &types }
+    {}
 
-private:
-    std::unordered_map<std::string, identifier_info> m_identifiers{};
-};
+    // Interns into symbols, which tokens lexed before were interned into. It must outlive the context
+    explicit compiler_context(symbol_table& symbols) :
+        m_symbols{ &symbols }, m_own_types{ create_scope<type_registry>() }, m_types{ m_own_types.get() }
+    {}
 
-class global_identifier_lookup final : public identifier_lookup
-{
-public:
-    const identifier_info* create_identifier(std::string name, type_handle type_id, bool is_constant) override;
-};
+    type_handle get_handle(const type_t& t);
 
-class local_identifier_lookup : public identifier_lookup
-{
-public:
-    local_identifier_lookup(scope<local_identifier_lookup> parent) :
-        m_parent{ std::move(parent) }, m_next_identifier_index{ m_parent ? m_parent->m_next_identifier_index : 1 }
-    {}
+    [[nodiscard]] type_registry&       types() { return *m_types; }
+    [[nodiscard]] const type_registry& types() const { return *m_types; }
 
-    [[nodiscard]] const identifier_info* find(const std::string& name) const override;
+    // Innermost binding of name. The returned pointers are only valid until the next declaration
+    [[nodiscard]] const identifier_info* find(symbol_id name) const
+    {
+        return name < m_innermost.size() && m_innermost[name] != no_binding ? &m_bindings[m_innermost[name]].info
+                                                                            : nullptr;
+    }
 
-    const identifier_info* create_identifier(std::string name, type_handle type_id, bool is_constant) override;
+    // Whether name is declared in the innermost scope itself, not just in one around it
+    [[nodiscard]] bool declared_in_scope(symbol_id name) const;
 
-    [[nodiscard]] scope<local_identifier_lookup> detach_parent() { return std::move(m_parent); }
+    // A global outside of any scope, a local otherwise. Declaring a name twice in one scope returns the first one
+    [[nodiscard]] const identifier_info* create_identifier(symbol_id name, type_handle type_id, bool is_constant);
 
-private:
-    scope<local_identifier_lookup> m_parent{};
-    i32                            m_next_identifier_index{};
-};
+    // Only valid in the outermost scope of a function
+    [[nodiscard]] const identifier_info* create_param(symbol_id name, type_handle type_id);
 
-class function_identifier_lookup final : public local_identifier_lookup
-{
-public:
-    function_identifier_lookup() : local_identifier_lookup{ nullptr }, m_next_param_index{ -1 } {}
-    const identifier_info* create_param(std::string name, type_handle type_id);
+    // Globals declared so far, their indices are 0 up to this
+    [[nodiscard]] u32 global_count() const { return m_global_count; }
 
-private:
-    i32 m_next_param_index{};
-};
+    [[nodiscard]] symbol_table&       symbols() { return *m_symbols; }
+    [[nodiscard]] const symbol_table& symbols() const { return *m_symbols; }
 
-class compiler_context
-{
-public:
-    compiler_context() = default;
+    // Moves the bindings over to symbols, map gives the id there of every id of the current table
+    void move_symbols(std::span<const symbol_id> map, symbol_table& symbols);
 
-    type_handle get_handle(const type_t& t);
+    // Every phase reports its errors here and carries on, see error::diagnostics
+    [[nodiscard]] error::diagnostics&       diagnostics() { return m_diagnostics; }
+    [[nodiscard]] const error::diagnostics& diagnostics() const { return m_diagnostics; }
 
-    [[nodiscard]] const identifier_info* find(const std::string& name) const;
-    [[nodiscard]] const identifier_info* create_identifier(std::string name, type_handle type_id, bool is_constant);
-    [[nodiscard]] const identifier_info* create_param(std::string name, type_handle type_id) const;
+    // Expression nodes of this compilation
+    [[nodiscard]] utl::arena& nodes() { return m_nodes; }
 
+    // Entering a scope only records where it starts, leaving it drops its bindings and uncovers what they shadowed
     void enter_scope();
     void enter_function();
     bool leave_scope();
 
 private:
-    function_identifier_lookup*    m_params{ nullptr };
-    global_identifier_lookup       m_globals{};
-    scope<local_identifier_lookup> m_locals{};
-    type_registry                  m_types{};
+    // Every live declaration, innermost last
+    struct binding
+    {
+        symbol_id       name{};
+        u32             shadowed{}; // binding of the same name this one hides, or no_binding
+        identifier_info info{};
+    };
+
+    struct scope_marker
+    {
+        u32  first_binding{};
+        i32  next_local_index{};
+        i32  next_param_index{};
+        bool is_function{};
+    };
+
+    static constexpr u32 no_binding{ ~0u };
+
+    const identifier_info* bind(symbol_id name, type_handle type_id, i32 index, bool is_global, bool is_constant);
+
+    scope<symbol_table>       m_own_symbols{};
+    symbol_table*             m_symbols{};
+    error::diagnostics        m_diagnostics{};
+    utl::arena                m_nodes{};
+    std::vector<binding>      m_bindings{};
+    std::vector<u32>          m_innermost{}; // by symbol_id, symbol ids are dense so no hashing is needed
+    std::vector<scope_marker> m_scopes{};
+    u32                       m_global_count{};
+    scope<type_registry>      m_own_types{};
+    type_registry*            m_types{};
 };
 
 } // namespace ptl
\ No newline at end of file
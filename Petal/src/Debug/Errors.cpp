@@ -23,6 +23,9 @@
 
 #include "Errors.h"
 
+#include <algorithm>
+#include <utility>
+
 namespace ptl::error
 {
 
@@ -41,40 +44,84 @@ error unexpected(const std::string_view& unexpected, u32 line_number, u32 char_i
     return parsing(err_msg.c_str(), line_number, char_index);
 }
 
-void format(const error& err, get_character src, std::ostream& output)
+error semantic(const char* msg, u32 line_number, u32 char_index)
+{
+    std::string err_msg{ "Semantic Error: " };
+    err_msg += msg;
+    return { std::move(err_msg), line_number, char_index };
+}
+
+error runtime(const char* msg, u32 line_number)
+{
+    std::string err_msg{ "Runtime Error: " };
+    err_msg += msg;
+    return { std::move(err_msg), line_number, 0 };
+}
+
+void format(const error& err, std::string_view src, const line_index& lines, std::ostream& output)
 {
     output << "(" << err.line_number() + 1 << ") " << err.what() << std::endl;
 
-    u32 char_idx{ 0 };
+    if (err.line_number() >= lines.line_count())
+        return;
+
+    const u32 idx_in_line{ err.char_index() - lines.line_start(err.line_number()) };
+
+    output << lines.line_text(src, err.line_number()) << std::endl;
 
-    for (u32 line_number{ 0 }; line_number < err.line_number(); ++char_idx)
+    for (u32 i{ 0 }; i < idx_in_line; ++i)
     {
-        const i32 c{ src() };
-        if (c < 0)
-            return;
-        if (c == '\n')
-            ++line_number;
+        output << " ";
     }
 
-    const u32 idx_in_line{ err.char_index() - char_idx };
+    output << "^" << std::endl;
+}
+
+void diagnostics::report(error err)
+{
+    if (m_muted)
+        return;
 
-    std::string line{};
-    for (u32 i{ 0 };; ++i)
+    if (m_count++ < m_max_errors)
+        m_errors.push_back(std::move(err));
+}
+
+void diagnostics::clear()
+{
+    m_errors.clear();
+    m_count = 0;
+    m_muted = false;
+}
+
+void diagnostics::format(std::string_view src, const line_index& lines, std::ostream& output) const
+{
+    // Lexer errors are reported as tokens are read ahead, so print in source order rather than report order
+    std::vector<const error*> sorted{};
+    sorted.reserve(m_errors.size());
+    for (const error& err : m_errors)
     {
-        const i32 c{ src() };
-        if (c < 0 || c == '\n' || c == '\r')
-            break;
-        line += (char) c;
+        sorted.push_back(&err);
     }
+    std::ranges::stable_sort(sorted, {}, [](const error* err) { return std::pair{ err->line_number(), err->char_index() }; });
 
-    output << line << std::endl;
+    for (const error* err : sorted)
+    {
+        ptl::error::format(*err, src, lines, output);
+    }
 
-    for (u32 i{ 0 }; i < idx_in_line; ++i)
+    if (m_count > m_errors.size())
+        output << m_count - m_errors.size() << " more errors" << std::endl;
+}
+
+void format(const error& err, get_character src, std::ostream& output)
+{
+    std::string text{};
+    for (i32 c{ src() }; c >= 0; c = src())
     {
-        output << " ";
+        text.push_back((char) c);
     }
 
-    output << "^" << std::endl;
+    format(err, text, line_index{ text }, output);
 }
 
 
@@ -24,10 +24,12 @@
 #pragma once
 
 #include "Common.h"
+#include "LineIndex.h"
 
 #include <exception>
 #include <string>
 #include <ostream>
+#include <vector>
 
 namespace ptl::error
 {
@@ -53,7 +55,44 @@ private:
 
 error parsing(const char* msg, u32 line_number, u32 char_index);
 error unexpected(const std::string_view& unexpected, u32 line_number, u32 char_index);
+error semantic(const char* msg, u32 line_number, u32 char_index);
+error runtime(const char* msg, u32 line_number);
 
+// Prints err with the offending line of src underneath and a caret at the offending character
+void format(const error& err, std::string_view src, const line_index& lines, std::ostream& output);
+
+// Collects the errors of one compilation instead of throwing them, so a single run reports every error in a script.
+// After max_errors further reports are only counted. While muted, reports are dropped, which keeps a parse error from
+// being followed by type errors about the placeholder the parser put in its place
+class diagnostics
+{
+public:
+    static constexpr u32 default_max_errors{ 100 };
+
+    explicit diagnostics(u32 max_errors = default_max_errors) : m_max_errors{ max_errors } {}
+
+    void report(error err);
+
+    void               set_muted(bool muted) { m_muted = muted; }
+    [[nodiscard]] bool muted() const { return m_muted; }
+
+    [[nodiscard]] bool                      has_errors() const { return m_count > 0; }
+    [[nodiscard]] u32                       error_count() const { return m_count; }
+    [[nodiscard]] const std::vector<error>& errors() const { return m_errors; }
+
+    void clear();
+
+    // Every kept error as format() prints it, followed by how many were left out
+    void format(std::string_view src, const line_index& lines, std::ostream& output) const;
+
+private:
+    std::vector<error> m_errors{};
+    u32                m_max_errors{};
+    u32                m_count{};
+    bool               m_muted{};
+};
+
+// Compatibility overload for callback input, reads all of src to build the line index
 void format(const error& err, get_character src, std::ostream& output);
 
 
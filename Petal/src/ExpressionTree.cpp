@@ -23,6 +23,9 @@
 
 #include "ExpressionTree.h"
 
+#include <algorithm>
+#include <string>
+
 namespace ptl
 {
 
@@ -32,23 +35,34 @@ bool is_convertable(type_handle type_from, bool lvalue_from, type_handle type_to
 {
     if (type_to == type_registry::void_handle())
         return true;
-    if (type_from == type_to)
-        return true;
     if (lvalue_to)
         return lvalue_from && type_from == type_to;
 
-    return type_from == type_registry::number_handle() && type_to == type_registry::string_handle();
+    return type_registry::is_convertible(type_from, type_to);
 }
 } // anonymous namespace
 
-node::node(compiler_context& context, node_v value, std::vector<node_ptr> children, u32 line_number, u32 char_index) :
-    m_value{ std::move(value) }, m_children{ std::move(children) }, m_line_number{ line_number }, m_char_index{ char_index }
+static_assert(std::is_trivially_destructible_v<node>, "nodes are freed with their arena");
+
+node_ptr node::create(compiler_context& context, node_v value, std::span<const node_ptr> children, u32 line_number,
+                      u32 char_index)
+{
+    utl::arena& nodes{ context.nodes() };
+    return nodes.create<node>(context, std::move(value), nodes.copy(children), line_number, char_index);
+}
+
+node::node(compiler_context& context, node_v value, std::span<const node_ptr> children, u32 line_number, u32 char_index) :
+    m_value{ std::move(value) }, m_children{ children }, m_line_number{ line_number }, m_char_index{ char_index }
 {
-    const type_handle void_handle{ type_registry::void_handle() };
-    const type_handle number_handle{ type_registry::number_handle() };
-    const type_handle string_handle{ type_registry::string_handle() };
+    // A node over an erroneous child has no meaningful type, conversions from it are not checked again
+    m_valid = std::ranges::all_of(m_children, [](node_ptr child) { return child->m_valid; });
+
+    const type_handle    void_handle{ type_registry::void_handle() };
+    const type_handle    number_handle{ type_registry::number_handle() };
+    const type_handle    string_handle{ type_registry::string_handle() };
+    const type_registry& types{ context.types() };
 
-    std::visit(overloaded{ [&]([[maybe_unused]] const std::string& val) {
+    std::visit(overloaded{ [&]([[maybe_unused]] const string_literal val) {
                               m_type_id = string_handle;
                               m_lvalue  = false;
                           },
@@ -63,7 +77,9 @@ node::node(compiler_context& context, node_v value, std::vector<node_ptr> childr
                                    m_lvalue  = !info->is_constant;
                                } else
                                {
-                                   // TODO: Undeclared error
+                                   const std::string msg{ "Undeclared identifier '" +
+                                                          std::string{ context.symbols().name(val.name) } + "'" };
+                                   report(context, msg.c_str());
                                }
                            },
                            [&](const node_operation val) {
@@ -77,13 +93,13 @@ node::node(compiler_context& context, node_v value, std::vector<node_ptr> childr
                                case node_operation::predec:
                                    m_type_id = number_handle;
                                    m_lvalue  = true;
-                                   m_children[0]->check_conversion(number_handle, true);
+                                   m_children[0]->check_conversion(context, number_handle, true);
                                    break;
                                case node_operation::postinc:
                                case node_operation::postdec:
                                    m_type_id = number_handle;
                                    m_lvalue  = false;
-                                   m_children[0]->check_conversion(number_handle, true);
+                                   m_children[0]->check_conversion(context, number_handle, true);
                                    break;
                                case node_operation::positive:
                                case node_operation::negative:
@@ -91,7 +107,7 @@ node::node(compiler_context& context, node_v value, std::vector<node_ptr> childr
                                case node_operation::lnot:
                                    m_type_id = number_handle;
                                    m_lvalue  = false;
-                                   m_children[0]->check_conversion(number_handle, false);
+                                   m_children[0]->check_conversion(context, number_handle, false);
                                    break;
                                case node_operation::add:
                                case node_operation::sub:
@@ -108,20 +124,20 @@ node::node(compiler_context& context, node_v value, std::vector<node_ptr> childr
                                case node_operation::lor:
                                    m_type_id = number_handle;
                                    m_lvalue  = false;
-                                   m_children[0]->check_conversion(number_handle, false);
-                                   m_children[1]->check_conversion(number_handle, false);
+                                   m_children[0]->check_conversion(context, number_handle, false);
+                                   m_children[1]->check_conversion(context, number_handle, false);
                                    break;
                                case node_operation::concat:
                                    m_type_id = context.get_handle(simple_type::string);
                                    m_lvalue  = false;
-                                   m_children[0]->check_conversion(string_handle, false);
-                                   m_children[1]->check_conversion(string_handle, false);
+                                   m_children[0]->check_conversion(context, string_handle, false);
+                                   m_children[1]->check_conversion(context, string_handle, false);
                                    break;
                                case node_operation::assign:
                                    m_type_id = m_children[0]->type_id();
                                    m_lvalue  = true;
-                                   m_children[0]->check_conversion(m_type_id, true);
-                                   m_children[1]->check_conversion(m_type_id, false);
+                                   m_children[0]->check_conversion(context, m_type_id, true);
+                                   m_children[1]->check_conversion(context, m_type_id, false);
                                    break;
                                case node_operation::add_assign:
                                case node_operation::sub_assign:
@@ -136,14 +152,14 @@ node::node(compiler_context& context, node_v value, std::vector<node_ptr> childr
                                case node_operation::bsr_assign:
                                    m_type_id = number_handle;
                                    m_lvalue  = true;
-                                   m_children[0]->check_conversion(number_handle, true);
-                                   m_children[1]->check_conversion(number_handle, false);
+                                   m_children[0]->check_conversion(context, number_handle, true);
+                                   m_children[1]->check_conversion(context, number_handle, false);
                                    break;
                                case node_operation::concat_assign:
                                    m_type_id = string_handle;
                                    m_lvalue  = true;
-                                   m_children[0]->check_conversion(string_handle, true);
-                                   m_children[1]->check_conversion(string_handle, false);
+                                   m_children[0]->check_conversion(context, string_handle, true);
+                                   m_children[1]->check_conversion(context, string_handle, false);
                                    break;
                                case node_operation::eq:
                                case node_operation::ne:
@@ -153,71 +169,63 @@ node::node(compiler_context& context, node_v value, std::vector<node_ptr> childr
                                case node_operation::ge:
                                    m_type_id = number_handle;
                                    m_lvalue  = false;
-                                   if (!m_children[0]->is_number() || !m_children[1]->is_number())
+                                   if (m_children[0]->type_id() != number_handle || m_children[1]->type_id() != number_handle)
                                    {
-                                       m_children[0]->check_conversion(string_handle, false);
-                                       m_children[1]->check_conversion(string_handle, false);
+                                       m_children[0]->check_conversion(context, string_handle, false);
+                                       m_children[1]->check_conversion(context, string_handle, false);
                                    } else
                                    {
-                                       m_children[0]->check_conversion(number_handle, false);
-                                       m_children[1]->check_conversion(number_handle, false);
+                                       m_children[0]->check_conversion(context, number_handle, false);
+                                       m_children[1]->check_conversion(context, number_handle, false);
                                    }
                                    break;
                                case node_operation::comma:
                                    for (i32 i{ 0 }; i < (i32) m_children.size(); ++i)
                                    {
-                                       m_children[i]->check_conversion(void_handle, false);
+                                       m_children[i]->check_conversion(context, void_handle, false);
                                    }
                                    m_type_id = m_children.back()->type_id();
                                    m_lvalue  = m_children.back()->lvalue();
                                    break;
                                case node_operation::index:
-                                   if (const array_type * at{ std::get_if<array_type>(m_children[0]->type_id()) })
+                                   if (const array_type * at{ types.get_if<array_type>(m_children[0]->type_id()) })
                                    {
                                        m_type_id = at->inner_type_id;
                                        m_lvalue  = m_children[0]->lvalue();
                                    } else
                                    {
-                                       // TODO: Semantic error
+                                       report(context, "Indexed expression is not an array");
                                    }
                                    break;
                                case node_operation::ternary:
-                                   m_children[0]->check_conversion(number_handle, false);
-                                   if (is_convertable(m_children[2]->type_id(), m_children[2]->lvalue(), m_children[1]->type_id(),
-                                                      m_children[1]->lvalue()))
-                                   {
-                                       m_children[2]->check_conversion(m_children[1]->type_id(), m_children[1]->lvalue());
-                                       m_type_id = m_children[1]->type_id();
-                                       m_lvalue  = m_children[1]->lvalue();
-                                   } else
-                                   {
-                                       m_children[1]->check_conversion(m_children[2]->type_id(), m_children[2]->lvalue());
-                                       m_type_id = m_children[2]->type_id();
-                                       m_lvalue  = m_children[2]->lvalue();
-                                   }
+                                   // Assignable when both branches are assignable and of one type, otherwise a plain value
+                                   // of the type the other branch converts to
+                                   m_children[0]->check_conversion(context, number_handle, false);
+                                   m_type_id = is_convertable(m_children[2]->type_id(), false, m_children[1]->type_id(), false)
+                                                   ? m_children[1]->type_id()
+                                                   : m_children[2]->type_id();
+                                   m_lvalue = m_children[1]->lvalue() && m_children[2]->lvalue() &&
+                                              m_children[1]->type_id() == m_children[2]->type_id();
+                                   m_children[1]->check_conversion(context, m_type_id, m_lvalue);
+                                   m_children[2]->check_conversion(context, m_type_id, m_lvalue);
                                    break;
                                case node_operation::call:
-                                   if (const function_type * ft{ std::get_if<function_type>(m_children[0]->type_id()) })
+                                   if (const function_type * ft{ types.get_if<function_type>(m_children[0]->type_id()) })
                                    {
                                        m_type_id = ft->return_type_id;
                                        m_lvalue  = false;
                                        if (ft->parameter_type_id.size() + 1 != m_children.size())
-                                       {
-                                           // TODO: Semantic error, incorrect argument count
-                                       }
-                                       for (u32 i{ 0 }; i < ft->parameter_type_id.size(); ++i)
-                                       {
-                                           if (m_children[i + 1]->lvalue() && !ft->parameter_type_id[i].by_ref)
-                                           {
-                                               // TODO: Semantic error
-                                           }
+                                           report(context, "Incorrect number of arguments");
 
-                                           m_children[i + 1]->check_conversion(ft->parameter_type_id[i].type_id,
+                                       const u32 count{ (u32) std::min(ft->parameter_type_id.size(), m_children.size() - 1) };
+                                       for (u32 i{ 0 }; i < count; ++i)
+                                       {
+                                           m_children[i + 1]->check_conversion(context, ft->parameter_type_id[i].type_id,
                                                                                ft->parameter_type_id[i].by_ref);
                                        }
                                    } else
                                    {
-                                       // TODO: Semantic error, function not callable
+                                       report(context, "Expression is not callable");
                                    }
                                    break;
                                }
@@ -242,7 +250,7 @@ bool node::is_number() const
 
 bool node::is_string() const
 {
-    return std::holds_alternative<std::string>(m_value);
+    return std::holds_alternative<string_literal>(m_value);
 }
 
 node_operation node::get_node_operation() const
@@ -250,7 +258,7 @@ node_operation node::get_node_operation() const
     return std::get<node_operation>(m_value);
 }
 
-std::string_view node::get_identifier() const
+symbol_id node::get_identifier() const
 {
     return std::get<identifier>(m_value).name;
 }
@@ -260,17 +268,33 @@ f64 node::get_number() const
     return std::get<f64>(m_value);
 }
 
-std::string_view node::get_string() const
+symbol_id node::get_string() const
 {
-    return std::get<std::string>(m_value);
+    return std::get<string_literal>(m_value).value;
 }
 
-void node::check_conversion(type_handle type_id, bool lvalue) const
+void node::check_conversion(compiler_context& context, type_handle type_id, bool lvalue) const
 {
-    if(!is_convertable(m_type_id, m_lvalue, type_id, lvalue))
+    if (!m_valid || is_convertable(m_type_id, m_lvalue, type_id, lvalue))
+        return;
+
+    if (lvalue && m_type_id == type_id)
     {
-        // TODO: Incorrect type error
+        context.diagnostics().report(error::semantic("Expression is not assignable", m_line_number, m_char_index));
+        return;
     }
+
+    const type_registry& types{ context.types() };
+    std::string          msg{ "Cannot convert '" };
+    msg.append(types.name(m_type_id)).append("' to '").append(types.name(type_id)).append(lvalue ? "&'" : "'");
+    context.diagnostics().report(error::semantic(msg.c_str(), m_line_number, m_char_index));
+}
+
+void node::report(compiler_context& context, const char* msg)
+{
+    if (m_valid)
+        context.diagnostics().report(error::semantic(msg, m_line_number, m_char_index));
+    m_valid = false;
 }
 
 } // namespace ptl
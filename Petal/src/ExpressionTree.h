@@ -27,15 +27,16 @@
 #include "Tokens.h"
 #include "Types.h"
 
+#include <initializer_list>
+#include <span>
 #include <variant>
-#include <vector>
 
 #include "CompilerContext.h"
 
 namespace ptl
 {
 
-enum struct node_operation
+enum struct node_operation : u8
 {
     param,
     preinc,
@@ -89,39 +90,61 @@ enum struct node_operation
 };
 
 struct node;
-using node_ptr = scope<node>;
+
+// Nodes live in the node arena of their compiler_context and are freed all at once with it
+using node_ptr = node*;
 
 struct node
 {
-    using node_v = std::variant<node_operation, std::string, f64, identifier>;
-    node(compiler_context& context, node_v value, std::vector<node_ptr> children, u32 line_number, u32 char_index);
+    using node_v = std::variant<node_operation, string_literal, f64, identifier>;
+
+    // children must already be in the arena, create() takes care of that
+    node(compiler_context& context, node_v value, std::span<const node_ptr> children, u32 line_number, u32 char_index);
+
+    // Builds a node in the context's node arena, copying children next to it
+    static node_ptr create(compiler_context& context, node_v value, std::span<const node_ptr> children, u32 line_number,
+                           u32 char_index);
+    static node_ptr create(compiler_context& context, node_v value, std::initializer_list<node_ptr> children,
+                           u32 line_number, u32 char_index)
+    {
+        return create(context, std::move(value), std::span<const node_ptr>{ children.begin(), children.size() }, line_number,
+                      char_index);
+    }
 
     [[nodiscard]] bool is_node_operation() const;
     [[nodiscard]] bool is_identifier() const;
     [[nodiscard]] bool is_number() const;
     [[nodiscard]] bool is_string() const;
 
-    [[nodiscard]] node_operation   get_node_operation() const;
-    [[nodiscard]] std::string_view get_identifier() const;
-    [[nodiscard]] f64              get_number() const;
-    [[nodiscard]] std::string_view get_string() const;
+    [[nodiscard]] node_operation get_node_operation() const;
+    [[nodiscard]] symbol_id      get_identifier() const;
+    [[nodiscard]] f64            get_number() const;
+    [[nodiscard]] symbol_id      get_string() const;
+
+    [[nodiscard]] constexpr const node_v&             value() const { return m_value; }
+    [[nodiscard]] constexpr std::span<const node_ptr> children() const { return m_children; }
+    [[nodiscard]] constexpr u32                       line_number() const { return m_line_number; }
+    [[nodiscard]] constexpr u32                       char_index() const { return m_char_index; }
+    [[nodiscard]] constexpr type_handle               type_id() const { return m_type_id; }
+    [[nodiscard]] constexpr bool                      lvalue() const { return m_lvalue; }
 
-    [[nodiscard]] constexpr const node_v&                value() const { return m_value; }
-    [[nodiscard]] constexpr const std::vector<node_ptr>& children() const { return m_children; }
-    [[nodiscard]] constexpr u32                          line_number() const { return m_line_number; }
-    [[nodiscard]] constexpr u32                          char_index() const { return m_char_index; }
-    [[nodiscard]] constexpr type_handle                  type_id() const { return m_type_id; }
-    [[nodiscard]] constexpr bool                         lvalue() const { return m_lvalue; }
+    // False when this node or one below it failed to type check, its type is then meaningless
+    [[nodiscard]] constexpr bool valid() const { return m_valid; }
 
-    void check_conversion(type_handle type_id, bool lvalue) const;
+    // Reports to the context's diagnostics when this node can't be used as type_id
+    void check_conversion(compiler_context& context, type_handle type_id, bool lvalue) const;
 
 private:
-    node_v                m_value{};
-    std::vector<node_ptr> m_children{};
-    u32                   m_line_number{};
-    u32                   m_char_index{};
-    type_handle           m_type_id{};
-    bool                  m_lvalue{};
+    // Reports msg at this node, unless one of its children already failed, and marks it invalid
+    void report(compiler_context& context, const char* msg);
+
+    node_v                    m_value{};
+    std::span<const node_ptr> m_children{};
+    u32                       m_line_number{};
+    u32                       m_char_index{};
+    type_handle               m_type_id{};
+    bool                      m_lvalue{};
+    bool                      m_valid{};
 };
 
 } // namespace ptl
\ No newline at end of file
@@ -0,0 +1,165 @@
+﻿//  ------------------------------------------------------------------------------
+//
+//  Petal
+//     Copyright 2023 Matthew Rogers
+//
+//     Licensed under the Apache License, Version 2.0 (the "License");
+//     you may not use this file except in compliance with the License.
+//     You may obtain a copy of the License at
+//
+//         http://www.apache.org/licenses/LICENSE-2.0
+//
+//     Unless required by applicable law or agreed to in writing, software
+//     distributed under the License is distributed on an "AS IS" BASIS,
+//     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//     See the License for the specific language governing permissions and
+//     limitations under the License.
+//
+//  File Name: FlatTree.cpp
+//  Date File Created: 10/17/2026
+//  Author: Matt
+//
+//  ------------------------------------------------------------------------------
+
+#include "FlatTree.h"
+
+namespace ptl
+{
+
+void flat_tree::clear()
+{
+    m_view    = {};
+    m_viewing = false;
+    m_symbols.clear();
+    m_types.clear();
+
+    m_kinds.clear();
+    m_operations.clear();
+    m_child_counts.clear();
+    m_payloads.clear();
+    m_child_list.clear();
+    m_numbers.clear();
+    m_line_numbers.clear();
+    m_char_indices.clear();
+    m_type_ids.clear();
+    m_lvalues.clear();
+    m_roots.clear();
+}
+
+void flat_tree::reserve(u32 count)
+{
+    m_kinds.reserve(count);
+    m_operations.reserve(count);
+    m_child_counts.reserve(count);
+    m_payloads.reserve(count);
+    m_child_list.reserve(count);
+    m_line_numbers.reserve(count);
+    m_char_indices.reserve(count);
+    m_type_ids.reserve(count);
+    m_lvalues.reserve(count);
+}
+
+flat_index flat_tree::append(const node& root)
+{
+    if (m_viewing)
+        own();
+
+    const flat_index ret{ append_node(root) };
+    m_roots.push_back(ret);
+    return ret;
+}
+
+void flat_tree::assign(const flat_arrays& arrays)
+{
+    m_view    = {};
+    m_viewing = false;
+    m_symbols.clear();
+    m_types.clear();
+
+    m_kinds.assign(arrays.kinds.begin(), arrays.kinds.end());
+    m_operations.assign(arrays.operations.begin(), arrays.operations.end());
+    m_child_counts.assign(arrays.child_counts.begin(), arrays.child_counts.end());
+    m_payloads.assign(arrays.payloads.begin(), arrays.payloads.end());
+    m_child_list.assign(arrays.child_list.begin(), arrays.child_list.end());
+    m_numbers.assign(arrays.numbers.begin(), arrays.numbers.end());
+    m_line_numbers.assign(arrays.line_numbers.begin(), arrays.line_numbers.end());
+    m_char_indices.assign(arrays.char_indices.begin(), arrays.char_indices.end());
+    m_type_ids.assign(arrays.type_ids.begin(), arrays.type_ids.end());
+    m_lvalues.assign(arrays.lvalues.begin(), arrays.lvalues.end());
+    m_roots.assign(arrays.roots.begin(), arrays.roots.end());
+}
+
+void flat_tree::view(const flat_arrays& arrays, std::vector<symbol_id> symbols, std::vector<type_handle> types)
+{
+    clear();
+    m_view    = arrays;
+    m_symbols = std::move(symbols);
+    m_types   = std::move(types);
+    m_viewing = true;
+}
+
+void flat_tree::own()
+{
+    const flat_arrays              arrays{ m_view };
+    const std::vector<symbol_id>   symbols{ std::move(m_symbols) };
+    const std::vector<type_handle> types{ std::move(m_types) };
+    assign(arrays);
+
+    remap_symbols([&](symbol_id id) { return symbols[id]; });
+    for (type_handle& type_id : m_type_ids)
+    {
+        type_id = types[(u32) type_id];
+    }
+}
+
+flat_index flat_tree::append_node(const node& n)
+{
+    // The children's own child lists are written while they are appended, so this node's list is gathered on the
+    // scratch stack and written once they are all done
+    const size_t base{ m_scratch.size() };
+    for (const node_ptr child : n.children())
+    {
+        const flat_index idx{ append_node(*child) };
+        m_scratch.push_back(idx);
+    }
+
+    flat_kind      kind{ flat_kind::operation };
+    node_operation operation{};
+    u32            payload{ 0 };
+
+    std::visit(overloaded{ [&](const node_operation val) {
+                              operation = val;
+                              payload   = (u32) m_child_list.size();
+                          },
+                           [&](const string_literal val) {
+                               kind    = flat_kind::string;
+                               payload = val.value;
+                           },
+                           [&](const f64 val) {
+                               kind    = flat_kind::number;
+                               payload = (u32) m_numbers.size();
+                               m_numbers.push_back(val);
+                           },
+                           [&](const identifier val) {
+                               kind    = flat_kind::identifier;
+                               payload = val.name;
+                           } },
+               n.value());
+
+    m_child_list.insert(m_child_list.end(), m_scratch.begin() + (std::ptrdiff_t) base, m_scratch.end());
+    m_child_counts.push_back((u32) (m_scratch.size() - base));
+    m_scratch.resize(base);
+
+    m_kinds.push_back(kind);
+    m_operations.push_back(operation);
+    m_payloads.push_back(payload);
+
+    m_line_numbers.push_back(n.line_number());
+    m_char_indices.push_back(n.char_index());
+    m_type_ids.push_back(n.type_id());
+    m_lvalues.push_back(n.lvalue());
+
+    return (flat_index) m_kinds.size() - 1;
+}
+
+} // namespace ptl
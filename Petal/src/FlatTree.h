@@ -0,0 +1,189 @@
+﻿//  ------------------------------------------------------------------------------
+//
+//  Petal
+//     Copyright 2023 Matthew Rogers
+//
+//     Licensed under the Apache License, Version 2.0 (the "License");
+//     you may not use this file except in compliance with the License.
+//     You may obtain a copy of the License at
+//
+//         http://www.apache.org/licenses/LICENSE-2.0
+//
+//     Unless required by applicable law or agreed to in writing, software
+//     distributed under the License is distributed on an "AS IS" BASIS,
+//     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//     See the License for the specific language governing permissions and
+//     limitations under the License.
+//
+//  File Name: FlatTree.h
+//  Date File Created: 10/17/2026
+//  Author: Matt
+//
+//  ------------------------------------------------------------------------------
+
+#pragma once
+
+#include "Common.h"
+#include "ExpressionTree.h"
+
+#include <span>
+#include <vector>
+
+namespace ptl
+{
+
+using flat_index = u32;
+
+enum struct flat_kind : u8
+{
+    operation,
+    number,
+    string,
+    identifier,
+};
+
+// The arrays of a flat_tree, see there. A module_image hands them out straight from its mapping
+struct flat_arrays
+{
+    std::span<const flat_kind>      kinds{};
+    std::span<const node_operation> operations{};
+    std::span<const u32>            child_counts{};
+    std::span<const u32>            payloads{};
+    std::span<const flat_index>     child_list{};
+    std::span<const f64>            numbers{};
+    std::span<const u32>            line_numbers{};
+    std::span<const u32>            char_indices{};
+    std::span<const type_handle>    type_ids{};
+    std::span<const u8>             lvalues{};
+    std::span<const flat_index>     roots{};
+};
+
+// Expression trees linearized in post-order, every node comes after all of its children. A pass that needs the
+// children done first (type checking, folding, code generation) is a plain loop over the indices. The hot data is
+// kind, operation, child list and payload; source positions, types and lvalue flags are kept in separate arrays so
+// a sweep only pulls in what it reads. The payload is the node_operation's child list offset, the symbol_id of an
+// identifier or string literal, or an index into the number table
+//
+// This is deliberately not the form the compiler works on. Type checking happens while the parser builds each node and
+// folding and code generation need the parent before the children (short circuits, lvalues, calls), so they stay on the
+// pointer trees. A flat_tree is built from finished trees: it is the on-disk form of a module_image and the input of
+// passes that only need one bottom-up sweep. Like a token_buffer, the arrays are either the tree's own or a view
+class flat_tree
+{
+public:
+    flat_tree() = default;
+
+    // Drops the nodes but keeps the allocations
+    void clear();
+    void reserve(u32 count);
+
+    // Appends the tree under root and records it as a root, returns root's index
+    flat_index append(const node& root);
+
+    // Replaces the nodes with a copy of arrays
+    void assign(const flat_arrays& arrays);
+
+    // Replaces the nodes with arrays themselves, e.g. those of a module_image, which must outlive the tree or the next
+    // change to it. The payload of an identifier or string literal indexes symbols and a type id indexes types, which
+    // hold the symbol_id and the type_handle. Anything that changes the tree copies it first
+    void view(const flat_arrays& arrays, std::vector<symbol_id> symbols, std::vector<type_handle> types);
+
+    // Replaces the symbol_id of every identifier and string literal with map(id), used to move the tree over to a
+    // different symbol_table. A viewed tree keeps its payloads, only the ids they index are mapped
+    template<typename Map>
+    void remap_symbols(Map&& map)
+    {
+        if (m_viewing)
+        {
+            for (symbol_id& id : m_symbols)
+            {
+                id = map(id);
+            }
+            return;
+        }
+
+        for (flat_index i{ 0 }; i < size(); ++i)
+        {
+            if (m_kinds[i] == flat_kind::identifier || m_kinds[i] == flat_kind::string)
+                m_payloads[i] = map(m_payloads[i]);
+        }
+    }
+
+    [[nodiscard]] u32 size() const { return (u32) kinds().size(); }
+
+    [[nodiscard]] flat_kind      kind(flat_index idx) const { return kinds()[idx]; }
+    [[nodiscard]] node_operation operation(flat_index idx) const { return operations()[idx]; }
+    [[nodiscard]] f64            get_number(flat_index idx) const { return numbers()[payloads()[idx]]; }
+
+    [[nodiscard]] symbol_id get_symbol(flat_index idx) const
+    {
+        return m_viewing ? m_symbols[payloads()[idx]] : payloads()[idx];
+    }
+
+    [[nodiscard]] std::span<const flat_index> children(flat_index idx) const
+    {
+        const u32 count{ m_viewing ? m_view.child_counts[idx] : m_child_counts[idx] };
+        if (count == 0)
+            return {};
+        return { (m_viewing ? m_view.child_list.data() : m_child_list.data()) + payloads()[idx], count };
+    }
+
+    [[nodiscard]] u32  line_number(flat_index idx) const { return m_viewing ? m_view.line_numbers[idx] : m_line_numbers[idx]; }
+    [[nodiscard]] u32  char_index(flat_index idx) const { return m_viewing ? m_view.char_indices[idx] : m_char_indices[idx]; }
+    [[nodiscard]] bool lvalue(flat_index idx) const { return m_viewing ? m_view.lvalues[idx] : m_lvalues[idx]; }
+
+    [[nodiscard]] type_handle type_id(flat_index idx) const
+    {
+        return m_viewing ? m_types[(u32) m_view.type_ids[idx]] : m_type_ids[idx];
+    }
+
+    // The index of every appended tree's root, in append order
+    [[nodiscard]] std::span<const flat_index> roots() const { return m_viewing ? m_view.roots : m_roots; }
+    [[nodiscard]] std::span<const flat_kind>  kinds() const { return m_viewing ? m_view.kinds : m_kinds; }
+    [[nodiscard]] std::span<const u32>        payloads() const { return m_viewing ? m_view.payloads : m_payloads; }
+    [[nodiscard]] std::span<const f64>        numbers() const { return m_viewing ? m_view.numbers : m_numbers; }
+
+    [[nodiscard]] std::span<const node_operation> operations() const
+    {
+        return m_viewing ? m_view.operations : m_operations;
+    }
+
+    // The arrays as they are, a viewed tree's symbol payloads and type ids are not symbol ids and type handles
+    [[nodiscard]] flat_arrays arrays() const
+    {
+        if (m_viewing)
+            return m_view;
+        return { m_kinds,        m_operations,   m_child_counts, m_payloads, m_child_list, m_numbers,
+                 m_line_numbers, m_char_indices, m_type_ids,     m_lvalues,  m_roots };
+    }
+
+private:
+    flat_index append_node(const node& n);
+
+    // Copies a viewed tree into the tree's own arrays, with its symbol ids and type handles
+    void own();
+
+    // Hot
+    std::vector<flat_kind>      m_kinds{};
+    std::vector<node_operation> m_operations{};
+    std::vector<u32>            m_child_counts{};
+    std::vector<u32>            m_payloads{};
+    std::vector<flat_index>     m_child_list{};
+    std::vector<f64>            m_numbers{};
+
+    // Cold
+    std::vector<u32>         m_line_numbers{};
+    std::vector<u32>         m_char_indices{};
+    std::vector<type_handle> m_type_ids{};
+    std::vector<u8>          m_lvalues{};
+
+    std::vector<flat_index> m_roots{};
+    std::vector<flat_index> m_scratch{};
+
+    flat_arrays              m_view{};
+    std::vector<symbol_id>   m_symbols{}; // indexed by the payloads of viewed identifiers and string literals
+    std::vector<type_handle> m_types{};   // indexed by viewed type ids
+    bool                     m_viewing{};
+};
+
+} // namespace ptl
@@ -0,0 +1,320 @@
+﻿//  ------------------------------------------------------------------------------
+//
+//  Petal
+//     Copyright 2023 Matthew Rogers
+//
+//     Licensed under the Apache License, Version 2.0 (the "License");
+//     you may not use this file except in compliance with the License.
+//     You may obtain a copy of the License at
+//
+//         http://www.apache.org/licenses/LICENSE-2.0
+//
+//     Unless required by applicable law or agreed to in writing, software
+//     distributed under the License is distributed on an "AS IS" BASIS,
+//     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//     See the License for the specific language governing permissions and
+//     limitations under the License.
+//
+//  File Name: Fold.cpp
+//  Date File Created: 10/17/2026
+//  Author: Matt
+//
+//  ------------------------------------------------------------------------------
+
+#include "Fold.h"
+#include "Operations.h"
+
+#include <bit>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace ptl
+{
+namespace
+{
+
+class folder
+{
+public:
+    explicit folder(compiler_context& context) : m_context{ context } {}
+
+    node_ptr fold(node_ptr n);
+
+private:
+    node_ptr fold_operation(node_ptr n);
+    node_ptr fold_number(node_ptr n, node_operation operation, f64 a, f64 b);
+    node_ptr fold_identity(node_ptr n, node_operation operation);
+    node_ptr fold_ternary(node_ptr n);
+    node_ptr fold_comma(node_ptr n);
+
+    node_ptr number(f64 value, const node& at)
+    {
+        return node::create(m_context, value, {}, at.line_number(), at.char_index());
+    }
+
+    node_ptr string(std::string_view value, const node& at)
+    {
+        return node::create(m_context, string_literal{ m_context.symbols().intern(value) }, {}, at.line_number(),
+                            at.char_index());
+    }
+
+    // n in place of a node that was not an lvalue, so it must not become assignable
+    node_ptr rvalue(node_ptr n, const node& replaced)
+    {
+        if (!n->lvalue() || replaced.lvalue())
+            return n;
+        return node::create(m_context, node_operation::param, { n }, n->line_number(), n->char_index());
+    }
+
+    // Text of a number or string literal, as the runtime would convert it
+    std::optional<std::string> literal_text(const node& n) const
+    {
+        if (n.is_string())
+            return std::string{ m_context.symbols().name(n.get_string()) };
+        if (n.is_number())
+            return ops::to_string(n.get_number());
+        return std::nullopt;
+    }
+
+    compiler_context&     m_context;
+    std::vector<node_ptr> m_scratch{};
+};
+
+node_ptr folder::fold(node_ptr n)
+{
+    if (!n->is_node_operation())
+        return n;
+
+    // Children first, the node is only rebuilt when one of them changed
+    const size_t base{ m_scratch.size() };
+    bool         changed{ false };
+    for (const node_ptr child : n->children())
+    {
+        const node_ptr folded{ fold(child) };
+        changed |= folded != child;
+        m_scratch.push_back(folded);
+    }
+
+    if (changed)
+    {
+        const std::span<const node_ptr> children{ m_scratch.data() + base, m_scratch.size() - base };
+        n = node::create(m_context, n->get_node_operation(), children, n->line_number(), n->char_index());
+    }
+    m_scratch.resize(base);
+
+    return fold_operation(n);
+}
+
+node_ptr folder::fold_operation(node_ptr n)
+{
+    const node_operation            operation{ n->get_node_operation() };
+    const std::span<const node_ptr> children{ n->children() };
+
+    switch (operation)
+    {
+    case node_operation::param:
+        // A literal is never an lvalue, so there is nothing to strip
+        return children[0]->is_number() || children[0]->is_string() ? children[0] : n;
+    case node_operation::positive:
+    case node_operation::negative:
+    case node_operation::bnot:
+    case node_operation::lnot:
+        return children[0]->is_number() ? fold_number(n, operation, children[0]->get_number(), 0.0) : n;
+    case node_operation::add:
+    case node_operation::sub:
+    case node_operation::mul:
+    case node_operation::div:
+    case node_operation::idiv:
+    case node_operation::mod:
+    case node_operation::band:
+    case node_operation::bor:
+    case node_operation::bxor:
+    case node_operation::bsl:
+    case node_operation::bsr:
+        if (children[0]->is_number() && children[1]->is_number())
+            return fold_number(n, operation, children[0]->get_number(), children[1]->get_number());
+        return fold_identity(n, operation);
+    case node_operation::land:
+    case node_operation::lor:
+        // The right operand is only evaluated when the left one does not decide the result
+        if (!children[0]->is_number())
+            return n;
+        if (ops::truth(children[0]->get_number()) == (operation == node_operation::lor))
+            return number(operation == node_operation::lor ? 1.0 : 0.0, *n);
+        if (children[1]->is_number())
+            return number(ops::truth(children[1]->get_number()) ? 1.0 : 0.0, *n);
+        return n;
+    case node_operation::concat:
+    {
+        const std::optional<std::string> a{ literal_text(*children[0]) };
+        const std::optional<std::string> b{ a ? literal_text(*children[1]) : std::nullopt };
+        return b ? string(*a + *b, *n) : n;
+    }
+    case node_operation::eq:
+    case node_operation::ne:
+    case node_operation::lt:
+    case node_operation::gt:
+    case node_operation::le:
+    case node_operation::ge:
+    {
+        if (children[0]->is_number() && children[1]->is_number())
+            return fold_number(n, operation, children[0]->get_number(), children[1]->get_number());
+
+        // Anything else is compared as strings
+        const std::optional<std::string> a{ literal_text(*children[0]) };
+        const std::optional<std::string> b{ a ? literal_text(*children[1]) : std::nullopt };
+        if (!b)
+            return n;
+
+        const i32 cmp{ a->compare(*b) };
+        bool      result{};
+        switch (operation)
+        {
+        case node_operation::eq: result = cmp == 0; break;
+        case node_operation::ne: result = cmp != 0; break;
+        case node_operation::lt: result = cmp < 0; break;
+        case node_operation::gt: result = cmp > 0; break;
+        case node_operation::le: result = cmp <= 0; break;
+        default: result = cmp >= 0; break;
+        }
+        return number(result ? 1.0 : 0.0, *n);
+    }
+    case node_operation::ternary: return fold_ternary(n);
+    case node_operation::comma: return fold_comma(n);
+    default: return n;
+    }
+}
+
+node_ptr folder::fold_number(node_ptr n, node_operation operation, f64 a, f64 b)
+{
+    f64 result{};
+    switch (operation)
+    {
+    case node_operation::positive: result = a; break;
+    case node_operation::negative: result = -a; break;
+    case node_operation::bnot: result = ops::bnot(a); break;
+    case node_operation::lnot: result = ops::truth(a) ? 0.0 : 1.0; break;
+    case node_operation::add: result = a + b; break;
+    case node_operation::sub: result = a - b; break;
+    case node_operation::mul: result = a * b; break;
+    case node_operation::div: result = a / b; break;
+    case node_operation::idiv: result = ops::idiv(a, b); break;
+    case node_operation::mod: result = ops::mod(a, b); break;
+    case node_operation::band: result = ops::band(a, b); break;
+    case node_operation::bor: result = ops::bor(a, b); break;
+    case node_operation::bxor: result = ops::bxor(a, b); break;
+    case node_operation::bsl: result = ops::bsl(a, b); break;
+    case node_operation::bsr: result = ops::bsr(a, b); break;
+    case node_operation::eq: result = a == b; break;
+    case node_operation::ne: result = a != b; break;
+    case node_operation::lt: result = a < b; break;
+    case node_operation::gt: result = a > b; break;
+    case node_operation::le: result = a <= b; break;
+    case node_operation::ge: result = a >= b; break;
+    default: return n;
+    }
+
+    return number(result, *n);
+}
+
+node_ptr folder::fold_identity(node_ptr n, node_operation operation)
+{
+    const node_ptr lhs{ n->children()[0] };
+    const node_ptr rhs{ n->children()[1] };
+
+    // Bit for bit, so the two zeros stay apart
+    const auto is = [](node_ptr operand, f64 value) {
+        return operand->is_number() && std::bit_cast<u64>(operand->get_number()) == std::bit_cast<u64>(value);
+    };
+    const auto is_number_typed = [](node_ptr operand) { return operand->type_id() == type_registry::number_handle(); };
+
+    // Only identities that hold for every x, -0 included: x + 0 and x - -0 are +0 for x = -0, which prints as "0"
+    // where -0 prints as "-0", so those are left alone
+    switch (operation)
+    {
+    case node_operation::add:
+        if (is(rhs, -0.0) && is_number_typed(lhs))
+            return rvalue(lhs, *n);
+        if (is(lhs, -0.0) && is_number_typed(rhs))
+            return rvalue(rhs, *n);
+        break;
+    case node_operation::sub:
+        if (is(rhs, 0.0) && is_number_typed(lhs))
+            return rvalue(lhs, *n);
+        break;
+    case node_operation::mul:
+        if (is(rhs, 1.0) && is_number_typed(lhs))
+            return rvalue(lhs, *n);
+        if (is(lhs, 1.0) && is_number_typed(rhs))
+            return rvalue(rhs, *n);
+        break;
+    case node_operation::div:
+        if (is(rhs, 1.0) && is_number_typed(lhs))
+            return rvalue(lhs, *n);
+        break;
+    default: break;
+    }
+
+    return n;
+}
+
+node_ptr folder::fold_ternary(node_ptr n)
+{
+    const std::span<const node_ptr> children{ n->children() };
+    if (!children[0]->is_number())
+        return n;
+
+    // The branch that is left has to have the ternary's type already, a conversion still has to happen at runtime
+    const node_ptr taken{ ops::truth(children[0]->get_number()) ? children[1] : children[2] };
+    if (taken->type_id() != n->type_id())
+        return n;
+
+    return rvalue(taken, *n);
+}
+
+node_ptr folder::fold_comma(node_ptr n)
+{
+    const std::span<const node_ptr> children{ n->children() };
+
+    // Literals before the last item have no effect
+    const size_t base{ m_scratch.size() };
+    for (size_t i{ 0 }; i + 1 < children.size(); ++i)
+    {
+        if (!children[i]->is_number() && !children[i]->is_string())
+            m_scratch.push_back(children[i]);
+    }
+
+    const size_t kept{ m_scratch.size() - base };
+    if (kept + 1 == children.size())
+    {
+        m_scratch.resize(base);
+        return n;
+    }
+
+    node_ptr ret{ children.back() };
+    if (kept > 0)
+    {
+        m_scratch.push_back(children.back());
+        const std::span<const node_ptr> items{ m_scratch.data() + base, m_scratch.size() - base };
+        ret = node::create(m_context, node_operation::comma, items, n->line_number(), n->char_index());
+    }
+    m_scratch.resize(base);
+
+    return ret;
+}
+
+} // anonymous namespace
+
+node_ptr fold_constants(compiler_context& context, node_ptr root)
+{
+    // root was type checked when it was parsed, the rebuilt nodes would only report the same errors again
+    error::diagnostics& diag{ context.diagnostics() };
+    const bool          muted{ diag.muted() };
+    diag.set_muted(true);
+    const node_ptr ret{ folder{ context }.fold(root) };
+    diag.set_muted(muted);
+    return ret;
+}
+
+} // namespace ptl
@@ -0,0 +1,38 @@
+﻿//  ------------------------------------------------------------------------------
+//
+//  Petal
+//     Copyright 2023 Matthew Rogers
+//
+//     Licensed under the Apache License, Version 2.0 (the "License");
+//     you may not use this file except in compliance with the License.
+//     You may obtain a copy of the License at
+//
+//         http://www.apache.org/licenses/LICENSE-2.0
+//
+//     Unless required by applicable law or agreed to in writing, software
+//     distributed under the License is distributed on an "AS IS" BASIS,
+//     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//     See the License for the specific language governing permissions and
+//     limitations under the License.
+//
+//  File Name: Fold.h
+//  Date File Created: 10/17/2026
+//  Author: Matt
+//
+//  ------------------------------------------------------------------------------
+
+#pragma once
+
+#include "Common.h"
+#include "ExpressionTree.h"
+
+namespace ptl
+{
+
+// Evaluates every operation whose operands are all literals (arithmetic, bitwise, logical, comparison, concat) and
+// simplifies what it can around the rest: number identities such as x * 1 and x + 0, ternaries with a literal
+// condition and side effect free literals in comma lists. Folded values follow ptl::ops, so they are exactly what the
+// VM would compute. Untouched subtrees are shared with the input, new nodes are built in the context's node arena
+node_ptr fold_constants(compiler_context& context, node_ptr root);
+
+} // namespace ptl
@@ -0,0 +1,166 @@
+﻿//  ------------------------------------------------------------------------------
+//
+//  Petal
+//     Copyright 2023 Matthew Rogers
+//
+//     Licensed under the Apache License, Version 2.0 (the "License");
+//     you may not use this file except in compliance with the License.
+//     You may obtain a copy of the License at
+//
+//         http://www.apache.org/licenses/LICENSE-2.0
+//
+//     Unless required by applicable law or agreed to in writing, software
+//     distributed under the License is distributed on an "AS IS" BASIS,
+//     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//     See the License for the specific language governing permissions and
+//     limitations under the License.
+//
+//  File Name: Heap.cpp
+//  Date File Created: 10/17/2026
+//  Author: Matt
+//
+//  ------------------------------------------------------------------------------
+
+#include "Heap.h"
+
+#include <algorithm>
+
+namespace ptl
+{
+namespace
+{
+
+size_t object_size(const string_object& str)
+{
+    return sizeof(string_object) + str.text.capacity();
+}
+
+size_t object_size(const array_object& arr)
+{
+    return sizeof(array_object) + arr.elements.capacity() * sizeof(value);
+}
+
+// The sweep only has the kind to go by, new objects are sized from the type they were created as
+size_t object_size(const object* obj)
+{
+    if (obj->kind == value_kind::string)
+        return object_size(*(const string_object*) obj);
+    return object_size(*(const array_object*) obj);
+}
+
+void destroy(object* obj)
+{
+    if (obj->kind == value_kind::string)
+        delete (string_object*) obj;
+    else
+        delete (array_object*) obj;
+}
+
+} // anonymous namespace
+
+heap::~heap()
+{
+    while (m_objects)
+    {
+        object* next{ m_objects->next };
+        destroy(m_objects);
+        m_objects = next;
+    }
+}
+
+string_object* heap::new_string(std::string text)
+{
+    string_object* ret{ new string_object{} };
+    ret->kind = value_kind::string;
+    ret->text = std::move(text);
+    link(ret, object_size(*ret));
+    return ret;
+}
+
+array_object* heap::new_array(size_t size, value fill)
+{
+    array_object* ret{ new array_object{} };
+    ret->kind = value_kind::array;
+    ret->elements.assign(size, fill);
+    link(ret, object_size(*ret));
+    return ret;
+}
+
+void heap::mark(value root)
+{
+    object* obj{ root.as_object() };
+    if (!obj || obj->marked)
+        return;
+
+    obj->marked = true;
+    if (obj->kind == value_kind::array)
+        m_gray.push_back(obj);
+    trace();
+}
+
+void heap::mark(std::span<const value> roots)
+{
+    for (const value root : roots)
+    {
+        mark(root);
+    }
+}
+
+void heap::sweep()
+{
+    size_t  live{ 0 };
+    object* survivors{};
+
+    while (m_objects)
+    {
+        object* obj{ m_objects };
+        m_objects = obj->next;
+
+        if (obj->marked)
+        {
+            obj->marked = false;
+            obj->next   = survivors;
+            survivors   = obj;
+            live += object_size(obj);
+        } else
+        {
+            destroy(obj);
+            --m_object_count;
+        }
+    }
+
+    m_objects   = survivors;
+    m_allocated = live;
+    m_threshold = std::max(initial_threshold, live * 2);
+}
+
+void heap::link(object* obj, size_t size)
+{
+    obj->next = m_objects;
+    m_objects = obj;
+    m_allocated += size;
+    ++m_object_count;
+}
+
+void heap::trace()
+{
+    // Arrays of arrays can nest arbitrarily deep, so the elements are walked with an explicit stack
+    while (!m_gray.empty())
+    {
+        const array_object* arr{ (const array_object*) m_gray.back() };
+        m_gray.pop_back();
+
+        for (const value element : arr->elements)
+        {
+            object* obj{ element.as_object() };
+            if (!obj || obj->marked)
+                continue;
+
+            obj->marked = true;
+            if (obj->kind == value_kind::array)
+                m_gray.push_back(obj);
+        }
+    }
+}
+
+} // namespace ptl
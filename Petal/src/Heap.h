@@ -0,0 +1,76 @@
+﻿//  ------------------------------------------------------------------------------
+//
+//  Petal
+//     Copyright 2023 Matthew Rogers
+//
+//     Licensed under the Apache License, Version 2.0 (the "License");
+//     you may not use this file except in compliance with the License.
+//     You may obtain a copy of the License at
+//
+//         http://www.apache.org/licenses/LICENSE-2.0
+//
+//     Unless required by applicable law or agreed to in writing, software
+//     distributed under the License is distributed on an "AS IS" BASIS,
+//     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//     See the License for the specific language governing permissions and
+//     limitations under the License.
+//
+//  File Name: Heap.h
+//  Date File Created: 10/17/2026
+//  Author: Matt
+//
+//  ------------------------------------------------------------------------------
+
+#pragma once
+
+#include "Common.h"
+#include "Value.h"
+
+#include <span>
+#include <string>
+#include <vector>
+
+namespace ptl
+{
+
+// Owns every string and array of a virtual machine. Collection is mark and sweep: the owner marks its roots, then
+// sweep() frees whatever was not reached. Nothing is collected behind the owner's back, allocation only reports
+// through should_collect() that enough was allocated since the last sweep
+class heap
+{
+public:
+    heap() = default;
+    ~heap();
+
+    heap(const heap&)            = delete;
+    heap& operator=(const heap&) = delete;
+
+    string_object* new_string(std::string text);
+    array_object*  new_array(size_t size, value fill);
+
+    [[nodiscard]] bool should_collect() const { return m_allocated >= m_threshold; }
+
+    // Marks everything reachable from the given roots
+    void mark(value root);
+    void mark(std::span<const value> roots);
+
+    // Frees every unmarked object and clears the marks of the others
+    void sweep();
+
+    [[nodiscard]] size_t allocated() const { return m_allocated; }
+    [[nodiscard]] u32    object_count() const { return m_object_count; }
+
+private:
+    static constexpr size_t initial_threshold{ 1024 * 1024 };
+
+    void link(object* obj, size_t size);
+    void trace();
+
+    object*              m_objects{};
+    std::vector<object*> m_gray{};
+    size_t               m_allocated{};
+    size_t               m_threshold{ initial_threshold };
+    u32                  m_object_count{};
+};
+
+} // namespace ptl
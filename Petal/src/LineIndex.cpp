@@ -0,0 +1,64 @@
+﻿//  ------------------------------------------------------------------------------
+//
+//  Petal
+//     Copyright 2023 Matthew Rogers
+//
+//     Licensed under the Apache License, Version 2.0 (the "License");
+//     you may not use this file except in compliance with the License.
+//     You may obtain a copy of the License at
+//
+//         http://www.apache.org/licenses/LICENSE-2.0
+//
+//     Unless required by applicable law or agreed to in writing, software
+//     distributed under the License is distributed on an "AS IS" BASIS,
+//     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//     See the License for the specific language governing permissions and
+//     limitations under the License.
+//
+//  File Name: LineIndex.cpp
+//  Date File Created: 10/17/2026
+//  Author: Matt
+//
+//  ------------------------------------------------------------------------------
+
+#include "LineIndex.h"
+#include "Util/Scan.h"
+
+#include <algorithm>
+
+namespace ptl
+{
+
+void line_index::build(std::string_view text)
+{
+    m_line_starts.clear();
+    m_line_starts.reserve(utl::count_newlines(text, 0, text.size()) + 1);
+    m_line_starts.push_back(0);
+
+    for (size_t pos{ utl::find_byte(text, 0, '\n') }; pos < text.size(); pos = utl::find_byte(text, pos + 1, '\n'))
+    {
+        m_line_starts.push_back((u32) pos + 1);
+    }
+}
+
+source_location line_index::locate(u32 char_index) const
+{
+    const auto it{ std::upper_bound(m_line_starts.begin(), m_line_starts.end(), char_index) };
+    const u32  line{ (u32) (it - m_line_starts.begin()) - 1 };
+    return { line, char_index - m_line_starts[line] };
+}
+
+std::string_view line_index::line_text(std::string_view text, u32 line) const
+{
+    if (line >= line_count())
+        return {};
+
+    const size_t begin{ std::min((size_t) m_line_starts[line], text.size()) };
+    size_t       end{ line + 1 < line_count() ? m_line_starts[line + 1] - 1 : text.size() };
+    if (end > begin && text[end - 1] == '\r')
+        --end;
+
+    return text.substr(begin, end - begin);
+}
+
+} // namespace ptl
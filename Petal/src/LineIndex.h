@@ -0,0 +1,65 @@
+﻿//  ------------------------------------------------------------------------------
+//
+//  Petal
+//     Copyright 2023 Matthew Rogers
+//
+//     Licensed under the Apache License, Version 2.0 (the "License");
+//     you may not use this file except in compliance with the License.
+//     You may obtain a copy of the License at
+//
+//         http://www.apache.org/licenses/LICENSE-2.0
+//
+//     Unless required by applicable law or agreed to in writing, software
+//     distributed under the License is distributed on an "AS IS" BASIS,
+//     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//     See the License for the specific language governing permissions and
+//     limitations under the License.
+//
+//  File Name: LineIndex.h
+//  Date File Created: 10/17/2026
+//  Author: Matt
+//
+//  ------------------------------------------------------------------------------
+
+#pragma once
+
+#include "Common.h"
+
+#include <string_view>
+#include <vector>
+
+namespace ptl
+{
+
+// Zero based, like the line numbers and char indices used everywhere else
+struct source_location
+{
+    u32 line{};
+    u32 column{};
+};
+
+// Offsets of the first character of every line, so a char index maps to a line and column with a binary search
+// instead of rereading the source. The index is built by its own newline scan rather than by the lexer: the lexer
+// jumps over whole comments and strings with the scan kernels and can run over streamed input that is gone by the
+// time an error is printed, while this scan is a memchr-speed pass over text that is already mapped
+class line_index
+{
+public:
+    line_index() = default;
+    explicit line_index(std::string_view text) { build(text); }
+
+    void build(std::string_view text);
+
+    [[nodiscard]] u32 line_count() const { return (u32) m_line_starts.size(); }
+    [[nodiscard]] u32 line_start(u32 line) const { return m_line_starts[line]; }
+
+    [[nodiscard]] source_location locate(u32 char_index) const;
+
+    // Text of line without its line break
+    [[nodiscard]] std::string_view line_text(std::string_view text, u32 line) const;
+
+private:
+    std::vector<u32> m_line_starts{ 0 };
+};
+
+} // namespace ptl
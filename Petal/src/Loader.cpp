@@ -0,0 +1,201 @@
+﻿//  ------------------------------------------------------------------------------
+//
+//  Petal
+//     Copyright 2023 Matthew Rogers
+//
+//     Licensed under the Apache License, Version 2.0 (the "License");
+//     you may not use this file except in compliance with the License.
+//     You may obtain a copy of the License at
+//
+//         http://www.apache.org/licenses/LICENSE-2.0
+//
+//     Unless required by applicable law or agreed to in writing, software
+//     distributed under the License is distributed on an "AS IS" BASIS,
+//     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//     See the License for the specific language governing permissions and
+//     limitations under the License.
+//
+//  File Name: Loader.cpp
+//  Date File Created: 10/17/2026
+//  Author: Matt
+//
+//  ------------------------------------------------------------------------------
+
+#include "Loader.h"
+
+namespace ptl
+{
+
+namespace
+{
+
+// Distinct symbols of tokens in the order they first show up. seen is scratch space of the worker, indexed by symbol
+// and holding the stamp of the last file that used the symbol
+std::vector<symbol_id> first_uses(const token_buffer& tokens, std::vector<u32>& seen, u32 stamp, u32 symbol_count)
+{
+    seen.resize(symbol_count);
+
+    std::vector<symbol_id> ret{};
+    for (u32 i{ 0 }; i < tokens.size(); ++i)
+    {
+        const token_kind kind{ tokens.kind(i) };
+        if (kind != token_kind::identifier && kind != token_kind::string)
+            continue;
+
+        const symbol_id id{ tokens.get_symbol(i) };
+        if (seen[id] != stamp)
+        {
+            seen[id] = stamp;
+            ret.push_back(id);
+        }
+    }
+    return ret;
+}
+
+} // anonymous namespace
+
+project load_project(std::span<const std::filesystem::path> paths, utl::thread_pool& pool, const module_cache* cache,
+                     const compile_options* compile)
+{
+    project ret{};
+    ret.files.resize(paths.size());
+
+    std::vector<symbol_table>           worker_symbols(pool.size());
+    std::vector<std::vector<u32>>       worker_seen(pool.size());
+    std::vector<u32>                    lexed_by(paths.size());
+    std::vector<std::vector<symbol_id>> file_symbols(paths.size());
+
+    // An image only gets the code once every body is compiled, which is up to compile_options::strict, see
+    // script::image_contents. The options are part of the key, a lazy compile never picks up the image of a strict one
+    compile_options options{ compile ? *compile : compile_options{} };
+    options.keep_tree = options.keep_tree || cache;
+
+    // Maps file.path and fills file.tokens, interning into the worker's table, and lists the symbols the file uses. With
+    // a module image in the cache the tokens are the image's own, they index the list. False when the file can't be
+    // opened
+    const auto lex = [&](u32 task, u32 worker) {
+        project_file& file{ ret.files[task] };
+        std::optional text{ source::from_file(file.path) };
+        if (!text)
+        {
+            file.diagnostics.report({ "Could not open file", 0, 0 });
+            return false;
+        }
+
+        file.text   = std::move(*text);
+        file.opened = true;
+        file.lines.build(file.text.text());
+
+        symbol_table& symbols{ worker_symbols[worker] };
+        if (cache)
+            file.image = cache->open(module_key(file.text.text(), options));
+        if (file.image)
+        {
+            // The image numbers the symbols it uses from 0, each once, so the list is what they are in the worker's table
+            file_symbols[task] = file.image->intern_symbols(symbols);
+            file.tokens.view(file.image->tokens(), file_symbols[task]);
+            file.cached = true;
+            return true;
+        }
+
+        tokenize(file.text.text(), symbols, file.tokens, file.diagnostics);
+        file_symbols[task] = first_uses(file.tokens, worker_seen[worker], task + 1, symbols.size());
+        return true;
+    };
+
+    pool.run((u32) paths.size(), [&](u32 task, u32 worker) {
+        project_file& file{ ret.files[task] };
+        file.path      = paths[task];
+        lexed_by[task] = worker;
+
+        if (!lex(task, worker) || file.diagnostics.has_errors())
+            return;
+
+        // The script is compiled from the tokens and the worker's table and merged with them below, symbols it interns
+        // on its own (folded strings) are new to the table and go on the file's list. An image with code gives the
+        // script without compiling anything, its symbols are on the list already
+        symbol_table&   symbols{ worker_symbols[worker] };
+        const bool      from_image{ compile && file.image && file.image->has_code() };
+        const symbol_id interned{ symbols.size() };
+        if (from_image)
+            file.compiled = create_scope<script>(source::from_view(file.text.text()), *file.image, file_symbols[task],
+                                                 symbols, options);
+        else if (compile)
+        {
+            file.compiled = create_scope<script>(source::from_view(file.text.text()), file.tokens, file.lines, symbols,
+                                                 options);
+            for (symbol_id id{ interned }; id < symbols.size(); ++id)
+            {
+                file_symbols[task].push_back(id);
+            }
+        }
+
+        if (cache && !from_image)
+        {
+            const module_contents contents{ file.compiled ? file.compiled->image_contents(symbols, file.tokens)
+                                                          : module_contents{ symbols, file.tokens } };
+
+            // An image that is there already is only written again when it gains the code
+            if (!file.image || contents.code)
+                cache->store(module_key(file.text.text(), options), contents);
+        }
+    });
+
+    // Walking the files in order makes the merged ids depend only on the input. Only the distinct symbols of each file
+    // are walked here, the tokens are rewritten in parallel afterwards. Tokens and trees viewed in an image only have
+    // their lists of ids rewritten
+    constexpr symbol_id                 unmapped{ ~0u };
+    std::vector<std::vector<symbol_id>> remap(pool.size());
+    for (u32 i{ 0 }; i < (u32) ret.files.size(); ++i)
+    {
+        const u32               worker{ lexed_by[i] };
+        const symbol_table&     local{ worker_symbols[worker] };
+        std::vector<symbol_id>& map{ remap[worker] };
+        map.resize(local.size(), unmapped);
+
+        for (const symbol_id id : file_symbols[i])
+        {
+            if (map[id] == unmapped)
+                map[id] = ret.symbols.intern(local.name(id));
+        }
+    }
+
+    pool.run((u32) paths.size(), [&](u32 task, u32) {
+        const std::vector<symbol_id>& map{ remap[lexed_by[task]] };
+        ret.files[task].tokens.remap_symbols([&](symbol_id id) { return map[id]; });
+        if (ret.files[task].compiled)
+            ret.files[task].compiled->move_symbols(map, ret.symbols);
+    });
+
+    return ret;
+}
+
+void report_failures(const project& proj, std::ostream& output)
+{
+    for (const project_file& file : proj.files)
+    {
+        if (!file.diagnostics.has_errors())
+            continue;
+
+        output << file.path.string() << ": ";
+        if (!file.opened)
+        {
+            output << file.diagnostics.errors().front().what() << std::endl;
+            continue;
+        }
+
+        output << std::endl;
+        file.diagnostics.format(file.text.text(), file.lines, output);
+    }
+
+    for (const project_file& file : proj.files)
+    {
+        if (file.compiled && file.compiled->diagnostics().has_errors())
+        {
+            output << file.path.string() << ": " << std::endl;
+            file.compiled->format_diagnostics(output);
+        }
+    }
+}
+
+} // namespace ptl
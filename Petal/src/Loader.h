@@ -0,0 +1,79 @@
+﻿//  ------------------------------------------------------------------------------
+//
+//  Petal
+//     Copyright 2023 Matthew Rogers
+//
+//     Licensed under the Apache License, Version 2.0 (the "License");
+//     you may not use this file except in compliance with the License.
+//     You may obtain a copy of the License at
+//
+//         http://www.apache.org/licenses/LICENSE-2.0
+//
+//     Unless required by applicable law or agreed to in writing, software
+//     distributed under the License is distributed on an "AS IS" BASIS,
+//     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//     See the License for the specific language governing permissions and
+//     limitations under the License.
+//
+//  File Name: Loader.h
+//  Date File Created: 10/17/2026
+//  Author: Matt
+//
+//  ------------------------------------------------------------------------------
+
+#pragma once
+
+#include "Common.h"
+#include "Debug/Errors.h"
+#include "LineIndex.h"
+#include "ModuleCache.h"
+#include "Script.h"
+#include "Source.h"
+#include "SymbolTable.h"
+#include "TokenBuffer.h"
+#include "Util/ThreadPool.h"
+
+#include <filesystem>
+#include <optional>
+#include <ostream>
+#include <span>
+#include <vector>
+
+namespace ptl
+{
+
+struct project_file
+{
+    std::filesystem::path path{};
+    source                text{};
+    line_index                  lines{};
+    std::optional<module_image> image{}; // from the cache, tokens and compiled refer to it
+    token_buffer                tokens{};
+    error::diagnostics          diagnostics{};
+    bool                        opened{};
+    bool                        cached{};   // the tokens came from a module image instead of the lexer
+    scope<script>               compiled{}; // only when the project is compiled and the file lexed without errors
+};
+
+// Every file of a project, lexed against one shared symbol table
+struct project
+{
+    symbol_table              symbols{};
+    std::vector<project_file> files{};
+};
+
+// Maps and tokenizes all files in parallel on pool. Each worker interns into its own symbol table and the tables are
+// merged afterwards in file order, so symbol ids and the order of failures don't depend on scheduling. With a cache,
+// a file whose image is there is not lexed at all, and every file that lexed without errors gets an image. With
+// compile options every file that lexed without errors is also compiled as a script by the same task, from its tokens
+// and moved over to the merged table with them. Bodies those scripts compile later intern into the project's table,
+// so they must not be compiled from several threads at once. With both, the image also gets the expression trees and,
+// when compile_options::strict has every body compiled up front, the code. A file whose image has code is neither
+// lexed nor compiled
+[[nodiscard]] project load_project(std::span<const std::filesystem::path> paths, utl::thread_pool& pool,
+                                   const module_cache* cache = nullptr, const compile_options* compile = nullptr);
+
+// Writes the errors of every file, in the order the files were given
+void report_failures(const project& proj, std::ostream& output);
+
+} // namespace ptl
@@ -22,16 +22,139 @@
 //  ------------------------------------------------------------------------------
 
 #include "Common.h"
+#include <cstdio>
 #include <iostream>
-#include <sstream>
 
+#include "Loader.h"
+#include "ModuleCache.h"
+#include "Operations.h"
+#include "Script.h"
+#include "Source.h"
 #include "Tokens.h"
+#include "TokenStream.h"
+#include "VirtualMachine.h"
 #include "Debug/Errors.h"
 
 int main(int argc, char* argv[])
 {
     using namespace ptl;
 
+    // "-" lexes stdin as a stream, which keeps memory flat for huge generated scripts piped in
+    if(argc == 2 && std::string_view{ argv[1] } == "-")
+    {
+        symbol_table symbols{};
+        error::diagnostics diag{};
+        push_back_stream stream{ [](char* dst, size_t capacity) { return std::fread(dst, 1, capacity, stdin); } };
+        token_stream tokens{ stream, symbols, diag };
+        u64 count{ 0 };
+
+        for(; !tokens.is_eof(); tokens.next())
+        {
+            ++count;
+        }
+
+        // The text is gone by now, so errors are printed without the offending line
+        for(const error::error& err : diag.errors())
+        {
+            std::cerr << "(" << err.line_number() + 1 << ") " << err.what() << std::endl;
+        }
+        if(diag.has_errors())
+            return 1;
+
+        std::cout << "stdin: " << count << " tokens" << std::endl;
+        return 0;
+    }
+
+    // "--run file" runs a script and prints what its main function returns. Function bodies are compiled on their first
+    // call, "--run --strict file" compiles all of them before anything runs
+    if(argc > 2 && std::string_view{ argv[1] } == "--run")
+    {
+        const bool strict{ argc > 3 && std::string_view{ argv[2] } == "--strict" };
+        const char* path{ argv[strict ? 3 : 2] };
+        std::optional<source> text{ source::from_file(path) };
+        if(!text)
+        {
+            std::cerr << "Could not open " << path << std::endl;
+            return 1;
+        }
+
+        script scr{ std::move(*text), { strict } };
+        if(scr.diagnostics().has_errors())
+        {
+            scr.format_diagnostics(std::cerr);
+            return 1;
+        }
+
+        virtual_machine vm{ scr.code() };
+        scr.attach(vm);
+        try
+        {
+            vm.run(0);
+            if(const std::optional<u32> entry{ scr.find_function("main") })
+            {
+                const value result{ vm.run(*entry) };
+                if(result.is_string())
+                    std::cout << result.as_string()->text << std::endl;
+                else if(result.is_number())
+                    std::cout << ops::to_string(result.as_number()) << std::endl;
+            }
+        } catch(const error::error& err)
+        {
+            // A body that failed to compile on its first call has its errors in the diagnostics
+            scr.format_diagnostics(std::cerr);
+            std::cerr << "(" << err.line_number() + 1 << ") " << err.what() << std::endl;
+            return 1;
+        }
+
+        return 0;
+    }
+
+    // Files on the command line are loaded as one project, otherwise read lines interactively. "--cache dir" in front
+    // of the files keeps their module images in dir, "--compile" also compiles every file and "--strict" every function
+    // body of it up front. With a cache the expression trees are cached too, and with "--strict" the code, the count of
+    // expressions comes from those trees
+    if(argc > 1)
+    {
+        std::optional<module_cache> cache{};
+        std::optional<compile_options> compile{};
+        i32 first{ 1 };
+        for(; first < argc; ++first)
+        {
+            const std::string_view arg{ argv[first] };
+            if(arg == "--cache" && first + 1 < argc)
+                cache.emplace(argv[++first]);
+            else if(arg == "--compile" || arg == "--strict")
+            {
+                compile = compile.value_or(compile_options{});
+                compile->strict = compile->strict || arg == "--strict";
+            }
+            else
+                break;
+        }
+
+        const std::vector<std::filesystem::path> paths{ argv + first, argv + argc };
+        utl::thread_pool pool{};
+        const project proj{ load_project(paths, pool, cache ? &*cache : nullptr, compile ? &*compile : nullptr) };
+
+        for(const project_file& file : proj.files)
+        {
+            if(file.diagnostics.has_errors() || (file.compiled && file.compiled->diagnostics().has_errors()))
+                continue;
+
+            std::cout << file.path.string() << ": " << file.tokens.size() << " tokens";
+            if(file.compiled)
+            {
+                std::cout << ", " << file.compiled->code().functions.size() - 1 << " functions";
+                if(!file.compiled->tree().roots().empty())
+                    std::cout << ", " << file.compiled->tree().roots().size() << " expressions";
+            }
+            std::cout << (file.cached ? " (cached)" : "") << std::endl;
+        }
+        report_failures(proj, std::cerr);
+
+        return 0;
+    }
+
     std::cerr << "Petal> " << std::endl;
     std::string line{};
 
@@ -42,31 +165,25 @@ int main(int argc, char* argv[])
         std::getline(std::cin, line);
         if(!line.empty())
         {
-            std::istringstream iss{line};
-            get_character input { [&iss] {
-                return iss.get();
-            } };
+            const source src{ source::from_view(line) };
 
-            try
-            {
-                push_back_stream stream{input};
-                for(token tk { tokenize(stream) }; !tk.is_eof(); tk = tokenize(stream))
-                {
-                    if(tk.is_reserved_token())
-                        std::cout << "Reserved: " << tk.reserved_token() << std::endl;
-                    else if(tk.is_identifier())
-                        std::cout << "Identifier: " << tk.identifier() << std::endl;
-                    else if(tk.is_number())
-                        std::cout << "Number: " << tk.number() << std::endl;
-                    else if(tk.is_string())
-                        std::cout << "String: " << tk.string() << std::endl;
-                }
-            }catch(const error::error& err)
+            symbol_table symbols{};
+            error::diagnostics diag{};
+            push_back_stream stream{src};
+            token_stream tokens{ stream, symbols, diag };
+            while(!tokens.is_eof())
             {
-                iss.clear();
-                iss.seekg(0);
-                error::format(err, input, std::cerr);
+                const token tk{ tokens.next() };
+                if(tk.is_reserved_token())
+                    std::cout << "Reserved: " << tk.reserved_token() << std::endl;
+                else if(tk.is_identifier())
+                    std::cout << "Identifier: " << symbols.name(tk.identifier()) << std::endl;
+                else if(tk.is_number())
+                    std::cout << "Number: " << tk.number() << std::endl;
+                else if(tk.is_string())
+                    std::cout << "String: " << symbols.name(tk.string()) << std::endl;
             }
+            diag.format(src.text(), line_index{ src.text() }, std::cerr);
         }
     }while(!line.empty());
 
@@ -0,0 +1,642 @@
+﻿//  ------------------------------------------------------------------------------
+//
+//  Petal
+//     Copyright 2023 Matthew Rogers
+//
+//     Licensed under the Apache License, Version 2.0 (the "License");
+//     you may not use this file except in compliance with the License.
+//     You may obtain a copy of the License at
+//
+//         http://www.apache.org/licenses/LICENSE-2.0
+//
+//     Unless required by applicable law or agreed to in writing, software
+//     distributed under the License is distributed on an "AS IS" BASIS,
+//     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//     See the License for the specific language governing permissions and
+//     limitations under the License.
+//
+//  File Name: ModuleCache.cpp
+//  Date File Created: 10/17/2026
+//  Author: Matt
+//
+//  ------------------------------------------------------------------------------
+
+#include "ModuleCache.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cassert>
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <span>
+#include <string>
+#include <system_error>
+#include <type_traits>
+
+namespace ptl
+{
+namespace
+{
+
+constexpr u32 image_magic{ 0x434C5450 }; // "PTLC" as a little endian file reads it, a byte swapped machine won't match
+
+enum struct section_id : u32
+{
+    strings, // every symbol name, function name and string constant, the other sections point into it
+    symbols,
+    token_kinds,
+    token_offsets,
+    token_lengths,
+    token_payloads,
+    token_numbers,
+    tree_kinds,
+    tree_operations,
+    tree_child_counts,
+    tree_payloads,
+    tree_child_list,
+    tree_numbers,
+    tree_line_numbers,
+    tree_char_indices,
+    tree_type_ids,
+    tree_lvalues,
+    tree_roots,
+    types,
+    type_params,
+    functions,
+    code,
+    code_lines,
+    code_numbers,
+    code_strings,
+};
+
+constexpr u32 image_section_count{ (u32) section_id::code_strings + 1 };
+
+// A range of the strings section. The code's strings are handed out as they are, the section is their string_pool
+using image_string = string_range;
+
+enum struct image_type_kind : u32
+{
+    simple,   // inner is the simple_type
+    array,    // inner is the element type
+    function, // inner is the return type
+};
+
+// Types refer to types before them, so they can be interned front to back
+struct image_type
+{
+    image_type_kind kind{};
+    u32             inner{};
+    u32             first_param{};
+    u32             param_count{};
+};
+
+struct image_param
+{
+    u32 type{};
+    u32 by_ref{};
+};
+
+struct image_function
+{
+    image_string name{};
+    u32          param_count{};
+    u32          frame_size{};
+    u32          first_instruction{}; // also the first entry of code_lines
+    u32          instruction_count{};
+    u32          first_number{};
+    u32          number_count{};
+    u32          first_string{};
+    u32          string_count{};
+};
+
+struct image_section
+{
+    u64 offset{};
+    u64 size{}; // in bytes
+};
+
+struct image_header
+{
+    u32                                            magic{};
+    u32                                            version{};
+    u64                                            key{};
+    u32                                            global_count{};
+    u32                                            section_count{};
+    std::array<image_section, image_section_count> sections{};
+};
+
+static_assert(std::is_trivially_copyable_v<image_header> && sizeof(image_header) % 8 == 0);
+static_assert(std::is_trivially_copyable_v<instruction>);
+
+// Element size of every section
+constexpr std::array<u32, image_section_count> element_sizes{ [] {
+    std::array<u32, image_section_count> ret{};
+
+    const auto set = [&](section_id id, u32 size) { ret[(u32) id] = size; };
+
+    set(section_id::strings, sizeof(char));
+    set(section_id::symbols, sizeof(image_string));
+    set(section_id::token_kinds, sizeof(token_kind));
+    set(section_id::token_offsets, sizeof(u32));
+    set(section_id::token_lengths, sizeof(u32));
+    set(section_id::token_payloads, sizeof(u32));
+    set(section_id::token_numbers, sizeof(f64));
+    set(section_id::tree_kinds, sizeof(flat_kind));
+    set(section_id::tree_operations, sizeof(node_operation));
+    set(section_id::tree_child_counts, sizeof(u32));
+    set(section_id::tree_payloads, sizeof(u32));
+    set(section_id::tree_child_list, sizeof(flat_index));
+    set(section_id::tree_numbers, sizeof(f64));
+    set(section_id::tree_line_numbers, sizeof(u32));
+    set(section_id::tree_char_indices, sizeof(u32));
+    set(section_id::tree_type_ids, sizeof(type_handle));
+    set(section_id::tree_lvalues, sizeof(u8));
+    set(section_id::tree_roots, sizeof(flat_index));
+    set(section_id::types, sizeof(image_type));
+    set(section_id::type_params, sizeof(image_param));
+    set(section_id::functions, sizeof(image_function));
+    set(section_id::code, sizeof(instruction));
+    set(section_id::code_lines, sizeof(u32));
+    set(section_id::code_numbers, sizeof(f64));
+    set(section_id::code_strings, sizeof(image_string));
+
+    return ret;
+}() };
+
+constexpr u64 section_alignment{ 8 };
+
+template<typename T>
+std::span<const T> as_span(std::string_view bytes)
+{
+    return { (const T*) bytes.data(), bytes.size() / sizeof(T) };
+}
+
+u64 mix(u64 x)
+{
+    x ^= x >> 32;
+    x *= 0xD6E8FEB86659FD93ull;
+    x ^= x >> 32;
+    x *= 0xD6E8FEB86659FD93ull;
+    x ^= x >> 32;
+    return x;
+}
+
+// Four independent lanes of 8 bytes each, so the multiply of one word doesn't wait for the one before it
+u64 hash_text(std::string_view text)
+{
+    constexpr u64 prime{ 0x9E3779B97F4A7C15ull };
+
+    std::array<u64, 4> lanes{ prime, prime * 3, prime * 5, prime * 7 };
+    size_t             pos{ 0 };
+    for (; pos + 32 <= text.size(); pos += 32)
+    {
+        for (u32 i{ 0 }; i < 4; ++i)
+        {
+            u64 word{};
+            std::memcpy(&word, text.data() + pos + i * 8, 8);
+            lanes[i] = std::rotl(lanes[i] ^ (word * prime), 29) * 0xBF58476D1CE4E5B9ull;
+        }
+    }
+
+    u64 ret{ mix(lanes[0]) ^ std::rotl(mix(lanes[1]), 16) ^ std::rotl(mix(lanes[2]), 32) ^ std::rotl(mix(lanes[3]), 48) };
+    for (; pos < text.size(); ++pos)
+    {
+        ret = symbol_table::hash_step(ret, text[pos]);
+    }
+
+    return mix(ret ^ text.size());
+}
+
+std::string to_hex(u64 value)
+{
+    std::string ret(16, '0');
+    for (u32 i{ 0 }; i < 16; ++i)
+    {
+        ret[15 - i] = "0123456789abcdef"[(value >> (i * 4)) & 0xF];
+    }
+    return ret;
+}
+
+// Lays out one image: sections are appended as they are put, the header goes in front once they are all there.
+// Symbols and types are renumbered on the way in, so an image only carries what its own source uses
+class image_builder
+{
+public:
+    image_builder(const symbol_table& symbols, const type_registry* types) :
+        m_symbols{ symbols }, m_local_symbols(symbols.size(), unmapped)
+    {
+        m_bytes.resize(sizeof(image_header));
+
+        // The fixed types keep their ids
+        m_types.push_back({ image_type_kind::simple, (u32) simple_type::nothing });
+        m_types.push_back({ image_type_kind::simple, (u32) simple_type::number });
+        m_types.push_back({ image_type_kind::simple, (u32) simple_type::string });
+        if (types)
+        {
+            m_local_types.resize(types->size(), unmapped);
+            for (u32 i{ 0 }; i < (u32) m_types.size(); ++i)
+            {
+                m_local_types[i] = i;
+            }
+        }
+    }
+
+    template<typename T>
+    void put(section_id id, std::span<const T> data)
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        assert(sizeof(T) == element_sizes[(u32) id]);
+
+        m_bytes.resize((m_bytes.size() + section_alignment - 1) & ~(section_alignment - 1));
+        m_header.sections[(u32) id] = { m_bytes.size(), data.size_bytes() };
+        m_bytes.insert(m_bytes.end(), (const char*) data.data(), (const char*) data.data() + data.size_bytes());
+    }
+
+    template<typename T>
+    void put(section_id id, const std::vector<T>& data)
+    {
+        put(id, std::span<const T>{ data });
+    }
+
+    image_string add_string(std::string_view str)
+    {
+        const image_string ret{ (u32) m_strings.size(), (u32) str.size() };
+        m_strings.insert(m_strings.end(), str.begin(), str.end());
+        return ret;
+    }
+
+    symbol_id local_symbol(symbol_id id)
+    {
+        if (m_local_symbols[id] == unmapped)
+        {
+            m_local_symbols[id] = (symbol_id) m_symbol_names.size();
+            m_symbol_names.push_back(add_string(m_symbols.name(id)));
+        }
+        return m_local_symbols[id];
+    }
+
+    // Image index of t, after the types it is built from
+    u32 local_type(const type_registry& types, type_handle t)
+    {
+        if (m_local_types[(u32) t] != unmapped)
+            return m_local_types[(u32) t];
+
+        image_type entry{};
+        std::visit(overloaded{ [&](const simple_type val) { entry = { image_type_kind::simple, (u32) val }; },
+                               [&](const array_type& val) {
+                                   entry = { image_type_kind::array, local_type(types, val.inner_type_id) };
+                               },
+                               [&](const function_type& val) {
+                                   // Parameter types may add parameters of their own, so this list is written last
+                                   std::vector<image_param> params{};
+                                   for (const function_type::parameter& param : val.parameter_type_id)
+                                   {
+                                       params.push_back({ local_type(types, param.type_id), param.by_ref });
+                                   }
+
+                                   entry = { image_type_kind::function, local_type(types, val.return_type_id),
+                                             (u32) m_params.size(), (u32) params.size() };
+                                   m_params.insert(m_params.end(), params.begin(), params.end());
+                               } },
+                   types.get(t));
+
+        m_local_types[(u32) t] = (u32) m_types.size();
+        m_types.push_back(entry);
+        return m_local_types[(u32) t];
+    }
+
+    void add_tokens(const token_buffer& tokens)
+    {
+        std::vector<u32> payloads{ tokens.payloads().begin(), tokens.payloads().end() };
+        for (u32 i{ 0 }; i < tokens.size(); ++i)
+        {
+            if (tokens.kind(i) == token_kind::identifier || tokens.kind(i) == token_kind::string)
+                payloads[i] = local_symbol(tokens.get_symbol(i));
+        }
+
+        put(section_id::token_kinds, tokens.kinds());
+        put(section_id::token_offsets, tokens.offsets());
+        put(section_id::token_lengths, tokens.lengths());
+        put(section_id::token_payloads, payloads);
+        put(section_id::token_numbers, tokens.numbers());
+    }
+
+    // Image symbol of the name id has in symbols, which the tree was built against. Names the tokens have too share
+    // their image symbol
+    symbol_id local_symbol(const symbol_table& symbols, symbol_id id)
+    {
+        if (&symbols == &m_symbols)
+            return local_symbol(id);
+
+        if (id >= m_tree_symbols.size())
+            m_tree_symbols.resize(symbols.size(), unmapped);
+        if (m_tree_symbols[id] == unmapped)
+        {
+            const std::string_view name{ symbols.name(id) };
+            if (const std::optional found{ m_symbols.find(name) })
+                m_tree_symbols[id] = local_symbol(*found);
+            else
+            {
+                m_tree_symbols[id] = (symbol_id) m_symbol_names.size();
+                m_symbol_names.push_back(add_string(name));
+            }
+        }
+        return m_tree_symbols[id];
+    }
+
+    void add_tree(const flat_tree& tree, const type_registry& types, const symbol_table& symbols)
+    {
+        const flat_arrays arrays{ tree.arrays() };
+
+        std::vector<u32>         payloads{ arrays.payloads.begin(), arrays.payloads.end() };
+        std::vector<type_handle> type_ids(tree.size());
+        for (flat_index i{ 0 }; i < tree.size(); ++i)
+        {
+            if (arrays.kinds[i] == flat_kind::identifier || arrays.kinds[i] == flat_kind::string)
+                payloads[i] = local_symbol(symbols, tree.get_symbol(i));
+            type_ids[i] = (type_handle) local_type(types, tree.type_id(i));
+        }
+
+        put(section_id::tree_kinds, arrays.kinds);
+        put(section_id::tree_operations, arrays.operations);
+        put(section_id::tree_child_counts, arrays.child_counts);
+        put(section_id::tree_payloads, payloads);
+        put(section_id::tree_child_list, arrays.child_list);
+        put(section_id::tree_numbers, arrays.numbers);
+        put(section_id::tree_line_numbers, arrays.line_numbers);
+        put(section_id::tree_char_indices, arrays.char_indices);
+        put(section_id::tree_type_ids, type_ids);
+        put(section_id::tree_lvalues, arrays.lvalues);
+        put(section_id::tree_roots, arrays.roots);
+    }
+
+    void add_code(const program& code)
+    {
+        std::vector<image_function> functions{};
+        std::vector<instruction>    instructions{};
+        std::vector<u32>            lines{};
+        std::vector<f64>            numbers{};
+        std::vector<image_string>   strings{};
+
+        for (const function_code& fn : code.functions)
+        {
+            assert(fn.lines.size() == fn.code.size());
+            functions.push_back({ add_string(fn.name), fn.param_count, fn.frame_size, (u32) instructions.size(),
+                                  (u32) fn.code.size(), (u32) numbers.size(), (u32) fn.numbers.size(), (u32) strings.size(),
+                                  (u32) fn.strings.size() });
+
+            instructions.insert(instructions.end(), fn.code.begin(), fn.code.end());
+            lines.insert(lines.end(), fn.lines.begin(), fn.lines.end());
+            numbers.insert(numbers.end(), fn.numbers.begin(), fn.numbers.end());
+            for (u32 i{ 0 }; i < (u32) fn.strings.size(); ++i)
+            {
+                strings.push_back(add_string(fn.string(i)));
+            }
+        }
+
+        m_header.global_count = code.global_count;
+        put(section_id::functions, functions);
+        put(section_id::code, instructions);
+        put(section_id::code_lines, lines);
+        put(section_id::code_numbers, numbers);
+        put(section_id::code_strings, strings);
+    }
+
+    bool write(const std::filesystem::path& path, u64 key)
+    {
+        // The tables filled while the other sections were added go last
+        put(section_id::symbols, m_symbol_names);
+        put(section_id::types, m_types);
+        put(section_id::type_params, m_params);
+        put(section_id::strings, m_strings);
+
+        m_header.magic         = image_magic;
+        m_header.version       = compiler_version;
+        m_header.key           = key;
+        m_header.section_count = image_section_count;
+        std::memcpy(m_bytes.data(), &m_header, sizeof(m_header));
+
+        std::ofstream file{ path, std::ios::binary | std::ios::trunc };
+        file.write(m_bytes.data(), (std::streamsize) m_bytes.size());
+        return file.good();
+    }
+
+private:
+    static constexpr u32 unmapped{ ~0u };
+
+    const symbol_table&       m_symbols;
+    image_header              m_header{};
+    std::vector<char>         m_bytes{};
+    std::vector<char>         m_strings{};
+    std::vector<symbol_id>    m_local_symbols{};
+    std::vector<symbol_id>    m_tree_symbols{}; // image symbols by the ids of a tree's own table
+    std::vector<image_string> m_symbol_names{};
+    std::vector<u32>          m_local_types{};
+    std::vector<image_type>   m_types{};
+    std::vector<image_param>  m_params{};
+};
+
+} // anonymous namespace
+
+u64 module_key(std::string_view text, u32 variant)
+{
+    return mix(hash_text(text) ^ ((((u64) variant << 32) | compiler_version) * 0x9E3779B97F4A7C15ull));
+}
+
+std::optional<module_image> module_image::open(const std::filesystem::path& path, u64 key)
+{
+    std::optional file{ source::from_file(path) };
+    if (!file || file->size() < sizeof(image_header))
+        return std::nullopt;
+
+    image_header header{};
+    std::memcpy(&header, file->data(), sizeof(header));
+    if (header.magic != image_magic || header.version != compiler_version || header.key != key ||
+        header.section_count != image_section_count)
+        return std::nullopt;
+
+    for (u32 i{ 0 }; i < image_section_count; ++i)
+    {
+        const image_section& s{ header.sections[i] };
+        if (s.offset % section_alignment != 0 || s.offset > file->size() || s.size > file->size() - s.offset ||
+            s.size % element_sizes[i] != 0)
+            return std::nullopt;
+    }
+
+    return module_image{ std::move(*file) };
+}
+
+bool module_image::write(const std::filesystem::path& path, u64 key, const module_contents& contents)
+{
+    if (contents.code)
+    {
+        for (const function_code& fn : contents.code->functions)
+        {
+            if (std::ranges::any_of(fn.code, [](const instruction& ins) { return ins.op == opcode::compile_lazy; }))
+                return false;
+        }
+    }
+
+    image_builder builder{ contents.symbols, contents.types };
+    builder.add_tokens(contents.tokens);
+    if (contents.tree)
+    {
+        assert(contents.types);
+        builder.add_tree(*contents.tree, *contents.types, contents.tree_symbols ? *contents.tree_symbols : contents.symbols);
+    }
+    if (contents.code)
+        builder.add_code(*contents.code);
+    return builder.write(path, key);
+}
+
+u32 module_image::symbol_count() const
+{
+    return (u32) as_span<image_string>(section((u32) section_id::symbols)).size();
+}
+
+std::string_view module_image::symbol(symbol_id id) const
+{
+    const image_string str{ as_span<image_string>(section((u32) section_id::symbols))[id] };
+    return section((u32) section_id::strings).substr(str.offset, str.length);
+}
+
+std::vector<symbol_id> module_image::intern_symbols(symbol_table& symbols) const
+{
+    std::vector<symbol_id> ret(symbol_count());
+    for (symbol_id id{ 0 }; id < (symbol_id) ret.size(); ++id)
+    {
+        ret[id] = symbols.intern(symbol(id));
+    }
+    return ret;
+}
+
+token_arrays module_image::tokens() const
+{
+    return { as_span<token_kind>(section((u32) section_id::token_kinds)),
+             as_span<u32>(section((u32) section_id::token_offsets)),
+             as_span<u32>(section((u32) section_id::token_lengths)),
+             as_span<u32>(section((u32) section_id::token_payloads)),
+             as_span<f64>(section((u32) section_id::token_numbers)) };
+}
+
+flat_arrays module_image::tree() const
+{
+    return { as_span<flat_kind>(section((u32) section_id::tree_kinds)),
+             as_span<node_operation>(section((u32) section_id::tree_operations)),
+             as_span<u32>(section((u32) section_id::tree_child_counts)),
+             as_span<u32>(section((u32) section_id::tree_payloads)),
+             as_span<flat_index>(section((u32) section_id::tree_child_list)),
+             as_span<f64>(section((u32) section_id::tree_numbers)),
+             as_span<u32>(section((u32) section_id::tree_line_numbers)),
+             as_span<u32>(section((u32) section_id::tree_char_indices)),
+             as_span<type_handle>(section((u32) section_id::tree_type_ids)),
+             as_span<u8>(section((u32) section_id::tree_lvalues)),
+             as_span<flat_index>(section((u32) section_id::tree_roots)) };
+}
+
+std::vector<type_handle> module_image::intern_types(type_registry& types) const
+{
+    const std::span<const image_type>  entries{ as_span<image_type>(section((u32) section_id::types)) };
+    const std::span<const image_param> params{ as_span<image_param>(section((u32) section_id::type_params)) };
+
+    std::vector<type_handle> ret(entries.size());
+    for (u32 i{ 0 }; i < (u32) entries.size(); ++i)
+    {
+        const image_type& entry{ entries[i] };
+        switch (entry.kind)
+        {
+        case image_type_kind::simple: ret[i] = types.get_handle((simple_type) entry.inner); break;
+        case image_type_kind::array: ret[i] = types.get_handle(array_type{ ret[entry.inner] }); break;
+        case image_type_kind::function:
+        {
+            function_type ft{ ret[entry.inner] };
+            for (const image_param& param : params.subspan(entry.first_param, entry.param_count))
+            {
+                ft.parameter_type_id.push_back({ ret[param.type], param.by_ref != 0 });
+            }
+            ret[i] = types.get_handle(ft);
+            break;
+        }
+        }
+    }
+
+    return ret;
+}
+
+bool module_image::has_code() const
+{
+    return !section((u32) section_id::functions).empty();
+}
+
+program module_image::load_program() const
+{
+    const std::span<const image_function> functions{ as_span<image_function>(section((u32) section_id::functions)) };
+    const std::span<const instruction>    instructions{ as_span<instruction>(section((u32) section_id::code)) };
+    const std::span<const u32>            lines{ as_span<u32>(section((u32) section_id::code_lines)) };
+    const std::span<const f64>            numbers{ as_span<f64>(section((u32) section_id::code_numbers)) };
+    const std::span<const image_string>   strings{ as_span<image_string>(section((u32) section_id::code_strings)) };
+    const std::string_view                text{ section((u32) section_id::strings) };
+
+    program ret{};
+    std::memcpy(&ret.global_count, m_file.data() + offsetof(image_header, global_count), sizeof(u32));
+    ret.functions.resize(functions.size());
+
+    for (u32 i{ 0 }; i < (u32) functions.size(); ++i)
+    {
+        const image_function& src{ functions[i] };
+        function_code&        dst{ ret.functions[i] };
+
+        dst.name        = text.substr(src.name.offset, src.name.length);
+        dst.param_count = src.param_count;
+        dst.frame_size  = src.frame_size;
+
+        dst.code        = instructions.subspan(src.first_instruction, src.instruction_count);
+        dst.lines       = lines.subspan(src.first_instruction, src.instruction_count);
+        dst.numbers     = numbers.subspan(src.first_number, src.number_count);
+        dst.strings     = strings.subspan(src.first_string, src.string_count);
+        dst.string_pool = text;
+    }
+
+    return ret;
+}
+
+std::string_view module_image::section(u32 id) const
+{
+    image_section s{};
+    std::memcpy(&s, m_file.data() + offsetof(image_header, sections) + id * sizeof(image_section), sizeof(s));
+    return m_file.text().substr(s.offset, s.size);
+}
+
+module_cache::module_cache(std::filesystem::path directory) : m_directory{ std::move(directory) }
+{
+    // If the directory can't be created every store fails, which only means nothing is cached
+    std::error_code ec{};
+    std::filesystem::create_directories(m_directory, ec);
+}
+
+std::filesystem::path module_cache::path(u64 key) const
+{
+    return m_directory / (to_hex(key) + ".ptlc");
+}
+
+bool module_cache::store(u64 key, const module_contents& contents) const
+{
+    const std::filesystem::path target{ path(key) };
+    std::filesystem::path       temp{ target };
+    temp += "." + to_hex(((u64) std::random_device{}() << 32) | std::random_device{}()) + ".tmp";
+
+    std::error_code ec{};
+    if (module_image::write(temp, key, contents))
+        std::filesystem::rename(temp, target, ec);
+    else
+        ec = std::make_error_code(std::errc::io_error);
+
+    if (ec)
+        std::filesystem::remove(temp, ec);
+    return !ec;
+}
+
+} // namespace ptl
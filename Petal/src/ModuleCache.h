@@ -0,0 +1,123 @@
+﻿//  ------------------------------------------------------------------------------
+//
+//  Petal
+//     Copyright 2023 Matthew Rogers
+//
+//     Licensed under the Apache License, Version 2.0 (the "License");
+//     you may not use this file except in compliance with the License.
+//     You may obtain a copy of the License at
+//
+//         http://www.apache.org/licenses/LICENSE-2.0
+//
+//     Unless required by applicable law or agreed to in writing, software
+//     distributed under the License is distributed on an "AS IS" BASIS,
+//     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//     See the License for the specific language governing permissions and
+//     limitations under the License.
+//
+//  File Name: ModuleCache.h
+//  Date File Created: 10/17/2026
+//  Author: Matt
+//
+//  ------------------------------------------------------------------------------
+
+#pragma once
+
+#include "Common.h"
+#include "Bytecode.h"
+#include "FlatTree.h"
+#include "Source.h"
+#include "SymbolTable.h"
+#include "TokenBuffer.h"
+#include "Types.h"
+
+#include <filesystem>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+namespace ptl
+{
+
+// Part of every cache key. Bump it whenever the lexer, the parser, the type checker, the compiler or the image layout
+// changes what ends up in an image, every image written before then stops matching
+inline constexpr u32 compiler_version{ 1 };
+
+// Content address of a source: a hash of all of text, its size and compiler_version. variant tells apart images of one
+// text that hold different things, like compiles with different options
+[[nodiscard]] u64 module_key(std::string_view text, u32 variant = 0);
+
+// What is cached for one source. tree and code are optional, types is needed with tree. Symbol ids and type handles
+// are those of symbols and types, the image gets a compact numbering of its own. A tree built against another table
+// than the tokens, like a script's, names it in tree_symbols. code must not hold compile_lazy stubs, an image has no
+// source to compile them from
+struct module_contents
+{
+    const symbol_table&  symbols;
+    const token_buffer&  tokens;
+    const flat_tree*     tree{};
+    const type_registry* types{};
+    const symbol_table*  tree_symbols{};
+    const program*       code{};
+};
+
+// A cached compile of one source, mapped read-only. The file is position independent: every section is an array at an
+// 8-byte aligned offset and sections refer to each other by index, never by pointer, so the accessors hand out spans
+// straight into the mapping and nothing is deserialized. Symbol ids in the tokens and the tree are image local, from 0
+// to symbol_count(), and so are the tree's type handles, intern_types maps those to a registry
+class module_image
+{
+public:
+    // nullopt when path is missing, was written for another key or compiler_version, or its sections don't fit the
+    // file. Only the header is checked so opening stays O(1), the rest is trusted: images are only ever renamed into
+    // place complete, see module_cache
+    [[nodiscard]] static std::optional<module_image> open(const std::filesystem::path& path, u64 key);
+
+    // Writes contents to path, false on I/O errors or when the code has a compile_lazy stub
+    static bool write(const std::filesystem::path& path, u64 key, const module_contents& contents);
+
+    [[nodiscard]] u32              symbol_count() const;
+    [[nodiscard]] std::string_view symbol(symbol_id id) const;
+
+    // Id in symbols of every symbol of the image, indexed by the image's ids
+    [[nodiscard]] std::vector<symbol_id> intern_symbols(symbol_table& symbols) const;
+
+    [[nodiscard]] token_arrays tokens() const;
+    [[nodiscard]] flat_arrays  tree() const;
+
+    // Handle in types of every type the tree refers to, indexed by the tree's type ids
+    [[nodiscard]] std::vector<type_handle> intern_types(type_registry& types) const;
+
+    [[nodiscard]] bool has_code() const;
+
+    // The code as it is in the mapping, only the function names are copied. The image must outlive the program. Empty
+    // when no code was cached
+    [[nodiscard]] program load_program() const;
+
+private:
+    explicit module_image(source file) : m_file{ std::move(file) } {}
+
+    [[nodiscard]] std::string_view section(u32 id) const;
+
+    source m_file{}; // the mapping
+};
+
+// A directory of module images, each named after its key. Images are written to a temporary file first and then
+// renamed into place, so readers never see half an image and processes compiling the same source at once are harmless
+class module_cache
+{
+public:
+    explicit module_cache(std::filesystem::path directory);
+
+    [[nodiscard]] std::filesystem::path path(u64 key) const;
+
+    [[nodiscard]] std::optional<module_image> open(u64 key) const { return module_image::open(path(key), key); }
+
+    // False when the image could not be written, which only costs the next run a recompile
+    bool store(u64 key, const module_contents& contents) const;
+
+private:
+    std::filesystem::path m_directory{};
+};
+
+} // namespace ptl
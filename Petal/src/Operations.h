@@ -0,0 +1,104 @@
+﻿//  ------------------------------------------------------------------------------
+//
+//  Petal
+//     Copyright 2023 Matthew Rogers
+//
+//     Licensed under the Apache License, Version 2.0 (the "License");
+//     you may not use this file except in compliance with the License.
+//     You may obtain a copy of the License at
+//
+//         http://www.apache.org/licenses/LICENSE-2.0
+//
+//     Unless required by applicable law or agreed to in writing, software
+//     distributed under the License is distributed on an "AS IS" BASIS,
+//     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//     See the License for the specific language governing permissions and
+//     limitations under the License.
+//
+//  File Name: Operations.h
+//  Date File Created: 10/17/2026
+//  Author: Matt
+//
+//  ------------------------------------------------------------------------------
+
+#pragma once
+
+#include "Common.h"
+
+#include <charconv>
+#include <cmath>
+#include <limits>
+#include <string>
+
+// Runtime meaning of Petal's number operators. Constant folding and the VM both use these, so a folded expression
+// always has the value it would have had at runtime
+namespace ptl::ops
+{
+
+// Integer view of a number for the bitwise operators, NaN becomes 0 and out of range values saturate
+inline i64 to_integer(f64 value)
+{
+    if (std::isnan(value))
+        return 0;
+    if (value >= 9223372036854775807.0)
+        return std::numeric_limits<i64>::max();
+    if (value <= -9223372036854775808.0)
+        return std::numeric_limits<i64>::min();
+    return (i64) value;
+}
+
+inline bool truth(f64 value)
+{
+    return value != 0.0;
+}
+
+inline f64 idiv(f64 a, f64 b)
+{
+    return std::trunc(a / b);
+}
+
+inline f64 mod(f64 a, f64 b)
+{
+    return std::fmod(a, b);
+}
+
+inline f64 band(f64 a, f64 b)
+{
+    return (f64) (to_integer(a) & to_integer(b));
+}
+
+inline f64 bor(f64 a, f64 b)
+{
+    return (f64) (to_integer(a) | to_integer(b));
+}
+
+inline f64 bxor(f64 a, f64 b)
+{
+    return (f64) (to_integer(a) ^ to_integer(b));
+}
+
+inline f64 bnot(f64 a)
+{
+    return (f64) ~to_integer(a);
+}
+
+// Shift counts use their low 6 bits, >> is arithmetic
+inline f64 bsl(f64 a, f64 b)
+{
+    return (f64) (i64) ((u64) to_integer(a) << (to_integer(b) & 63));
+}
+
+inline f64 bsr(f64 a, f64 b)
+{
+    return (f64) (to_integer(a) >> (to_integer(b) & 63));
+}
+
+// Shortest text that reads back as the same number, used when a number is converted to a string
+inline std::string to_string(f64 value)
+{
+    char buffer[32];
+    const auto [end, ec]{ std::to_chars(buffer, buffer + sizeof(buffer), value) };
+    return { buffer, end };
+}
+
+} // namespace ptl::ops
@@ -0,0 +1,385 @@
+﻿//  ------------------------------------------------------------------------------
+//
+//  Petal
+//     Copyright 2023 Matthew Rogers
+//
+//     Licensed under the Apache License, Version 2.0 (the "License");
+//     you may not use this file except in compliance with the License.
+//     You may obtain a copy of the License at
+//
+//         http://www.apache.org/licenses/LICENSE-2.0
+//
+//     Unless required by applicable law or agreed to in writing, software
+//     distributed under the License is distributed on an "AS IS" BASIS,
+//     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//     See the License for the specific language governing permissions and
+//     limitations under the License.
+//
+//  File Name: Parser.cpp
+//  Date File Created: 10/17/2026
+//  Author: Matt
+//
+//  ------------------------------------------------------------------------------
+
+#include "Parser.h"
+#include "Debug/Errors.h"
+
+#include <array>
+#include <sstream>
+
+namespace ptl
+{
+namespace
+{
+
+// Binding powers, higher binds tighter. Prefix operators bind tighter than every binary operator, and the postfix
+// ones (++, --, calls and indexing) tighter still, so they are handled outside the table
+enum precedence : u8
+{
+    none,
+    comma,
+    assignment,
+    ternary,
+    logical_or,
+    logical_and,
+    bitwise_or,
+    bitwise_xor,
+    bitwise_and,
+    equality,
+    comparison,
+    shift,
+    additive,
+    multiplicative,
+    prefix,
+};
+
+struct binary_operator
+{
+    node_operation operation{};
+    u8             precedence{ none };
+    bool           right_associative{};
+};
+
+constexpr u32 reserved_token_count{ (u32) reserved_token::kw_string + 1 };
+
+constexpr std::array<binary_operator, reserved_token_count> binary_operators{ [] {
+    std::array<binary_operator, reserved_token_count> ret{};
+
+    const auto set = [&](reserved_token tk, node_operation operation, u8 prec, bool right_associative = false) {
+        ret[(u32) tk] = { operation, prec, right_associative };
+    };
+
+    set(reserved_token::comma, node_operation::comma, comma);
+
+    set(reserved_token::assign, node_operation::assign, assignment, true);
+    set(reserved_token::add_assign, node_operation::add_assign, assignment, true);
+    set(reserved_token::sub_assign, node_operation::sub_assign, assignment, true);
+    set(reserved_token::concat_assign, node_operation::concat_assign, assignment, true);
+    set(reserved_token::mul_assign, node_operation::mul_assign, assignment, true);
+    set(reserved_token::div_assign, node_operation::div_assign, assignment, true);
+    set(reserved_token::idiv_assign, node_operation::idiv_assign, assignment, true);
+    set(reserved_token::mod_assign, node_operation::mod_assign, assignment, true);
+    set(reserved_token::and_assign, node_operation::band_assign, assignment, true);
+    set(reserved_token::or_assign, node_operation::bor_assign, assignment, true);
+    set(reserved_token::xor_assign, node_operation::bxor_assign, assignment, true);
+    set(reserved_token::shiftl_assign, node_operation::bsl_assign, assignment, true);
+    set(reserved_token::shiftr_assign, node_operation::bsr_assign, assignment, true);
+
+    set(reserved_token::question, node_operation::ternary, ternary, true);
+
+    set(reserved_token::logical_or, node_operation::lor, logical_or);
+    set(reserved_token::logical_and, node_operation::land, logical_and);
+    set(reserved_token::bitwise_or, node_operation::bor, bitwise_or);
+    set(reserved_token::bitwise_xor, node_operation::bxor, bitwise_xor);
+    set(reserved_token::bitwise_and, node_operation::band, bitwise_and);
+
+    set(reserved_token::eq, node_operation::eq, equality);
+    set(reserved_token::ne, node_operation::ne, equality);
+    set(reserved_token::lt, node_operation::lt, comparison);
+    set(reserved_token::gt, node_operation::gt, comparison);
+    set(reserved_token::le, node_operation::le, comparison);
+    set(reserved_token::ge, node_operation::ge, comparison);
+
+    set(reserved_token::shiftl, node_operation::bsl, shift);
+    set(reserved_token::shiftr, node_operation::bsr, shift);
+
+    set(reserved_token::add, node_operation::add, additive);
+    set(reserved_token::sub, node_operation::sub, additive);
+    set(reserved_token::concat, node_operation::concat, additive);
+
+    set(reserved_token::mul, node_operation::mul, multiplicative);
+    set(reserved_token::div, node_operation::div, multiplicative);
+    set(reserved_token::idiv, node_operation::idiv, multiplicative);
+    set(reserved_token::mod, node_operation::mod, multiplicative);
+
+    return ret;
+}() };
+
+static_assert(binary_operators[(u32) reserved_token::mul].precedence > binary_operators[(u32) reserved_token::add].precedence);
+static_assert(binary_operators[(u32) reserved_token::assign].right_associative);
+static_assert(binary_operators[(u32) reserved_token::semicolon].precedence == none);
+
+bool is_token(const token& tk, reserved_token expected)
+{
+    return tk.is_reserved_token() && tk.reserved_token() == expected;
+}
+
+// Where the parser resumes after an error
+bool ends_statement(const token& tk)
+{
+    return tk.is_eof() || is_token(tk, reserved_token::semicolon) || is_token(tk, reserved_token::close_curly);
+}
+
+class parser
+{
+public:
+    parser(compiler_context& context, token_stream& tokens) : m_context{ context }, m_tokens{ tokens } {}
+
+    node_ptr parse(u8 min_precedence, bool allow_comma);
+
+private:
+    node_ptr parse_prefix();
+    node_ptr parse_postfix(node_ptr operand);
+    node_ptr parse_call(node_ptr callee, const token& open);
+
+    // Reports tk, skips to the end of the statement and returns a placeholder for the missing operand. Only the first
+    // error of an expression is reported, the diagnostics stay muted until parse_expression is done with it, so
+    // whatever the placeholder leads to is not reported either
+    node_ptr fail(const token& tk);
+
+    void expect(reserved_token expected)
+    {
+        if (!m_tokens.match(expected))
+            fail(m_tokens.peek());
+    }
+
+    node_ptr make(node::node_v value, std::initializer_list<node_ptr> children, u32 line_number, u32 char_index)
+    {
+        return node::create(m_context, std::move(value), children, line_number, char_index);
+    }
+
+    node_ptr make(node::node_v value, std::initializer_list<node_ptr> children, const token& at)
+    {
+        return make(std::move(value), children, at.line_number(), at.char_index());
+    }
+
+    // Node with the children pushed onto the scratch stack since base, which are popped again
+    node_ptr make_from_scratch(node::node_v value, size_t base, const token& at)
+    {
+        const std::span<const node_ptr> children{ m_scratch.data() + base, m_scratch.size() - base };
+        const node_ptr ret{ node::create(m_context, std::move(value), children, at.line_number(), at.char_index()) };
+        m_scratch.resize(base);
+        return ret;
+    }
+
+    compiler_context&     m_context;
+    token_stream&         m_tokens;
+    // Children of the comma lists and calls being parsed, shared by the nested ones so lists need no allocation
+    std::vector<node_ptr> m_scratch{};
+    bool                  m_failed{};
+};
+
+node_ptr parser::parse(u8 min_precedence, bool allow_comma)
+{
+    node_ptr lhs{ parse_prefix() };
+
+    while (true)
+    {
+        const token& tk{ m_tokens.peek() };
+        if (!tk.is_reserved_token())
+            break;
+
+        const binary_operator op{ binary_operators[(u32) tk.reserved_token()] };
+        if (op.precedence == none || op.precedence < min_precedence || (op.operation == node_operation::comma && !allow_comma))
+            break;
+
+        const token at{ m_tokens.next() };
+        const u8    rhs_precedence{ (u8) (op.right_associative ? op.precedence : op.precedence + 1) };
+
+        switch (op.operation)
+        {
+        case node_operation::ternary:
+        {
+            // Like C the middle operand is a full expression, the colon ends it
+            const node_ptr middle{ parse(comma, true) };
+            expect(reserved_token::colon);
+            const node_ptr rhs{ parse(rhs_precedence, allow_comma) };
+            lhs = make(op.operation, { lhs, middle, rhs }, at);
+            break;
+        }
+        case node_operation::comma:
+        {
+            // One node for the whole list instead of a left leaning chain
+            const size_t base{ m_scratch.size() };
+            m_scratch.push_back(lhs);
+            do
+            {
+                const node_ptr item{ parse(rhs_precedence, false) };
+                m_scratch.push_back(item);
+            } while (m_tokens.match(reserved_token::comma));
+            lhs = make_from_scratch(op.operation, base, at);
+            break;
+        }
+        default:
+        {
+            const node_ptr rhs{ parse(rhs_precedence, allow_comma) };
+            lhs = make(op.operation, { lhs, rhs }, at);
+            break;
+        }
+        }
+    }
+
+    return lhs;
+}
+
+node_ptr parser::parse_prefix()
+{
+    // Only consumed once it is known to start an operand, so recovery can stop at it
+    const token tk{ m_tokens.peek() };
+
+    if (tk.is_number() || tk.is_string() || tk.is_identifier())
+        m_tokens.next();
+
+    if (tk.is_number())
+        return parse_postfix(make(tk.number(), {}, tk));
+    if (tk.is_string())
+        return parse_postfix(make(string_literal{ tk.string() }, {}, tk));
+    if (tk.is_identifier())
+        return parse_postfix(make(identifier{ tk.identifier() }, {}, tk));
+    if (!tk.is_reserved_token())
+        return fail(tk);
+
+    node_operation operation{};
+    switch (tk.reserved_token())
+    {
+    case reserved_token::open_round:
+    {
+        m_tokens.next();
+        const node_ptr inner{ parse(comma, true) };
+        expect(reserved_token::close_round);
+        return parse_postfix(inner);
+    }
+    case reserved_token::inc: operation = node_operation::preinc; break;
+    case reserved_token::dec: operation = node_operation::predec; break;
+    case reserved_token::add: operation = node_operation::positive; break;
+    case reserved_token::sub: operation = node_operation::negative; break;
+    case reserved_token::bitwise_not: operation = node_operation::bnot; break;
+    case reserved_token::logical_not: operation = node_operation::lnot; break;
+    default: return fail(tk);
+    }
+
+    m_tokens.next();
+    const node_ptr operand{ parse(prefix, false) };
+    return make(operation, { operand }, tk);
+}
+
+node_ptr parser::parse_postfix(node_ptr operand)
+{
+    while (true)
+    {
+        const token& tk{ m_tokens.peek() };
+        if (!tk.is_reserved_token())
+            return operand;
+
+        switch (tk.reserved_token())
+        {
+        case reserved_token::inc:
+        case reserved_token::dec:
+        {
+            const token at{ m_tokens.next() };
+            operand = make(at.reserved_token() == reserved_token::inc ? node_operation::postinc : node_operation::postdec,
+                           { operand }, at);
+            break;
+        }
+        case reserved_token::open_square:
+        {
+            const token    at{ m_tokens.next() };
+            const node_ptr idx{ parse(comma, true) };
+            expect(reserved_token::close_square);
+            operand = make(node_operation::index, { operand, idx }, at);
+            break;
+        }
+        case reserved_token::open_round:
+        {
+            const token at{ m_tokens.next() };
+            operand = parse_call(operand, at);
+            break;
+        }
+        default: return operand;
+        }
+    }
+}
+
+node_ptr parser::parse_call(node_ptr callee, const token& open)
+{
+    const function_type* ft{ m_context.types().get_if<function_type>(callee->type_id()) };
+
+    const size_t base{ m_scratch.size() };
+    m_scratch.push_back(callee);
+
+    if (!m_tokens.match(reserved_token::close_round))
+    {
+        do
+        {
+            node_ptr arg{ parse(assignment, false) };
+
+            // Arguments passed by value are wrapped in a param node, which turns an lvalue into a plain value
+            const size_t param{ m_scratch.size() - base - 1 };
+            if (ft && param < ft->parameter_type_id.size() && !ft->parameter_type_id[param].by_ref)
+                arg = make(node_operation::param, { arg }, arg->line_number(), arg->char_index());
+
+            m_scratch.push_back(arg);
+        } while (m_tokens.match(reserved_token::comma));
+
+        expect(reserved_token::close_round);
+    }
+
+    return make_from_scratch(node_operation::call, base, open);
+}
+
+node_ptr parser::fail(const token& tk)
+{
+    if (!m_failed)
+    {
+        m_context.diagnostics().report(unexpected_token(tk, m_context.symbols()));
+        m_context.diagnostics().set_muted(true);
+        m_failed = true;
+    }
+
+    while (!ends_statement(m_tokens.peek()))
+    {
+        m_tokens.next();
+    }
+
+    return make(0.0, {}, tk);
+}
+
+} // anonymous namespace
+
+error::error unexpected_token(const token& tk, const symbol_table& symbols)
+{
+    if (tk.is_eof())
+        return error::parsing("Unexpected end of input", tk.line_number(), tk.char_index());
+
+    std::ostringstream text{};
+    if (tk.is_reserved_token())
+        text << tk.reserved_token();
+    else if (tk.is_identifier())
+        text << symbols.name(tk.identifier());
+    else if (tk.is_number())
+        text << tk.number();
+    else
+        text << '"' << symbols.name(tk.string()) << '"';
+
+    return error::unexpected(text.str(), tk.line_number(), tk.char_index());
+}
+
+node_ptr parse_expression(compiler_context& context, token_stream& tokens, bool allow_comma)
+{
+    const bool     muted{ context.diagnostics().muted() };
+    const node_ptr ret{ parser{ context, tokens }.parse(comma, allow_comma) };
+    context.diagnostics().set_muted(muted);
+    return ret;
+}
+
+} // namespace ptl
@@ -0,0 +1,43 @@
+﻿//  ------------------------------------------------------------------------------
+//
+//  Petal
+//     Copyright 2023 Matthew Rogers
+//
+//     Licensed under the Apache License, Version 2.0 (the "License");
+//     you may not use this file except in compliance with the License.
+//     You may obtain a copy of the License at
+//
+//         http://www.apache.org/licenses/LICENSE-2.0
+//
+//     Unless required by applicable law or agreed to in writing, software
+//     distributed under the License is distributed on an "AS IS" BASIS,
+//     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//     See the License for the specific language governing permissions and
+//     limitations under the License.
+//
+//  File Name: Parser.h
+//  Date File Created: 10/17/2026
+//  Author: Matt
+//
+//  ------------------------------------------------------------------------------
+
+#pragma once
+
+#include "Common.h"
+#include "ExpressionTree.h"
+#include "TokenStream.h"
+
+namespace ptl
+{
+
+// Parses one expression from tokens in a single pass (precedence climbing) and builds its node tree in the context's
+// node arena, type checking every node as it is constructed. Stops before the first token that cannot continue the
+// expression, e.g. ';' or ')'. With allow_comma unset a top level ',' also ends the expression, as it does between
+// function arguments. Errors go to the context's diagnostics instead of being thrown: after a syntax error the rest of
+// the statement is skipped, up to but not including its ';' or '}', and the tree that comes back must not be used
+node_ptr parse_expression(compiler_context& context, token_stream& tokens, bool allow_comma = true);
+
+// The error for tk showing up where nothing like it can go, for the parts of the front end around expressions
+error::error unexpected_token(const token& tk, const symbol_table& symbols);
+
+} // namespace ptl
@@ -22,35 +22,71 @@
 //  ------------------------------------------------------------------------------
 
 #include "PushBackStream.h"
+#include "Debug/Errors.h"
+#include "Util/Scan.h"
+
+#include <cstring>
 
 namespace ptl
 {
+push_back_stream::push_back_stream(read_chunk read, u32 window_size) :
+    m_read{ std::move(read) }, m_storage{ create_scope<char[]>(window_size) }, m_capacity{ window_size }
+{
+    m_window = { m_storage.get(), 0 };
+}
+
 i32 push_back_stream::operator()()
 {
     i32 ret{ -1 };
-    if (m_stack.empty())
-        ret = m_input();
-    else
+    if (m_char_index - m_base < m_window.size() || (m_char_index - m_base == m_window.size() && refill()))
     {
-        ret = m_stack.top();
-        m_stack.pop();
+        ret = (u8) m_window[m_char_index - m_base];
+        if (ret == '\n')
+            ++m_line_number;
     }
-
-    if (ret == '\n')
-        ++m_line_number;
     ++m_char_index;
 
     return ret;
 }
 
-void push_back_stream::push_back(i32 c)
+void push_back_stream::advance_to(u32 index)
 {
-    m_stack.push(c);
+    index = std::min(index, m_base + (u32) m_window.size());
+    if (index <= m_char_index)
+        return;
+
+    m_line_number += utl::count_newlines(m_window, m_char_index - m_base, index - m_base);
+    m_char_index = index;
+}
 
+void push_back_stream::push_back(i32 c)
+{
     if (c == '\n')
         --m_line_number;
 
     --m_char_index;
 }
 
+bool push_back_stream::refill()
+{
+    if (!m_read)
+        return false;
+
+    // Keep the current token and a few bytes of look-behind, everything before that has been consumed
+    const u32 keep_from{ std::max(m_base, std::min(m_mark, m_char_index - std::min(m_char_index, look_behind))) };
+    const u32 keep{ m_base + (u32) m_window.size() - keep_from };
+    if (keep == m_capacity)
+        throw error::parsing("Token is longer than the stream window", m_line_number, m_mark);
+
+    std::memmove(m_storage.get(), m_storage.get() + (keep_from - m_base), keep);
+    m_base = keep_from;
+
+    const size_t read{ m_read(m_storage.get() + keep, m_capacity - keep) };
+    m_window = { m_storage.get(), keep + read };
+    if (read == 0)
+        m_read = nullptr;
+
+    return read > 0;
+}
+
 } // namespace ptl
@@ -23,26 +23,87 @@
 
 #pragma once
 #include "Common.h"
+#include "Source.h"
 
-#include <stack>
+#include <algorithm>
+#include <string_view>
 
 namespace ptl
 {
+// Cursor over script text. Either a contiguous buffer that must outlive the stream, or streamed input pulled through
+// a fixed-size window so arbitrarily large input (e.g. a pipe) is lexed in constant memory. Char indices and line
+// numbers are always counted from the start of the input
 class push_back_stream
 {
 public:
-    push_back_stream(const get_character& input) : m_input{ input } {}
+    // Fills dst with up to capacity bytes and returns how many were written, 0 means the end of the input
+    using read_chunk = std::function<size_t(char* dst, size_t capacity)>;
+
+    static constexpr u32 default_window_size{ 64 * 1024 };
+
+    // Bytes kept behind the cursor when the window slides, enough for any push_back done by the lexer
+    static constexpr u32 look_behind{ 16 };
+
+    push_back_stream(std::string_view buffer) : m_window{ buffer } {}
+    push_back_stream(const source& src) : m_window{ src.text() } {}
+
+    // Starts at char_index of buffer, which has to be on line line_number, to lex part of a text once more
+    push_back_stream(std::string_view buffer, u32 char_index, u32 line_number) :
+        m_window{ buffer }, m_line_number{ line_number }, m_char_index{ char_index }, m_mark{ char_index }
+    {}
+    push_back_stream(read_chunk read, u32 window_size = default_window_size);
 
     i32 operator()();
 
+    // Steps the cursor back over c, which must be the last character returned by operator()
     void push_back(i32 c);
 
     u32 line_number() const { return m_line_number; }
     u32 char_index() const { return m_char_index; }
+
+    // Marks the start of a token. Everything from the mark on stays in the window until the next mark, so a single
+    // token can be at most the window size in streaming mode
+    void mark() { m_mark = m_char_index; }
+
+    // Bytes in [begin, end), both are char indices previously returned by char_index() and not before the mark
+    std::string_view slice(u32 begin, u32 end) const { return m_window.substr(begin - m_base, end - begin); }
+
+    // Moves the cursor forward to index (clamped to the end of the window), counting the skipped new lines
+    void advance_to(u32 index);
+
+    // Runs one of the utl scan kernels, scan(text, pos) -> first match at or after pos or text.size(), over the input
+    // from the cursor on, sliding the window as needed. Leaves the cursor on the match and returns true, or at the end
+    // of the input and returns false. Unless keep_mark is set the skipped bytes are dropped from the window
+    template<typename Scan>
+    bool scan_to(Scan&& scan, bool keep_mark = false);
 private:
-    const get_character& m_input{};
-    std::stack<i32>      m_stack{};
-    u32                  m_line_number{};
-    u32                  m_char_index{};
+    // Slides the window forward and reads the next chunk behind it, false once the input is exhausted
+    bool refill();
+
+    std::string_view m_window{};
+    u32              m_base{};
+    u32              m_line_number{};
+    u32              m_char_index{};
+    u32              m_mark{};
+    read_chunk       m_read{};
+    scope<char[]>    m_storage{};
+    u32              m_capacity{};
 };
+
+template<typename Scan>
+bool push_back_stream::scan_to(Scan&& scan, bool keep_mark)
+{
+    while (true)
+    {
+        const size_t found{ scan(m_window, (size_t) std::min(m_char_index - m_base, (u32) m_window.size())) };
+        advance_to(m_base + (u32) std::min(found, m_window.size()));
+        if (found < m_window.size())
+            return true;
+
+        if (!keep_mark)
+            m_mark = m_char_index;
+        if (!refill())
+            return false;
+    }
+}
 } // namespace ptl
\ No newline at end of file
@@ -0,0 +1,918 @@
+﻿//  ------------------------------------------------------------------------------
+//
+//  Petal
+//     Copyright 2023 Matthew Rogers
+//
+//     Licensed under the Apache License, Version 2.0 (the "License");
+//     you may not use this file except in compliance with the License.
+//     You may obtain a copy of the License at
+//
+//         http://www.apache.org/licenses/LICENSE-2.0
+//
+//     Unless required by applicable law or agreed to in writing, software
+//     distributed under the License is distributed on an "AS IS" BASIS,
+//     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//     See the License for the specific language governing permissions and
+//     limitations under the License.
+//
+//  File Name: Script.cpp
+//  Date File Created: 10/17/2026
+//  Author: Matt
+//
+//  ------------------------------------------------------------------------------
+
+#include "Script.h"
+#include "Compiler.h"
+#include "Fold.h"
+#include "LineIndex.h"
+#include "Parser.h"
+#include "PushBackStream.h"
+#include "TokenStream.h"
+#include "VirtualMachine.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace ptl
+{
+namespace
+{
+
+bool is_token(const token& tk, reserved_token expected)
+{
+    return tk.is_reserved_token() && tk.reserved_token() == expected;
+}
+
+bool starts_type(const token& tk)
+{
+    return is_token(tk, reserved_token::kw_void) || is_token(tk, reserved_token::kw_number) ||
+           is_token(tk, reserved_token::kw_string);
+}
+
+// void, number or string followed by any number of [], e.g. number[][]
+std::optional<type_handle> parse_type(compiler_context& context, token_stream& tokens)
+{
+    const token& tk{ tokens.peek() };
+    type_handle  ret{};
+    if (is_token(tk, reserved_token::kw_void))
+        ret = type_registry::void_handle();
+    else if (is_token(tk, reserved_token::kw_number))
+        ret = type_registry::number_handle();
+    else if (is_token(tk, reserved_token::kw_string))
+        ret = type_registry::string_handle();
+    else
+    {
+        context.diagnostics().report(unexpected_token(tk, context.symbols()));
+        return std::nullopt;
+    }
+    tokens.next();
+
+    while (is_token(tokens.peek(), reserved_token::open_square) && is_token(tokens.peek(1), reserved_token::close_square))
+    {
+        tokens.next();
+        tokens.next();
+        ret = context.get_handle(array_type{ ret });
+    }
+
+    return ret;
+}
+
+// Moves past the block starting at the current '{' without parsing it and returns its '}', or eof if it isn't closed
+token skip_block(token_stream& tokens)
+{
+    u32 depth{ 0 };
+    for (;;)
+    {
+        const token tk{ tokens.next() };
+        if (tk.is_eof())
+            return tk;
+        if (is_token(tk, reserved_token::open_curly))
+            ++depth;
+        else if (is_token(tk, reserved_token::close_curly) && --depth == 0)
+            return tk;
+    }
+}
+
+// Compiles the statements of one function. Declarations outside of any block are globals, all others are locals.
+// After an error the rest of the statement is skipped and compiling carries on with the next one, the code of a
+// function with errors must not be run
+class statement_compiler
+{
+public:
+    // Every expression compiled is appended to tree, unless that is null
+    statement_compiler(compiler_context& context, token_stream& tokens, code_builder& code, type_handle return_type_id,
+                       bool fold, flat_tree* tree) :
+        m_context{ context }, m_tokens{ tokens }, m_code{ code }, m_expressions{ context, code },
+        m_return_type_id{ return_type_id }, m_fold{ fold }, m_tree{ tree }
+    {}
+
+    void compile_statement();
+
+    // '{' statements '}', in a scope of their own
+    void compile_block();
+
+    // Returns from the function, unless its last statement did: nothing, or the default value of the return type
+    void compile_function_end();
+
+    // Sets every global variable declared so far to the default value of its type
+    void compile_global_defaults();
+
+    // Registers taken by the locals of all scopes compiled so far
+    [[nodiscard]] u32 local_count() const { return m_local_count; }
+
+private:
+    // Jumps of the break and continue statements of a loop, patched when the loop is done
+    struct loop
+    {
+        std::vector<u32> breaks{};
+        std::vector<u32> continues{};
+    };
+
+    struct global
+    {
+        u32         index{};
+        type_handle type_id{};
+    };
+
+    // A statement starting with a reserved token other than a type
+    void compile_keyword_statement(const token& tk);
+
+    void compile_declaration();
+    void compile_if();
+    void compile_while();
+    void compile_do_while();
+    void compile_for();
+    void compile_loop_exit(bool is_break);
+    void compile_return();
+    void compile_expression_statement();
+
+    // The next statement as the body of a loop, which ends with close_loop
+    void compile_loop_body();
+    void close_loop(u32 continue_target);
+
+    // 0, "", an empty array, or a function variable that is not set yet
+    void emit_default(type_handle type_id, i16 target);
+
+    // The expression with its constants folded, nullptr when it has errors. After a syntax error the rest of the
+    // statement has been skipped
+    node_ptr parse(bool allow_comma = true);
+
+    // '(' expression ')' for a condition
+    node_ptr parse_condition();
+
+    bool expect(reserved_token expected);
+    void end_statement();
+
+    // Skips what is left of a statement after an error, up to and including its ';'. A '}' is left to end the block
+    void skip_statement();
+
+    void report(const char* msg, const token& at)
+    {
+        m_context.diagnostics().report(error::semantic(msg, at.line_number(), at.char_index()));
+    }
+
+    [[nodiscard]] u32 error_count() const { return m_context.diagnostics().error_count(); }
+
+    compiler_context&   m_context;
+    token_stream&       m_tokens;
+    code_builder&       m_code;
+    expression_compiler m_expressions;
+    type_handle         m_return_type_id;
+    std::vector<loop>   m_loops{};
+    std::vector<global> m_globals{};
+    u32                 m_local_count{};
+    bool                m_fold;
+    flat_tree*          m_tree;
+    bool                m_returned{}; // the last statement was a return
+    bool                m_constants_reported{};
+};
+
+void statement_compiler::compile_statement()
+{
+    const token tk{ m_tokens.peek() };
+    m_code.set_line(tk.line_number());
+    m_returned = false;
+
+    if (starts_type(tk))
+        compile_declaration();
+    else if (!tk.is_reserved_token())
+        compile_expression_statement();
+    else
+        compile_keyword_statement(tk);
+
+    // Reported once, at the statement that filled a pool
+    if (m_code.too_many_constants() && !m_constants_reported)
+    {
+        report("Too many constants", tk);
+        m_constants_reported = true;
+    }
+}
+
+void statement_compiler::compile_keyword_statement(const token& tk)
+{
+    switch (tk.reserved_token())
+    {
+    case reserved_token::open_curly: compile_block(); break;
+    case reserved_token::semicolon: m_tokens.next(); break;
+    case reserved_token::kw_if: compile_if(); break;
+    case reserved_token::kw_while: compile_while(); break;
+    case reserved_token::kw_do: compile_do_while(); break;
+    case reserved_token::kw_for: compile_for(); break;
+    case reserved_token::kw_break: compile_loop_exit(true); break;
+    case reserved_token::kw_continue: compile_loop_exit(false); break;
+    case reserved_token::kw_return: compile_return(); break;
+    case reserved_token::kw_fun:
+        report("Functions can only be declared at the top level", tk);
+        while (!m_tokens.is_eof() && !is_token(m_tokens.peek(), reserved_token::open_curly))
+        {
+            m_tokens.next();
+        }
+        skip_block(m_tokens);
+        break;
+    default: compile_expression_statement(); break;
+    }
+}
+
+void statement_compiler::compile_block()
+{
+    if (!expect(reserved_token::open_curly))
+    {
+        skip_statement();
+        return;
+    }
+
+    m_context.enter_scope();
+    while (!m_tokens.is_eof() && !is_token(m_tokens.peek(), reserved_token::close_curly))
+    {
+        compile_statement();
+    }
+    expect(reserved_token::close_curly);
+    m_context.leave_scope();
+}
+
+void statement_compiler::compile_function_end()
+{
+    if (m_returned)
+        return;
+
+    if (m_return_type_id == type_registry::void_handle())
+    {
+        m_code.emit(opcode::ret_void);
+        return;
+    }
+
+    const i16 mark{ m_code.temp_mark() };
+    const i16 result{ m_code.allocate_temp() };
+    emit_default(m_return_type_id, result);
+    m_code.emit(opcode::ret, result);
+    m_code.release_temps(mark);
+}
+
+void statement_compiler::compile_global_defaults()
+{
+    const i16 mark{ m_code.temp_mark() };
+    const i16 reg{ m_code.allocate_temp() };
+    for (const global& g : m_globals)
+    {
+        emit_default(g.type_id, reg);
+        m_code.emit(opcode::store_global, reg, (i16) g.index);
+    }
+    m_code.release_temps(mark);
+}
+
+void statement_compiler::compile_declaration()
+{
+    const type_handle type_id{ *parse_type(m_context, m_tokens) };
+    const token       name{ m_tokens.peek() };
+    if (!name.is_identifier())
+    {
+        m_context.diagnostics().report(unexpected_token(name, m_context.symbols()));
+        skip_statement();
+        return;
+    }
+    m_tokens.next();
+
+    if (type_id == type_registry::void_handle())
+        report("Variables can't be void", name);
+
+    // The initial value is parsed before the name is declared, so it can't refer to the variable itself
+    const u32 errors{ error_count() };
+    node_ptr  value{};
+    if (m_tokens.match(reserved_token::assign))
+        value = parse(false);
+
+    if (m_context.declared_in_scope(name.identifier()))
+        report("Variable is already declared", name);
+
+    const identifier_info* info{ m_context.create_identifier(name.identifier(), type_id, false) };
+    if (info->is_global)
+    {
+        if (info->index >= code_builder::max_globals)
+            report("Too many globals", name);
+        m_globals.push_back({ info->index, type_id });
+    }
+    else
+    {
+        if (info->index > (u32) code_builder::max_locals)
+            report("Too many local variables", name);
+        m_local_count = std::max(m_local_count, info->index);
+    }
+
+    if (value)
+    {
+        // Stored through an assignment, which checks and converts the value like any other
+        const node_ptr target{ node::create(m_context, identifier{ name.identifier() }, {}, name.line_number(),
+                                            name.char_index()) };
+        const node_ptr assign{ node::create(m_context, node_operation::assign, { target, value }, name.line_number(),
+                                            name.char_index()) };
+        if (error_count() == errors)
+            m_expressions.compile_discard(*assign);
+    }
+    else if (error_count() == errors && !info->is_global)
+    {
+        // A local in a loop is set again on every pass. Globals got their default before the top level started
+        emit_default(type_id, (i16) info->index);
+    }
+    else
+    {
+        skip_statement();
+        return;
+    }
+
+    end_statement();
+}
+
+void statement_compiler::compile_if()
+{
+    std::vector<u32> ends{};
+
+    do
+    {
+        m_tokens.next(); // if or elif
+
+        const node_ptr condition{ parse_condition() };
+        if (!condition)
+            return;
+
+        const u32 next{ m_expressions.compile_jump(*condition, false) };
+        compile_statement();
+        if (is_token(m_tokens.peek(), reserved_token::kw_elif) || is_token(m_tokens.peek(), reserved_token::kw_else))
+            ends.push_back(m_code.emit_jump(opcode::jump));
+        m_code.patch_jump(next, m_code.here());
+    } while (is_token(m_tokens.peek(), reserved_token::kw_elif));
+
+    if (m_tokens.match(reserved_token::kw_else))
+        compile_statement();
+
+    for (const u32 jump : ends)
+    {
+        m_code.patch_jump(jump, m_code.here());
+    }
+    m_returned = false;
+}
+
+void statement_compiler::compile_while()
+{
+    m_tokens.next();
+
+    const u32      start{ m_code.here() };
+    const node_ptr condition{ parse_condition() };
+    if (!condition)
+        return;
+
+    const u32 exit{ m_expressions.compile_jump(*condition, false) };
+    compile_loop_body();
+    m_code.emit_jump_to(opcode::jump, start);
+    m_code.patch_jump(exit, m_code.here());
+    close_loop(start);
+}
+
+void statement_compiler::compile_do_while()
+{
+    m_tokens.next();
+
+    const u32 start{ m_code.here() };
+    compile_loop_body();
+
+    const u32 condition_start{ m_code.here() };
+    if (!expect(reserved_token::kw_while))
+        skip_statement();
+    else if (const node_ptr condition{ parse_condition() })
+    {
+        m_code.patch_jump(m_expressions.compile_jump(*condition, true), start);
+        end_statement();
+    }
+    close_loop(condition_start);
+}
+
+void statement_compiler::compile_for()
+{
+    m_tokens.next();
+    if (!expect(reserved_token::open_round))
+    {
+        skip_statement();
+        return;
+    }
+
+    // A variable declared by the first part is only visible in the loop
+    m_context.enter_scope();
+    const auto give_up = [&] {
+        skip_statement();
+        m_context.leave_scope();
+    };
+
+    if (starts_type(m_tokens.peek()))
+        compile_declaration();
+    else if (!m_tokens.match(reserved_token::semicolon))
+        compile_expression_statement();
+
+    const u32          start{ m_code.here() };
+    std::optional<u32> exit{};
+    if (!is_token(m_tokens.peek(), reserved_token::semicolon))
+    {
+        const node_ptr condition{ parse() };
+        if (!condition)
+        {
+            give_up();
+            return;
+        }
+        condition->check_conversion(m_context, type_registry::number_handle(), false);
+        exit = m_expressions.compile_jump(*condition, false);
+    }
+    if (!expect(reserved_token::semicolon))
+    {
+        give_up();
+        return;
+    }
+
+    // The step is parsed here but compiled after the body
+    node_ptr step{};
+    if (!is_token(m_tokens.peek(), reserved_token::close_round) && !(step = parse()))
+    {
+        give_up();
+        return;
+    }
+    if (!expect(reserved_token::close_round))
+    {
+        give_up();
+        return;
+    }
+
+    compile_loop_body();
+    const u32 continue_target{ m_code.here() };
+    if (step)
+        m_expressions.compile_discard(*step);
+    m_code.emit_jump_to(opcode::jump, start);
+    if (exit)
+        m_code.patch_jump(*exit, m_code.here());
+    close_loop(continue_target);
+
+    m_context.leave_scope();
+}
+
+void statement_compiler::compile_loop_exit(bool is_break)
+{
+    const token tk{ m_tokens.next() };
+    if (m_loops.empty())
+        report(is_break ? "'break' is only allowed in a loop" : "'continue' is only allowed in a loop", tk);
+    else
+        (is_break ? m_loops.back().breaks : m_loops.back().continues).push_back(m_code.emit_jump(opcode::jump));
+
+    end_statement();
+}
+
+void statement_compiler::compile_return()
+{
+    const token tk{ m_tokens.next() };
+    const bool  is_void{ m_return_type_id == type_registry::void_handle() };
+
+    if (is_token(m_tokens.peek(), reserved_token::semicolon))
+    {
+        if (!is_void)
+            report("Missing return value", tk);
+        m_code.emit(opcode::ret_void);
+    }
+    else
+    {
+        const u32      errors{ error_count() };
+        const node_ptr value{ parse() };
+        if (!value)
+        {
+            skip_statement();
+            return;
+        }
+
+        if (is_void)
+            report("A void function can't return a value", tk);
+        else
+            value->check_conversion(m_context, m_return_type_id, false);
+
+        if (error_count() == errors)
+        {
+            const i16 mark{ m_code.temp_mark() };
+            m_code.emit(opcode::ret, m_expressions.compile_as(*value, m_return_type_id));
+            m_code.release_temps(mark);
+        }
+    }
+
+    end_statement();
+    m_returned = true;
+}
+
+void statement_compiler::compile_expression_statement()
+{
+    const node_ptr n{ parse() };
+    if (!n)
+    {
+        skip_statement();
+        return;
+    }
+
+    m_expressions.compile_discard(*n);
+    end_statement();
+}
+
+void statement_compiler::compile_loop_body()
+{
+    m_loops.emplace_back();
+    compile_statement();
+}
+
+void statement_compiler::close_loop(u32 continue_target)
+{
+    const loop& current{ m_loops.back() };
+    for (const u32 jump : current.breaks)
+    {
+        m_code.patch_jump(jump, m_code.here());
+    }
+    for (const u32 jump : current.continues)
+    {
+        m_code.patch_jump(jump, continue_target);
+    }
+
+    m_loops.pop_back();
+    m_returned = false;
+}
+
+void statement_compiler::emit_default(type_handle type_id, i16 target)
+{
+    if (type_id == type_registry::string_handle())
+    {
+        m_code.emit(opcode::load_string, target, m_code.string_constant({}));
+        return;
+    }
+
+    m_code.emit(opcode::load_number, target, m_code.number_constant(0.0));
+    if (const array_type* arr{ m_context.types().get_if<array_type>(type_id) })
+    {
+        const array_fill fill{ arr->inner_type_id == type_registry::number_handle()   ? array_fill::number
+                               : arr->inner_type_id == type_registry::string_handle() ? array_fill::string
+                                                                                      : array_fill::none };
+        m_code.emit(opcode::new_array, target, target, (i16) fill);
+    }
+}
+
+node_ptr statement_compiler::parse(bool allow_comma)
+{
+    const u32      errors{ error_count() };
+    const node_ptr ret{ parse_expression(m_context, m_tokens, allow_comma) };
+    if (error_count() != errors)
+        return nullptr;
+
+    const node_ptr folded{ m_fold ? fold_constants(m_context, ret) : ret };
+    if (m_tree)
+        m_tree->append(*folded);
+    return folded;
+}
+
+node_ptr statement_compiler::parse_condition()
+{
+    if (!expect(reserved_token::open_round))
+    {
+        skip_statement();
+        return nullptr;
+    }
+
+    const node_ptr ret{ parse() };
+    if (!ret || !expect(reserved_token::close_round))
+    {
+        skip_statement();
+        return nullptr;
+    }
+
+    // A condition of the wrong type is only reported, its statement is still compiled for the errors in it
+    ret->check_conversion(m_context, type_registry::number_handle(), false);
+    return ret;
+}
+
+bool statement_compiler::expect(reserved_token expected)
+{
+    if (m_tokens.match(expected))
+        return true;
+
+    m_context.diagnostics().report(unexpected_token(m_tokens.peek(), m_context.symbols()));
+    return false;
+}
+
+void statement_compiler::end_statement()
+{
+    if (!expect(reserved_token::semicolon))
+        skip_statement();
+}
+
+void statement_compiler::skip_statement()
+{
+    while (!m_tokens.is_eof() && !is_token(m_tokens.peek(), reserved_token::close_curly))
+    {
+        if (is_token(m_tokens.next(), reserved_token::semicolon))
+            return;
+    }
+}
+
+} // anonymous namespace
+
+u64 module_key(std::string_view text, const compile_options& options)
+{
+    return module_key(text, (options.strict ? 1u : 0u) | (options.fold ? 2u : 0u) | (options.keep_tree ? 4u : 0u));
+}
+
+script::script(source text, const compile_options& options) : m_text{ std::move(text) }, m_options{ options }
+{
+    push_back_stream stream{ m_text };
+    token_stream     tokens{ stream, m_context.symbols(), m_context.diagnostics() };
+    compile_top_level(tokens);
+}
+
+script::script(source text, const token_buffer& tokens, const line_index& lines, symbol_table& symbols,
+               const compile_options& options) :
+    m_text{ std::move(text) }, m_options{ options }, m_context{ symbols }, m_tokens{ &tokens }, m_lines{ &lines }
+{
+    token_stream stream{ tokens, lines };
+    compile_top_level(stream);
+}
+
+void script::compile_top_level(token_stream& tokens)
+{
+    // Function 0 is filled in last, the stubs of the declared functions go after it
+    function_code top_level{};
+    top_level.name = "<top level>";
+    m_program.functions.emplace_back();
+
+    code_builder       builder{ top_level };
+    statement_compiler statements{ m_context, tokens, builder, type_registry::void_handle(), m_options.fold,
+                                  m_options.keep_tree ? &m_tree : nullptr };
+
+    // Every global has the default value of its type before the first statement runs, so a function called ahead of
+    // a declaration finds a value it can use. The globals are only known at the end, their defaults are set by code
+    // after the top level that jumps back to its start
+    const u32 defaults{ builder.emit_jump(opcode::jump) };
+    const u32 start{ builder.here() };
+    while (!tokens.is_eof())
+    {
+        if (tokens.match(reserved_token::kw_fun))
+            declare_function(tokens, builder);
+        else if (is_token(tokens.peek(), reserved_token::close_curly))
+            m_context.diagnostics().report(unexpected_token(tokens.next(), m_context.symbols()));
+        else
+            statements.compile_statement();
+    }
+    statements.compile_function_end();
+
+    builder.patch_jump(defaults, builder.here());
+    statements.compile_global_defaults();
+    builder.emit_jump_to(opcode::jump, start);
+    builder.finish(statements.local_count());
+
+    m_program.functions[0] = std::move(top_level);
+    m_program.global_count = m_context.global_count();
+
+    if (m_options.strict)
+    {
+        for (u32 i{ 1 }; i < (u32) m_program.functions.size(); ++i)
+        {
+            (void) compile_function(i);
+        }
+    }
+}
+
+script::script(source text, const module_image& image, const compile_options& options) :
+    m_text{ std::move(text) }, m_options{ options }
+{
+    // Only the tree refers to symbols
+    load_image(image, image.tree().kinds.empty() ? std::vector<symbol_id>{} : image.intern_symbols(m_context.symbols()));
+}
+
+script::script(source text, const module_image& image, std::vector<symbol_id> map, symbol_table& symbols,
+               const compile_options& options) :
+    m_text{ std::move(text) }, m_options{ options }, m_context{ symbols }
+{
+    load_image(image, std::move(map));
+}
+
+void script::load_image(const module_image& image, std::vector<symbol_id> map)
+{
+    assert(image.has_code());
+    m_program = image.load_program();
+    m_functions.resize(m_program.functions.size() - 1, { .state = body_state::compiled });
+
+    // The tree stays image local too, its symbols and types are looked up in what they were interned as
+    const flat_arrays arrays{ image.tree() };
+    if (!arrays.kinds.empty())
+        m_tree.view(arrays, std::move(map), image.intern_types(m_context.types()));
+}
+
+std::optional<u32> script::find_function(std::string_view name) const
+{
+    for (u32 i{ 1 }; i < (u32) m_program.functions.size(); ++i)
+    {
+        if (m_program.functions[i].name == name)
+            return i;
+    }
+    return std::nullopt;
+}
+
+bool script::compile_function(u32 function)
+{
+    assert(function > 0 && function <= m_functions.size());
+    lazy_function& fn{ m_functions[function - 1] };
+    if (fn.state != body_state::pending)
+        return fn.state == body_state::compiled;
+
+    error::diagnostics& diag{ m_context.diagnostics() };
+    const u32           errors{ diag.error_count() };
+
+    // The body is read once more from its '{' to its '}'. Without tokens it is lexed again with the text cut off after
+    // the '}', so nothing past it is lexed
+    const auto token_index = [&](u32 char_index) {
+        return (u32) (std::ranges::lower_bound(m_tokens->offsets(), char_index) - m_tokens->offsets().begin());
+    };
+    push_back_stream stream{ m_text.text().substr(0, fn.body_end), fn.body_begin, fn.body_line };
+    token_stream     tokens{ m_tokens ? token_stream{ *m_tokens, *m_lines, token_index(fn.body_begin), token_index(fn.body_end) }
+                                      : token_stream{ stream, m_context.symbols(), diag } };
+
+    const function_code& stub{ m_program.functions[function] };
+    const function_type& type{ *m_context.types().get_if<function_type>(fn.type_id) };
+    function_code        code{};
+    code.name        = stub.name;
+    code.param_count = stub.param_count;
+
+    m_context.enter_function();
+    for (u32 i{ 0 }; i < code.param_count; ++i)
+    {
+        (void) m_context.create_param(m_param_names[fn.first_param + i], type.parameter_type_id[i].type_id);
+    }
+
+    code_builder       builder{ code };
+    statement_compiler statements{ m_context, tokens, builder, type.return_type_id, m_options.fold,
+                                  m_options.keep_tree ? &m_tree : nullptr };
+    statements.compile_block();
+    statements.compile_function_end();
+    builder.finish(statements.local_count());
+    m_context.leave_scope();
+
+    if (diag.error_count() != errors)
+    {
+        fn.state = body_state::failed;
+        return false;
+    }
+
+    m_program.functions[function] = std::move(code);
+    fn.state                      = body_state::compiled;
+    return true;
+}
+
+void script::attach(virtual_machine& vm)
+{
+    vm.set_lazy_compiler([this](u32 function) { return compile_function(function); });
+}
+
+void script::format_diagnostics(std::ostream& output) const
+{
+    m_context.diagnostics().format(m_text.text(), line_index{ m_text.text() }, output);
+}
+
+void script::move_symbols(std::span<const symbol_id> map, symbol_table& symbols)
+{
+    m_context.move_symbols(map, symbols);
+    for (symbol_id& name : m_param_names)
+    {
+        name = map[name];
+    }
+    m_tree.remap_symbols([&](symbol_id id) { return map[id]; });
+}
+
+module_contents script::image_contents(const symbol_table& symbols, const token_buffer& tokens) const
+{
+    module_contents ret{ symbols, tokens };
+    if (diagnostics().has_errors() ||
+        !std::ranges::all_of(m_functions, [](const lazy_function& fn) { return fn.state == body_state::compiled; }))
+        return ret;
+
+    if (m_tree.size() != 0)
+    {
+        ret.tree         = &m_tree;
+        ret.types        = &m_context.types();
+        ret.tree_symbols = &m_context.symbols();
+    }
+    ret.code = &m_program;
+    return ret;
+}
+
+void script::declare_function(token_stream& tokens, code_builder& top_level)
+{
+    error::diagnostics& diag{ m_context.diagnostics() };
+    const u32           errors{ diag.error_count() };
+    const u32           first_param{ (u32) m_param_names.size() };
+
+    const auto fail = [&] {
+        diag.report(unexpected_token(tokens.peek(), m_context.symbols()));
+        return false;
+    };
+
+    // fun <type> name(<type>[&] param, ...) { body }
+    const std::optional<type_handle> return_type_id{ parse_type(m_context, tokens) };
+    const token                      name{ tokens.peek() };
+    function_type                    type{ return_type_id.value_or(type_registry::void_handle()), {} };
+
+    bool ok{ return_type_id && (name.is_identifier() || fail()) };
+    if (ok)
+    {
+        tokens.next();
+        ok = tokens.match(reserved_token::open_round) || fail();
+    }
+    if (ok && !tokens.match(reserved_token::close_round))
+    {
+        do
+        {
+            const std::optional<type_handle> param_type_id{ parse_type(m_context, tokens) };
+            const bool                       by_ref{ param_type_id && tokens.match(reserved_token::bitwise_and) };
+            if (!param_type_id || (!tokens.peek().is_identifier() && !fail()))
+            {
+                ok = false;
+                break;
+            }
+
+            m_param_names.push_back(tokens.next().identifier());
+            type.parameter_type_id.push_back({ *param_type_id, by_ref });
+        } while (tokens.match(reserved_token::comma));
+
+        ok = ok && (tokens.match(reserved_token::close_round) || fail());
+    }
+    if (ok && !is_token(tokens.peek(), reserved_token::open_curly))
+        ok = fail();
+
+    // Even a broken declaration has its body skipped as a whole
+    while (!tokens.is_eof() && !is_token(tokens.peek(), reserved_token::open_curly))
+    {
+        if (is_token(tokens.next(), reserved_token::semicolon))
+            break;
+    }
+    const token open{ tokens.peek() };
+    const token close{ is_token(open, reserved_token::open_curly) ? skip_block(tokens) : open };
+    if (is_token(open, reserved_token::open_curly) && close.is_eof())
+        diag.report(unexpected_token(close, m_context.symbols()));
+
+    const u32 index{ (u32) m_program.functions.size() };
+    if (ok && m_context.find(name.identifier()))
+    {
+        diag.report(error::semantic("Function name is already declared", name.line_number(), name.char_index()));
+        ok = false;
+    }
+    if (ok && index > 0xFFFF)
+    {
+        diag.report(error::semantic("Too many functions", name.line_number(), name.char_index()));
+        ok = false;
+    }
+    if (!ok)
+    {
+        m_param_names.resize(first_param);
+        return;
+    }
+
+    const type_handle      type_id{ m_context.get_handle(type) };
+    const identifier_info* global{ m_context.create_identifier(name.identifier(), type_id, true) };
+    if (global->index >= code_builder::max_globals)
+        diag.report(error::semantic("Too many globals", name.line_number(), name.char_index()));
+
+    // A body the lexer already failed on is not lexed again
+    m_functions.push_back({ type_id, first_param, open.char_index(), close.char_index() + 1, open.line_number(),
+                            diag.error_count() == errors ? body_state::pending : body_state::failed });
+
+    function_code& stub{ m_program.functions.emplace_back() };
+    stub.name        = m_context.symbols().name(name.identifier());
+    stub.param_count = (u32) type.parameter_type_id.size();
+
+    code_builder stub_code{ stub };
+    stub_code.set_line(open.line_number());
+    stub_code.emit(opcode::compile_lazy, (i16) (u16) index);
+
+    // The function is a constant global, set when the top level gets to its declaration
+    top_level.set_line(name.line_number());
+    const i16 mark{ top_level.temp_mark() };
+    const i16 reg{ top_level.allocate_temp() };
+    top_level.emit(opcode::load_function, reg, (i16) (u16) index);
+    top_level.emit(opcode::store_global, reg, (i16) global->index);
+    top_level.release_temps(mark);
+}
+
+} // namespace ptl
@@ -0,0 +1,161 @@
+﻿//  ------------------------------------------------------------------------------
+//
+//  Petal
+//     Copyright 2023 Matthew Rogers
+//
+//     Licensed under the Apache License, Version 2.0 (the "License");
+//     you may not use this file except in compliance with the License.
+//     You may obtain a copy of the License at
+//
+//         http://www.apache.org/licenses/LICENSE-2.0
+//
+//     Unless required by applicable law or agreed to in writing, software
+//     distributed under the License is distributed on an "AS IS" BASIS,
+//     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//     See the License for the specific language governing permissions and
+//     limitations under the License.
+//
+//  File Name: Script.h
+//  Date File Created: 10/17/2026
+//  Author: Matt
+//
+//  ------------------------------------------------------------------------------
+
+#pragma once
+
+#include "Common.h"
+#include "Bytecode.h"
+#include "CompilerContext.h"
+#include "FlatTree.h"
+#include "LineIndex.h"
+#include "ModuleCache.h"
+#include "Source.h"
+
+#include <optional>
+#include <ostream>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace ptl
+{
+
+class token_stream;
+class virtual_machine;
+
+struct compile_options
+{
+    // Compiles every function body up front, so all errors of the script are known before it runs
+    bool strict{};
+
+    // Folds the constants of every expression before it is compiled, see fold_constants. Only turned off to measure
+    // what folding saves
+    bool fold{ true };
+
+    // Keeps every compiled expression in tree(), for a module image
+    bool keep_tree{};
+};
+
+// Content address of text compiled with options, every option changes what ends up in the image
+[[nodiscard]] u64 module_key(std::string_view text, const compile_options& options);
+
+// A whole script compiled for the virtual machine. The top level is a list of function declarations and statements,
+// global variables are the ones declared outside of any block:
+//
+//     fun number square(number x) { return x * x; }
+//     number total = square(3);
+//
+// Only the top level is compiled up front. A function body is skipped by matching its braces and just its position
+// is kept, its code stays a compile_lazy stub until the first call, so functions that never run are never parsed or
+// type checked. Function 0 of code() runs the top level and has to run before anything else, function i + 1 is the
+// i-th declared function
+class script
+{
+public:
+    explicit script(source text, const compile_options& options = {});
+
+    // Compiles tokens, lexed from text into symbols, instead of lexing text again. The script keeps reading tokens for
+    // the bodies it compiles later and keeps interning into symbols, all three must outlive it
+    script(source text, const token_buffer& tokens, const line_index& lines, symbol_table& symbols,
+           const compile_options& options = {});
+
+    // The script stored in image, an image of text with code. Nothing is lexed or compiled, every body is there already.
+    // The code and the tree are used where they are in the mapping, image must outlive the script
+    script(source text, const module_image& image, const compile_options& options = {});
+
+    // Like the above with the tree's symbols in symbols, like a script compiled from tokens. map gives the id there of
+    // every symbol of the image, see module_image::intern_symbols
+    script(source text, const module_image& image, std::vector<symbol_id> map, symbol_table& symbols,
+           const compile_options& options = {});
+
+    script(const script&)            = delete;
+    script& operator=(const script&) = delete;
+
+    [[nodiscard]] const program& code() const { return m_program; }
+
+    // Program index of the function declared as name
+    [[nodiscard]] std::optional<u32> find_function(std::string_view name) const;
+
+    // Compiles the body of function, a program index, unless that happened already. False when the body has errors,
+    // its code stays the stub then. Machines built from code() pick up the new code on their next call of function
+    bool compile_function(u32 function);
+
+    // Compiles the bodies for vm, which has to run code(), on their first call
+    void attach(virtual_machine& vm);
+
+    // Errors found so far, including those of bodies compiled since
+    [[nodiscard]] const error::diagnostics& diagnostics() const { return m_context.diagnostics(); }
+
+    // Writes every error with the line it points at
+    void format_diagnostics(std::ostream& output) const;
+
+    // The expressions compiled so far, folded, in compile order. Empty unless compile_options::keep_tree is set or the
+    // script came from an image that has them
+    [[nodiscard]] const flat_tree& tree() const { return m_tree; }
+
+    // Moves the script over to symbols, map gives the id there of every id of the table it was compiled against. The
+    // tokens it was compiled from have to be remapped the same way
+    void move_symbols(std::span<const symbol_id> map, symbol_table& symbols);
+
+    // What the symbol ids and type handles of tree() stand for
+    [[nodiscard]] const symbol_table&  symbols() const { return m_context.symbols(); }
+    [[nodiscard]] const type_registry& types() const { return m_context.types(); }
+
+    // What an image of the script holds next to the tokens of its text, which were interned into symbols. The code and
+    // the tree are only there once every body compiled without errors, otherwise just the tokens are cached
+    [[nodiscard]] module_contents image_contents(const symbol_table& symbols, const token_buffer& tokens) const;
+
+private:
+    enum struct body_state : u8
+    {
+        pending,
+        compiled,
+        failed,
+    };
+
+    struct lazy_function
+    {
+        type_handle type_id{};
+        u32         first_param{}; // into m_param_names, one per parameter of the type
+        u32         body_begin{};  // char index of the '{'
+        u32         body_end{};    // char index right after the '}'
+        u32         body_line{};
+        body_state  state{};
+    };
+
+    void compile_top_level(token_stream& tokens);
+    void load_image(const module_image& image, std::vector<symbol_id> map);
+    void declare_function(token_stream& tokens, code_builder& top_level);
+
+    source                     m_text;
+    compile_options            m_options;
+    compiler_context           m_context{};
+    program                    m_program{};
+    std::vector<lazy_function> m_functions{}; // m_functions[i] is function i + 1 of the program
+    std::vector<symbol_id>     m_param_names{};
+    flat_tree                  m_tree{};
+    const token_buffer*        m_tokens{}; // what the script was compiled from, null when it lexed m_text itself
+    const line_index*          m_lines{};
+};
+
+} // namespace ptl
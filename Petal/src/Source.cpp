@@ -0,0 +1,222 @@
+﻿//  ------------------------------------------------------------------------------
+//
+//  Petal
+//     Copyright 2023 Matthew Rogers
+//
+//     Licensed under the Apache License, Version 2.0 (the "License");
+//     you may not use this file except in compliance with the License.
+//     You may obtain a copy of the License at
+//
+//         http://www.apache.org/licenses/LICENSE-2.0
+//
+//     Unless required by applicable law or agreed to in writing, software
+//     distributed under the License is distributed on an "AS IS" BASIS,
+//     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//     See the License for the specific language governing permissions and
+//     limitations under the License.
+//
+//  File Name: Source.cpp
+//  Date File Created: 10/17/2026
+//  Author: Matt
+//
+//  ------------------------------------------------------------------------------
+
+#include "Source.h"
+
+#ifdef _WIN32
+    #ifndef WIN32_LEAN_AND_MEAN
+        #define WIN32_LEAN_AND_MEAN
+    #endif
+    #ifndef NOMINMAX
+        #define NOMINMAX
+    #endif
+    #include <Windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+namespace ptl
+{
+namespace
+{
+
+// Maps the whole file read-only, returns nullptr on failure. Empty files are reported through size with a null mapping
+void* map_file(const std::filesystem::path& path, size_t& size, bool& ok)
+{
+    ok   = false;
+    size = 0;
+#ifdef _WIN32
+    const HANDLE file{ CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                                   FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr) };
+    if (file == INVALID_HANDLE_VALUE)
+        return nullptr;
+
+    LARGE_INTEGER file_size{};
+    if (!GetFileSizeEx(file, &file_size))
+    {
+        CloseHandle(file);
+        return nullptr;
+    }
+
+    if (file_size.QuadPart == 0)
+    {
+        CloseHandle(file);
+        ok = true;
+        return nullptr;
+    }
+
+    const HANDLE mapping{ CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr) };
+    CloseHandle(file);
+    if (!mapping)
+        return nullptr;
+
+    // The view keeps the mapping object alive, so the handle can be closed right away
+    void* view{ MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) };
+    CloseHandle(mapping);
+    if (!view)
+        return nullptr;
+
+    size = (size_t) file_size.QuadPart;
+    ok   = true;
+    return view;
+#else
+    const int fd{ open(path.c_str(), O_RDONLY) };
+    if (fd < 0)
+        return nullptr;
+
+    struct stat st{};
+    if (fstat(fd, &st) != 0)
+    {
+        close(fd);
+        return nullptr;
+    }
+
+    if (st.st_size == 0)
+    {
+        close(fd);
+        ok = true;
+        return nullptr;
+    }
+
+    void* view{ mmap(nullptr, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0) };
+    close(fd);
+    if (view == MAP_FAILED)
+        return nullptr;
+
+    madvise(view, (size_t) st.st_size, MADV_SEQUENTIAL);
+
+    size = (size_t) st.st_size;
+    ok   = true;
+    return view;
+#endif
+}
+
+void unmap_file(void* view, [[maybe_unused]] size_t size)
+{
+#ifdef _WIN32
+    UnmapViewOfFile(view);
+#else
+    munmap(view, size);
+#endif
+}
+
+} // anonymous namespace
+
+source::~source()
+{
+    release();
+}
+
+source::source(source&& other) noexcept :
+    m_text{ other.m_text }, m_storage{ std::move(other.m_storage) }, m_mapping{ other.m_mapping },
+    m_mapping_size{ other.m_mapping_size }, m_owns_storage{ other.m_owns_storage }
+{
+    // Short strings live inside the std::string itself, so the view has to follow the moved storage
+    if (m_owns_storage)
+        m_text = m_storage;
+
+    other.m_text         = {};
+    other.m_mapping      = nullptr;
+    other.m_mapping_size = 0;
+    other.m_owns_storage = false;
+}
+
+source& source::operator=(source&& other) noexcept
+{
+    if (this != &other)
+    {
+        release();
+
+        m_storage      = std::move(other.m_storage);
+        m_text         = other.m_owns_storage ? std::string_view{ m_storage } : other.m_text;
+        m_mapping      = other.m_mapping;
+        m_mapping_size = other.m_mapping_size;
+        m_owns_storage = other.m_owns_storage;
+
+        other.m_text         = {};
+        other.m_mapping      = nullptr;
+        other.m_mapping_size = 0;
+        other.m_owns_storage = false;
+    }
+
+    return *this;
+}
+
+source source::from_view(std::string_view text)
+{
+    source ret{};
+    ret.m_text = text;
+    return ret;
+}
+
+source source::from_string(std::string text)
+{
+    source ret{};
+    ret.m_storage      = std::move(text);
+    ret.m_text         = ret.m_storage;
+    ret.m_owns_storage = true;
+    return ret;
+}
+
+std::optional<source> source::from_file(const std::filesystem::path& path)
+{
+    size_t size{};
+    bool   ok{};
+    void*  view{ map_file(path, size, ok) };
+    if (!ok)
+        return std::nullopt;
+
+    source ret{};
+    ret.m_mapping      = view;
+    ret.m_mapping_size = size;
+    ret.m_text         = { (const char*) view, size };
+    return ret;
+}
+
+source source::from_get_character(const get_character& input)
+{
+    std::string text{};
+    for (i32 c{ input() }; c >= 0; c = input())
+    {
+        text.push_back((char) c);
+    }
+
+    return from_string(std::move(text));
+}
+
+void source::release()
+{
+    if (m_mapping)
+        unmap_file(m_mapping, m_mapping_size);
+
+    m_mapping      = nullptr;
+    m_mapping_size = 0;
+    m_text         = {};
+    m_storage.clear();
+    m_owns_storage = false;
+}
+
+} // namespace ptl
@@ -0,0 +1,72 @@
+﻿//  ------------------------------------------------------------------------------
+//
+//  Petal
+//     Copyright 2023 Matthew Rogers
+//
+//     Licensed under the Apache License, Version 2.0 (the "License");
+//     you may not use this file except in compliance with the License.
+//     You may obtain a copy of the License at
+//
+//         http://www.apache.org/licenses/LICENSE-2.0
+//
+//     Unless required by applicable law or agreed to in writing, software
+//     distributed under the License is distributed on an "AS IS" BASIS,
+//     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//     See the License for the specific language governing permissions and
+//     limitations under the License.
+//
+//  File Name: Source.h
+//  Date File Created: 10/17/2026
+//  Author: Matt
+//
+//  ------------------------------------------------------------------------------
+
+#pragma once
+
+#include "Common.h"
+
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace ptl
+{
+
+// Contiguous, read-only script text. The bytes are either borrowed from the caller (from_view), owned by the
+// source (from_string, from_get_character) or a read-only memory mapping of a file (from_file)
+class source
+{
+public:
+    source() = default;
+    ~source();
+
+    source(source&& other) noexcept;
+    source& operator=(source&& other) noexcept;
+
+    source(const source&)            = delete;
+    source& operator=(const source&) = delete;
+
+    [[nodiscard]] static source                from_view(std::string_view text);
+    [[nodiscard]] static source                from_string(std::string text);
+    [[nodiscard]] static std::optional<source> from_file(const std::filesystem::path& path);
+
+    // Compatibility adapter for the old character callback input, drains input until it returns a negative value
+    [[nodiscard]] static source from_get_character(const get_character& input);
+
+    [[nodiscard]] std::string_view text() const { return m_text; }
+    [[nodiscard]] const char*      data() const { return m_text.data(); }
+    [[nodiscard]] u32              size() const { return (u32) m_text.size(); }
+    [[nodiscard]] bool             is_mapped() const { return m_mapping != nullptr; }
+
+private:
+    void release();
+
+    std::string_view m_text{};
+    std::string      m_storage{};
+    void*            m_mapping{};
+    size_t           m_mapping_size{};
+    bool             m_owns_storage{};
+};
+
+} // namespace ptl
@@ -0,0 +1,131 @@
+﻿//  ------------------------------------------------------------------------------
+//
+//  Petal
+//     Copyright 2023 Matthew Rogers
+//
+//     Licensed under the Apache License, Version 2.0 (the "License");
+//     you may not use this file except in compliance with the License.
+//     You may obtain a copy of the License at
+//
+//         http://www.apache.org/licenses/LICENSE-2.0
+//
+//     Unless required by applicable law or agreed to in writing, software
+//     distributed under the License is distributed on an "AS IS" BASIS,
+//     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//     See the License for the specific language governing permissions and
+//     limitations under the License.
+//
+//  File Name: SymbolTable.cpp
+//  Date File Created: 10/17/2026
+//  Author: Matt
+//
+//  ------------------------------------------------------------------------------
+
+#include "SymbolTable.h"
+
+#include <cstring>
+
+namespace ptl
+{
+
+symbol_table::symbol_table()
+{
+    m_slots.resize(initial_slots);
+}
+
+symbol_id symbol_table::intern(std::string_view name, u64 hash)
+{
+    const u32 short_hash{ (u32) (hash ^ (hash >> 32)) };
+    const u32 mask{ (u32) m_slots.size() - 1 };
+
+    // Linear probing, the table is kept at most half full
+    for (u32 i{ short_hash & mask };; i = (i + 1) & mask)
+    {
+        slot& s{ m_slots[i] };
+        if (s.id == invalid_id)
+        {
+            s.hash = short_hash;
+            s.id   = (symbol_id) m_names.size();
+            m_names.emplace_back(store(name), name.size());
+            m_hashes.push_back(short_hash);
+
+            const symbol_id ret{ s.id };
+            if (m_names.size() * 2 > m_slots.size())
+                grow();
+            return ret;
+        }
+
+        if (s.hash == short_hash && m_names[s.id] == name)
+            return s.id;
+    }
+}
+
+std::optional<symbol_id> symbol_table::find(std::string_view name) const
+{
+    const u64 full_hash{ hash(name) };
+    const u32 short_hash{ (u32) (full_hash ^ (full_hash >> 32)) };
+    const u32 mask{ (u32) m_slots.size() - 1 };
+
+    for (u32 i{ short_hash & mask };; i = (i + 1) & mask)
+    {
+        const slot& s{ m_slots[i] };
+        if (s.id == invalid_id)
+            return std::nullopt;
+        if (s.hash == short_hash && m_names[s.id] == name)
+            return s.id;
+    }
+}
+
+void symbol_table::clear()
+{
+    m_slots.assign(initial_slots, slot{});
+    m_names.clear();
+    m_hashes.clear();
+    m_blocks.clear();
+    m_block_used = block_size;
+}
+
+const char* symbol_table::store(std::string_view name)
+{
+    if (name.empty())
+        return "";
+
+    // Oversized names get a block of their own so the current block can keep filling up
+    if (name.size() > block_size / 4)
+    {
+        scope<char[]> block{ create_scope<char[]>(name.size()) };
+        std::memcpy(block.get(), name.data(), name.size());
+        const char* ret{ block.get() };
+        m_blocks.insert(m_blocks.end() - (m_blocks.empty() ? 0 : 1), std::move(block));
+        return ret;
+    }
+
+    if (m_block_used + name.size() > block_size)
+    {
+        m_blocks.push_back(create_scope<char[]>(block_size));
+        m_block_used = 0;
+    }
+
+    char* ret{ m_blocks.back().get() + m_block_used };
+    std::memcpy(ret, name.data(), name.size());
+    m_block_used += name.size();
+    return ret;
+}
+
+void symbol_table::grow()
+{
+    m_slots.assign(m_slots.size() * 2, slot{});
+    const u32 mask{ (u32) m_slots.size() - 1 };
+
+    for (symbol_id id{ 0 }; id < (symbol_id) m_names.size(); ++id)
+    {
+        u32 i{ m_hashes[id] & mask };
+        while (m_slots[i].id != invalid_id)
+        {
+            i = (i + 1) & mask;
+        }
+        m_slots[i] = { m_hashes[id], id };
+    }
+}
+
+} // namespace ptl
@@ -0,0 +1,93 @@
+﻿//  ------------------------------------------------------------------------------
+//
+//  Petal
+//     Copyright 2023 Matthew Rogers
+//
+//     Licensed under the Apache License, Version 2.0 (the "License");
+//     you may not use this file except in compliance with the License.
+//     You may obtain a copy of the License at
+//
+//         http://www.apache.org/licenses/LICENSE-2.0
+//
+//     Unless required by applicable law or agreed to in writing, software
+//     distributed under the License is distributed on an "AS IS" BASIS,
+//     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//     See the License for the specific language governing permissions and
+//     limitations under the License.
+//
+//  File Name: SymbolTable.h
+//  Date File Created: 10/17/2026
+//  Author: Matt
+//
+//  ------------------------------------------------------------------------------
+
+#pragma once
+
+#include "Common.h"
+
+#include <optional>
+#include <string_view>
+#include <vector>
+
+namespace ptl
+{
+
+using symbol_id = u32;
+
+// Interns identifier names and string literal contents for one compilation. Every distinct string is stored once
+// and is referred to by a dense 32-bit id, names stay valid until the table is cleared or destroyed
+class symbol_table
+{
+public:
+    // FNV-1a, exposed so the lexer can hash a word while it scans it
+    static constexpr u64 hash_seed{ 14695981039346656037ull };
+    static constexpr u64 hash_prime{ 1099511628211ull };
+
+    static constexpr u64 hash_step(u64 hash, char c) { return (hash ^ (u8) c) * hash_prime; }
+
+    static constexpr u64 hash(std::string_view str)
+    {
+        u64 ret{ hash_seed };
+        for (const char c : str)
+        {
+            ret = hash_step(ret, c);
+        }
+        return ret;
+    }
+
+    symbol_table();
+
+    symbol_id intern(std::string_view name) { return intern(name, hash(name)); }
+
+    // hash must be symbol_table::hash(name)
+    symbol_id intern(std::string_view name, u64 hash);
+
+    [[nodiscard]] std::optional<symbol_id> find(std::string_view name) const;
+
+    [[nodiscard]] std::string_view name(symbol_id id) const { return m_names[id]; }
+    [[nodiscard]] u32              size() const { return (u32) m_names.size(); }
+
+    void clear();
+
+private:
+    struct slot
+    {
+        u32       hash{};
+        symbol_id id{ invalid_id };
+    };
+
+    static constexpr symbol_id invalid_id{ ~0u };
+    static constexpr u32       initial_slots{ 256 };
+    static constexpr size_t    block_size{ 64 * 1024 };
+
+    const char* store(std::string_view name);
+    void        grow();
+
+    std::vector<slot>             m_slots{};
+    std::vector<std::string_view> m_names{};
+    std::vector<u32>              m_hashes{};
+    std::vector<scope<char[]>>    m_blocks{};
+    size_t                        m_block_used{ block_size };
+};
+
+} // namespace ptl
@@ -0,0 +1,242 @@
+﻿//  ------------------------------------------------------------------------------
+//
+//  Petal
+//     Copyright 2023 Matthew Rogers
+//
+//     Licensed under the Apache License, Version 2.0 (the "License");
+//     you may not use this file except in compliance with the License.
+//     You may obtain a copy of the License at
+//
+//         http://www.apache.org/licenses/LICENSE-2.0
+//
+//     Unless required by applicable law or agreed to in writing, software
+//     distributed under the License is distributed on an "AS IS" BASIS,
+//     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//     See the License for the specific language governing permissions and
+//     limitations under the License.
+//
+//  File Name: TokenBuffer.cpp
+//  Date File Created: 10/17/2026
+//  Author: Matt
+//
+//  ------------------------------------------------------------------------------
+
+#include "TokenBuffer.h"
+
+#include <algorithm>
+
+namespace ptl
+{
+
+void token_buffer::clear()
+{
+    m_view    = {};
+    m_viewing = false;
+    m_symbols.clear();
+
+    m_kinds.clear();
+    m_offsets.clear();
+    m_lengths.clear();
+    m_payloads.clear();
+    m_numbers.clear();
+}
+
+void token_buffer::reserve(u32 count)
+{
+    m_kinds.reserve(count);
+    m_offsets.reserve(count);
+    m_lengths.reserve(count);
+    m_payloads.reserve(count);
+}
+
+void token_buffer::push_back(const token& tk, u32 length)
+{
+    if (m_viewing)
+        own();
+
+    token_kind kind{};
+    u32        payload{};
+
+    if (tk.is_reserved_token())
+    {
+        kind    = token_kind::reserved_token;
+        payload = (u32) tk.reserved_token();
+    } else if (tk.is_identifier())
+    {
+        kind    = token_kind::identifier;
+        payload = tk.identifier();
+    } else if (tk.is_number())
+    {
+        kind    = token_kind::number;
+        payload = (u32) m_numbers.size();
+        m_numbers.push_back(tk.number());
+    } else if (tk.is_string())
+    {
+        kind    = token_kind::string;
+        payload = tk.string();
+    } else
+    {
+        kind = token_kind::eof;
+    }
+
+    m_kinds.push_back(kind);
+    m_offsets.push_back(tk.char_index());
+    m_lengths.push_back(length);
+    m_payloads.push_back(payload);
+}
+
+token token_buffer::get(u32 idx, u32 line_number) const
+{
+    const u32 offset{ this->offset(idx) };
+    switch (kind(idx))
+    {
+    case token_kind::reserved_token: return token{ get_reserved_token(idx), line_number, offset };
+    case token_kind::identifier: return token{ identifier{ get_symbol(idx) }, line_number, offset };
+    case token_kind::number: return token{ get_number(idx), line_number, offset };
+    case token_kind::string: return token{ string_literal{ get_symbol(idx) }, line_number, offset };
+    case token_kind::eof: break;
+    }
+    return token{ eof{}, line_number, offset };
+}
+
+void token_buffer::assign(const token_arrays& arrays)
+{
+    m_view    = {};
+    m_viewing = false;
+    m_symbols.clear();
+
+    m_kinds.assign(arrays.kinds.begin(), arrays.kinds.end());
+    m_offsets.assign(arrays.offsets.begin(), arrays.offsets.end());
+    m_lengths.assign(arrays.lengths.begin(), arrays.lengths.end());
+    m_payloads.assign(arrays.payloads.begin(), arrays.payloads.end());
+    m_numbers.assign(arrays.numbers.begin(), arrays.numbers.end());
+}
+
+void token_buffer::view(const token_arrays& arrays, std::vector<symbol_id> symbols)
+{
+    clear();
+    m_view    = arrays;
+    m_symbols = std::move(symbols);
+    m_viewing = true;
+}
+
+void token_buffer::own()
+{
+    const token_arrays           arrays{ m_view };
+    const std::vector<symbol_id> symbols{ std::move(m_symbols) };
+    assign(arrays);
+    remap_symbols([&](symbol_id id) { return symbols[id]; });
+}
+
+void token_buffer::splice(u32 first, u32 last, const token_buffer& replacement, i64 shift)
+{
+    if (m_viewing)
+        own();
+
+    const u32 number_base{ (u32) m_numbers.size() };
+    m_numbers.insert(m_numbers.end(), replacement.numbers().begin(), replacement.numbers().end());
+
+    std::vector<u32> payloads{ replacement.payloads().begin(), replacement.payloads().end() };
+    for (u32 i{ 0 }; i < replacement.size(); ++i)
+    {
+        if (replacement.kind(i) == token_kind::number)
+            payloads[i] += number_base;
+        else if (replacement.kind(i) == token_kind::identifier || replacement.kind(i) == token_kind::string)
+            payloads[i] = replacement.get_symbol(i);
+    }
+
+    const auto replace{ [first, last](auto& dst, const auto& src) {
+        dst.erase(dst.begin() + first, dst.begin() + last);
+        dst.insert(dst.begin() + first, src.begin(), src.end());
+    } };
+
+    replace(m_kinds, replacement.kinds());
+    replace(m_offsets, replacement.offsets());
+    replace(m_lengths, replacement.lengths());
+    replace(m_payloads, payloads);
+
+    for (u32 i{ first + replacement.size() }; i < size(); ++i)
+    {
+        m_offsets[i] = (u32) (m_offsets[i] + shift);
+    }
+}
+
+void tokenize(std::string_view text, symbol_table& symbols, token_buffer& tokens, error::diagnostics& diag)
+{
+    tokens.clear();
+    // Rough guess from typical scripts, avoids most of the regrowth on big files
+    tokens.reserve((u32) (text.size() / 5 + 1));
+
+    push_back_stream stream{ text };
+    while (true)
+    {
+        const token tk{ tokenize(stream, symbols, diag) };
+        tokens.push_back(tk, tk.is_eof() ? 0 : stream.char_index() - tk.char_index());
+        if (tk.is_eof())
+            break;
+    }
+}
+
+relex_result relex(std::string_view text, const text_edit& edit, symbol_table& symbols, token_buffer& tokens,
+                   error::diagnostics& diag)
+{
+    // No token reads more than one character past its end before deciding where it stops
+    constexpr u32 max_lookahead{ 1 };
+
+    const i64 shift{ (i64) edit.inserted - (i64) edit.removed };
+    const u32 new_edit_end{ edit.offset + edit.inserted };
+
+    const std::span offsets{ tokens.offsets() };
+    const std::span lengths{ tokens.lengths() };
+
+    // First token that might have seen the edited bytes. Everything before it is kept, and since the lexer carries no
+    // state between tokens it can pick up right where the previous token ended, even inside a comment or a string
+    u32 first{ 0 };
+    for (u32 count{ tokens.size() }; count > 0;)
+    {
+        const u32 half{ count / 2 };
+        if (offsets[first + half] + lengths[first + half] + max_lookahead < edit.offset)
+        {
+            first += half + 1;
+            count -= half + 1;
+        } else
+        {
+            count = half;
+        }
+    }
+
+    const u32 restart{ first == 0 ? 0 : offsets[first - 1] + lengths[first - 1] };
+
+    push_back_stream stream{ text };
+    stream.advance_to(restart);
+
+    token_buffer replacement{};
+    u32          last{ tokens.size() };
+    while (true)
+    {
+        const token tk{ tokenize(stream, symbols, diag) };
+        const u32   offset{ tk.char_index() };
+
+        // Past the edit the new text is the old text shifted, so a token starting where an old one started means the
+        // rest of the old tokens are still valid
+        if (offset >= new_edit_end)
+        {
+            const u32  old_offset{ (u32) (offset - shift) };
+            const auto it{ std::lower_bound(offsets.begin() + first, offsets.end(), old_offset) };
+            if (it != offsets.end() && *it == old_offset)
+            {
+                last = (u32) (it - offsets.begin());
+                break;
+            }
+        }
+
+        replacement.push_back(tk, tk.is_eof() ? 0 : stream.char_index() - offset);
+        if (tk.is_eof())
+            break;
+    }
+
+    tokens.splice(first, last, replacement, shift);
+    return { first, last - first, replacement.size() };
+}
+
+} // namespace ptl
@@ -0,0 +1,166 @@
+﻿//  ------------------------------------------------------------------------------
+//
+//  Petal
+//     Copyright 2023 Matthew Rogers
+//
+//     Licensed under the Apache License, Version 2.0 (the "License");
+//     you may not use this file except in compliance with the License.
+//     You may obtain a copy of the License at
+//
+//         http://www.apache.org/licenses/LICENSE-2.0
+//
+//     Unless required by applicable law or agreed to in writing, software
+//     distributed under the License is distributed on an "AS IS" BASIS,
+//     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//     See the License for the specific language governing permissions and
+//     limitations under the License.
+//
+//  File Name: TokenBuffer.h
+//  Date File Created: 10/17/2026
+//  Author: Matt
+//
+//  ------------------------------------------------------------------------------
+
+#pragma once
+
+#include "Common.h"
+#include "Tokens.h"
+
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace ptl
+{
+
+enum struct token_kind : u8
+{
+    reserved_token,
+    identifier,
+    number,
+    string,
+    eof,
+};
+
+// The arrays of a token_buffer, see there. A module_image hands them out straight from its mapping
+struct token_arrays
+{
+    std::span<const token_kind> kinds{};
+    std::span<const u32>        offsets{};
+    std::span<const u32>        lengths{};
+    std::span<const u32>        payloads{};
+    std::span<const f64>        numbers{};
+};
+
+// A whole lexed source as a structure of arrays. Every token costs 13 bytes (kind, source offset, source length and
+// a payload) plus 8 bytes per number literal. The payload is the reserved_token, the symbol_id of an identifier or
+// string literal, or an index into the number table. The arrays are either the buffer's own or a view of someone
+// else's, see view
+class token_buffer
+{
+public:
+    token_buffer() = default;
+
+    // Drops the tokens but keeps the allocations so the buffer can be reused for the next compile
+    void clear();
+    void reserve(u32 count);
+
+    void push_back(const token& tk, u32 length);
+
+    // Replaces the tokens with a copy of arrays
+    void assign(const token_arrays& arrays);
+
+    // Replaces the tokens with arrays themselves, e.g. those of a module_image, which must outlive the buffer or the next
+    // change to it. The payload of an identifier or string literal is an index into symbols, which holds its symbol_id.
+    // Anything that changes the tokens copies them first
+    void view(const token_arrays& arrays, std::vector<symbol_id> symbols);
+
+    // Replaces the tokens [first, last) with all of replacement and moves the offsets of the tokens after them by shift.
+    // The number literals of the replaced tokens stay in the number table until the buffer is cleared
+    void splice(u32 first, u32 last, const token_buffer& replacement, i64 shift);
+
+    // Replaces the symbol_id of every identifier and string literal with map(id), used to move the tokens over to a
+    // different symbol_table. Viewed tokens keep their payloads, only the ids they index are mapped
+    template<typename Map>
+    void remap_symbols(Map&& map)
+    {
+        if (m_viewing)
+        {
+            for (symbol_id& id : m_symbols)
+            {
+                id = map(id);
+            }
+            return;
+        }
+
+        for (u32 i{ 0 }; i < size(); ++i)
+        {
+            if (m_kinds[i] == token_kind::identifier || m_kinds[i] == token_kind::string)
+                m_payloads[i] = map(m_payloads[i]);
+        }
+    }
+
+    [[nodiscard]] u32 size() const { return (u32) kinds().size(); }
+
+    [[nodiscard]] token_kind kind(u32 idx) const { return kinds()[idx]; }
+    [[nodiscard]] u32        offset(u32 idx) const { return offsets()[idx]; }
+    [[nodiscard]] u32        length(u32 idx) const { return lengths()[idx]; }
+    [[nodiscard]] u32        payload(u32 idx) const { return payloads()[idx]; }
+
+    [[nodiscard]] reserved_token get_reserved_token(u32 idx) const { return (reserved_token) payload(idx); }
+    [[nodiscard]] symbol_id      get_symbol(u32 idx) const { return m_viewing ? m_symbols[payload(idx)] : payload(idx); }
+    [[nodiscard]] f64            get_number(u32 idx) const { return numbers()[payload(idx)]; }
+
+    // The token at idx as the lexer returned it, it was on line_number
+    [[nodiscard]] token get(u32 idx, u32 line_number) const;
+
+    // The arrays as they are, the payloads of viewed identifiers and string literals are not symbol ids
+    [[nodiscard]] std::span<const token_kind> kinds() const { return m_viewing ? m_view.kinds : m_kinds; }
+    [[nodiscard]] std::span<const u32>        offsets() const { return m_viewing ? m_view.offsets : m_offsets; }
+    [[nodiscard]] std::span<const u32>        lengths() const { return m_viewing ? m_view.lengths : m_lengths; }
+    [[nodiscard]] std::span<const u32>        payloads() const { return m_viewing ? m_view.payloads : m_payloads; }
+    [[nodiscard]] std::span<const f64>        numbers() const { return m_viewing ? m_view.numbers : m_numbers; }
+
+    [[nodiscard]] token_arrays arrays() const { return { kinds(), offsets(), lengths(), payloads(), numbers() }; }
+
+private:
+    // Copies viewed tokens into the buffer's own arrays, with their symbol ids
+    void own();
+
+    std::vector<token_kind> m_kinds{};
+    std::vector<u32>        m_offsets{};
+    std::vector<u32>        m_lengths{};
+    std::vector<u32>        m_payloads{};
+    std::vector<f64>        m_numbers{};
+    token_arrays            m_view{};
+    std::vector<symbol_id>  m_symbols{}; // indexed by the payloads of viewed identifiers and string literals
+    bool                    m_viewing{};
+};
+
+// Lexes all of text into tokens (replacing its contents), always ending with an eof token. Errors go to diag
+void tokenize(std::string_view text, symbol_table& symbols, token_buffer& tokens, error::diagnostics& diag);
+
+// An edit that turned the old text into the new one: removed bytes at offset were replaced by inserted bytes
+struct text_edit
+{
+    u32 offset{};
+    u32 removed{};
+    u32 inserted{};
+};
+
+// Which tokens an incremental re-lex replaced: [first, first + removed) of the old buffer became
+// [first, first + inserted) of the new one
+struct relex_result
+{
+    u32 first{};
+    u32 removed{};
+    u32 inserted{};
+};
+
+// Brings tokens, the result of lexing the text before edit, up to date with text (the text after edit). Lexing restarts
+// after the last token the edit could not have affected and stops as soon as a token starts at the same place as an old
+// one past the edit, the rest of the old tokens are then only shifted. Only errors in the re-lexed range reach diag
+relex_result relex(std::string_view text, const text_edit& edit, symbol_table& symbols, token_buffer& tokens,
+                   error::diagnostics& diag);
+
+} // namespace ptl
@@ -0,0 +1,131 @@
+﻿//  ------------------------------------------------------------------------------
+//
+//  Petal
+//     Copyright 2023 Matthew Rogers
+//
+//     Licensed under the Apache License, Version 2.0 (the "License");
+//     you may not use this file except in compliance with the License.
+//     You may obtain a copy of the License at
+//
+//         http://www.apache.org/licenses/LICENSE-2.0
+//
+//     Unless required by applicable law or agreed to in writing, software
+//     distributed under the License is distributed on an "AS IS" BASIS,
+//     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//     See the License for the specific language governing permissions and
+//     limitations under the License.
+//
+//  File Name: TokenStream.cpp
+//  Date File Created: 10/17/2026
+//  Author: Matt
+//
+//  ------------------------------------------------------------------------------
+
+#include "TokenStream.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace ptl
+{
+
+token_stream::token_stream(const token_buffer& buffer, const line_index& lines, u32 first, u32 last) :
+    m_buffer{ &buffer }, m_lines{ &lines }, m_next{ first }, m_last{ std::min(last, buffer.size()) }
+{
+    assert(first <= m_last);
+    if (first < buffer.size())
+        m_line = lines.locate(buffer.offset(first)).line;
+}
+
+const token& token_stream::peek(u32 k)
+{
+    assert(k < lookahead);
+
+    if (k >= m_count && !m_done)
+        fill();
+
+    // Past the end of the input every position is the eof token
+    return at(std::min(k, m_count - 1));
+}
+
+token token_stream::next()
+{
+    const token ret{ peek() };
+    if (!ret.is_eof())
+    {
+        m_head = (m_head + 1) & (lookahead - 1);
+        --m_count;
+    }
+
+    return ret;
+}
+
+bool token_stream::match(reserved_token tk)
+{
+    const token& current{ peek() };
+    if (!current.is_reserved_token() || current.reserved_token() != tk)
+        return false;
+
+    next();
+    return true;
+}
+
+void token_stream::fill()
+{
+    if (m_buffer)
+    {
+        fill_from_buffer();
+        return;
+    }
+
+    // Lexes as far ahead as the ring allows so the lexer runs in batches instead of one token per call
+    try
+    {
+        while (m_count < lookahead)
+        {
+            token& tk{ at(m_count) };
+            tk = tokenize(*m_stream, *m_symbols, *m_diagnostics);
+            ++m_count;
+
+            if (tk.is_eof())
+            {
+                m_done = true;
+                return;
+            }
+        }
+    } catch (const error::error& err)
+    {
+        // Only a token that does not fit the stream window gets here, the rest of the input is given up
+        m_diagnostics->report(err);
+        at(m_count) = token{ eof{}, err.line_number(), err.char_index() };
+        ++m_count;
+        m_done = true;
+    }
+}
+
+void token_stream::fill_from_buffer()
+{
+    while (m_count < lookahead)
+    {
+        // Past the range the stream ends where the next token starts, a buffer always ends with an eof token
+        const bool in_range{ m_next < m_last };
+        const u32  idx{ in_range ? m_next++ : m_last };
+        const u32  offset{ idx < m_buffer->size() ? m_buffer->offset(idx) : 0 };
+        while (m_line + 1 < m_lines->line_count() && m_lines->line_start(m_line + 1) <= offset)
+        {
+            ++m_line;
+        }
+
+        token& tk{ at(m_count) };
+        tk = in_range ? m_buffer->get(idx, m_line) : token{ eof{}, m_line, offset };
+        ++m_count;
+
+        if (tk.is_eof())
+        {
+            m_done = true;
+            return;
+        }
+    }
+}
+
+} // namespace ptl
@@ -0,0 +1,89 @@
+﻿//  ------------------------------------------------------------------------------
+//
+//  Petal
+//     Copyright 2023 Matthew Rogers
+//
+//     Licensed under the Apache License, Version 2.0 (the "License");
+//     you may not use this file except in compliance with the License.
+//     You may obtain a copy of the License at
+//
+//         http://www.apache.org/licenses/LICENSE-2.0
+//
+//     Unless required by applicable law or agreed to in writing, software
+//     distributed under the License is distributed on an "AS IS" BASIS,
+//     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//     See the License for the specific language governing permissions and
+//     limitations under the License.
+//
+//  File Name: TokenStream.h
+//  Date File Created: 10/17/2026
+//  Author: Matt
+//
+//  ------------------------------------------------------------------------------
+
+#pragma once
+
+#include "Common.h"
+#include "LineIndex.h"
+#include "TokenBuffer.h"
+#include "Tokens.h"
+#include "Debug/Errors.h"
+
+#include <array>
+
+namespace ptl
+{
+
+// Pulls tokens from the lexer as the parser asks for them. Tokens are lexed a batch at a time into a fixed ring, so
+// the parser can look a few tokens ahead while memory stays the same no matter how long the input is. Lexing errors
+// go to the diagnostics, the stream itself never throws. A source lexed before into a token_buffer is read the same
+// way, its tokens are copied into the ring instead of lexed
+class token_stream
+{
+public:
+    // Size of the ring, peek can look at most lookahead - 1 tokens past the current one
+    static constexpr u32 lookahead{ 16 };
+
+    // All three must outlive the token_stream
+    token_stream(push_back_stream& stream, symbol_table& symbols, error::diagnostics& diag) :
+        m_stream{ &stream }, m_symbols{ &symbols }, m_diagnostics{ &diag }
+    {}
+
+    // The tokens [first, last) of buffer and then an eof token where token last starts. lines indexes the text buffer
+    // was lexed from, both must outlive the token_stream. Its lexing errors were reported when buffer was filled
+    token_stream(const token_buffer& buffer, const line_index& lines, u32 first = 0, u32 last = ~0u);
+
+    // The token k places after the current one. Once the input is exhausted this is the eof token
+    const token& peek(u32 k = 0);
+
+    // Returns the current token and moves past it, the eof token is never moved past
+    token next();
+
+    // Moves past the current token if it is tk
+    bool match(reserved_token tk);
+
+    bool is_eof() { return peek().is_eof(); }
+
+private:
+    static_assert((lookahead & (lookahead - 1)) == 0, "lookahead must be a power of two");
+
+    void fill();
+    void fill_from_buffer();
+
+    [[nodiscard]] token& at(u32 k) { return m_ring[(m_head + k) & (lookahead - 1)]; }
+
+    push_back_stream*            m_stream{};
+    symbol_table*                m_symbols{};
+    error::diagnostics*          m_diagnostics{};
+    const token_buffer*          m_buffer{};
+    const line_index*            m_lines{};
+    u32                          m_next{}; // of m_buffer
+    u32                          m_last{};
+    u32                          m_line{}; // of the token at m_next
+    std::array<token, lookahead> m_ring{};
+    u32                          m_head{};
+    u32                          m_count{};
+    bool                         m_done{};
+};
+
+} // namespace ptl
@@ -24,6 +24,10 @@
 #include "Tokens.h"
 #include "Util/Lookup.h"
 #include "Debug/Errors.h"
+#include "Util/Scan.h"
+
+#include <array>
+#include <charconv>
 
 namespace ptl
 {
@@ -35,7 +39,7 @@ constexpr i32 new_line{ 'n' };
 constexpr i32 carriage_return{ 'r' };
 constexpr i32 null_term{ '0' };
 
-const utl::lookup<std::string_view, reserved_token> operator_token_map{
+constexpr std::pair<std::string_view, reserved_token> operator_tokens[]{
     { "++",           reserved_token::inc},
     { "--",           reserved_token::dec},
     {  "+",           reserved_token::add},
@@ -85,7 +89,7 @@ const utl::lookup<std::string_view, reserved_token> operator_token_map{
     {  "]",  reserved_token::close_square},
 };
 
-const utl::lookup<std::string_view, reserved_token> keyword_token_map{
+constexpr std::pair<std::string_view, reserved_token> keyword_tokens[]{
     {      "if",       reserved_token::kw_if},
     {    "else",     reserved_token::kw_else},
     {    "elif",     reserved_token::kw_elif},
@@ -107,12 +111,12 @@ const utl::lookup<std::string_view, reserved_token> keyword_token_map{
 
 const utl::lookup token_string_map{ [] {
     std::vector<std::pair<reserved_token, std::string_view>> container{};
-    container.reserve(operator_token_map.size() + keyword_token_map.size());
-    for (const auto& p : operator_token_map)
+    container.reserve(std::size(operator_tokens) + std::size(keyword_tokens));
+    for (const auto& p : operator_tokens)
     {
         container.emplace_back(p.second, p.first);
     }
-    for (const auto& p : keyword_token_map)
+    for (const auto& p : keyword_tokens)
     {
         container.emplace_back(p.second, p.first);
     }
@@ -120,38 +124,189 @@ const utl::lookup token_string_map{ [] {
     return utl::lookup(std::move(container));
 }() };
 
-enum struct character_type
+// Maximal munch over operator_tokens as a flattened trie. Every step is a class lookup plus a table lookup, so
+// matching an operator is O(length) and needs no allocation
+class operator_dfa
 {
-    eof,
-    space,
-    alphanum,
-    punct,
+public:
+    static constexpr u8 dead{ 0 };
+    static constexpr u8 start{ 1 };
+
+    static constexpr u32 max_states{ 64 };
+    static constexpr u32 max_classes{ 32 };
+
+    struct match
+    {
+        std::optional<reserved_token> token{};
+        u32                           length{};
+    };
+
+    constexpr operator_dfa()
+    {
+        u32 class_count{ 1 };
+        for (const auto& [str, tk] : operator_tokens)
+        {
+            u8 state{ start };
+            for (const char c : str)
+            {
+                u8& cls{ m_char_class[(u8) c] };
+                if (cls == 0)
+                    cls = (u8) class_count++;
+
+                u8& next{ m_next[state][cls] };
+                if (next == dead)
+                    next = (u8) m_state_count++;
+                state = next;
+            }
+
+            m_accepting[state] = true;
+            m_token[state]     = tk;
+        }
+
+        m_class_count = class_count;
+    }
+
+    [[nodiscard]] constexpr u8 step(u8 state, i32 c) const
+    {
+        return c < 0 || c >= (i32) m_char_class.size() ? dead : m_next[state][m_char_class[c]];
+    }
+
+    [[nodiscard]] constexpr bool           accepting(u8 state) const { return m_accepting[state]; }
+    [[nodiscard]] constexpr reserved_token token(u8 state) const { return m_token[state]; }
+
+    [[nodiscard]] constexpr u32 state_count() const { return m_state_count; }
+    [[nodiscard]] constexpr u32 class_count() const { return m_class_count; }
+
+    // Longest operator at the front of str
+    [[nodiscard]] constexpr match longest_match(std::string_view str) const
+    {
+        match ret{};
+        u8    state{ start };
+        for (u32 i{ 0 }; i < str.size(); ++i)
+        {
+            state = step(state, (u8) str[i]);
+            if (state == dead)
+                break;
+            if (accepting(state))
+                ret = { token(state), i + 1 };
+        }
+        return ret;
+    }
+
+private:
+    std::array<u8, 128>                                 m_char_class{};
+    std::array<std::array<u8, max_classes>, max_states> m_next{};
+    std::array<bool, max_states>                        m_accepting{};
+    std::array<reserved_token, max_states>              m_token{};
+    u32                                                 m_state_count{ start + 1 };
+    u32                                                 m_class_count{};
 };
 
-class comparator
+constexpr u32 max_operator_length{ [] {
+    size_t ret{ 0 };
+    for (const auto& [str, tk] : operator_tokens)
+    {
+        ret = std::max(ret, str.size());
+    }
+    return (u32) ret;
+}() };
+
+constexpr operator_dfa operator_table{};
+
+static_assert(operator_table.state_count() <= operator_dfa::max_states, "operator_dfa::max_states is too small");
+static_assert(operator_table.class_count() <= operator_dfa::max_classes, "operator_dfa::max_classes is too small");
+
+// Every operator has to match itself exactly, this keeps the table honest whenever operator_tokens changes
+static_assert([] {
+    for (const auto& [str, tk] : operator_tokens)
+    {
+        const operator_dfa::match m{ operator_table.longest_match(str) };
+        if (!m.token || *m.token != tk || m.length != str.size())
+            return false;
+    }
+    return true;
+}());
+
+// Perfect hash over keyword_tokens. The seed is searched at compile time so that (first char, last char, length) of
+// every keyword lands in its own slot, which makes rejecting an ordinary identifier a single probe
+class keyword_hash
 {
 public:
-    constexpr comparator(u32 idx) : m_index{ idx } {}
+    static constexpr u32 bits{ 6 };
+    static constexpr u32 slot_count{ 1u << bits };
 
-    bool operator()(char l, char r) const { return l < r; }
+    constexpr keyword_hash()
+    {
+        for (u32 seed{ 0x9E3779B1u };; seed += 2)
+        {
+            if (try_seed(seed))
+                break;
+        }
+    }
+
+    [[nodiscard]] constexpr std::optional<reserved_token> find(std::string_view word) const
+    {
+        if (word.size() < m_min_length || word.size() > m_max_length)
+            return std::nullopt;
+
+        const slot& s{ m_slots[index(word)] };
+        return s.word == word ? std::make_optional(s.token) : std::nullopt;
+    }
+
+private:
+    struct slot
+    {
+        std::string_view word{};
+        reserved_token   token{};
+    };
 
-    bool operator()(std::pair<std::string_view, reserved_token> l, char r) const
+    static constexpr u32 key(std::string_view word)
     {
-        return l.first.size() <= m_index || l.first[m_index] < r;
+        return (u32) (u8) word.front() | (u32) (u8) word.back() << 8 | (u32) word.size() << 16;
     }
 
-    bool operator()(char l, std::pair<std::string_view, reserved_token> r) const
+    [[nodiscard]] constexpr u32 index(std::string_view word) const { return (key(word) * m_seed) >> (32 - bits); }
+
+    constexpr bool try_seed(u32 seed)
     {
-        return r.first.size() > m_index && l < r.first[m_index];
+        m_seed  = seed;
+        m_slots = {};
+        for (const auto& [word, tk] : keyword_tokens)
+        {
+            slot& s{ m_slots[index(word)] };
+            if (!s.word.empty())
+                return false;
+            s = { word, tk };
+
+            m_min_length = std::min(m_min_length, (u32) word.size());
+            m_max_length = std::max(m_max_length, (u32) word.size());
+        }
+        return true;
     }
 
-    bool operator()(std::pair<std::string_view, reserved_token> l, std::pair<std::string_view, reserved_token> r) const
+    std::array<slot, slot_count> m_slots{};
+    u32                          m_seed{};
+    u32                          m_min_length{ ~0u };
+    u32                          m_max_length{};
+};
+
+constexpr keyword_hash keyword_table{};
+
+static_assert([] {
+    for (const auto& [word, tk] : keyword_tokens)
     {
-        return r.first.size() > m_index && (l.first.size() < m_index || l.first[m_index] < r.first[m_index]);
+        if (keyword_table.find(word) != tk)
+            return false;
     }
+    return true;
+}());
 
-private:
-    u32 m_index{};
+enum struct character_type
+{
+    eof,
+    space,
+    alphanum,
+    punct,
 };
 
 character_type get_character_type(i32 c)
@@ -166,49 +321,173 @@ character_type get_character_type(i32 c)
     return character_type::punct;
 }
 
-token fetch_word(push_back_stream& stream)
+token fetch_word(push_back_stream& stream, symbol_table& symbols)
 {
     const u32 line_number{ stream.line_number() };
     const u32 char_index{ stream.char_index() };
 
-    std::string word{};
-    i32         c{ stream() };
-
-    const bool is_number = isdigit(c);
+    u64 hash{ symbol_table::hash_seed };
+    i32 c{ stream() };
 
     do
     {
-        word.push_back((char) c);
-        c = stream();
-    } while (get_character_type(c) == character_type::alphanum || (is_number && c == '.'));
+        hash = symbol_table::hash_step(hash, (char) c);
+        c    = stream();
+    } while (get_character_type(c) == character_type::alphanum);
 
     stream.push_back(c);
 
+    const std::string_view word{ stream.slice(char_index, stream.char_index()) };
+
     if (const std::optional tk{ get_keyword(word) })
     {
         return token{ *tk, line_number, char_index };
     }
-    if (std::isdigit(word.front()))
+
+    return token{ identifier{ symbols.intern(word, hash) }, line_number, char_index };
+}
+
+bool is_digit(char c, u32 base)
+{
+    switch (base)
+    {
+    case 2: return c == '0' || c == '1';
+    case 16: return std::isxdigit((u8) c);
+    default: return std::isdigit((u8) c);
+    }
+}
+
+void report_unexpected_char(error::diagnostics& diag, std::string_view text, size_t pos, u32 line_number, u32 char_index)
+{
+    pos = std::min(pos, text.size() - 1);
+    diag.report(error::unexpected(text.substr(pos, 1), line_number, char_index + (u32) pos));
+}
+
+// Parses a whole numeric literal in one pass with std::from_chars, which is locale independent. Errors point at the
+// offending character, char_index being the index of text.front(). A literal with an error is reported and reads as 0
+f64 parse_number(std::string_view text, u32 line_number, u32 char_index, error::diagnostics& diag)
+{
+    u32    base{ 10 };
+    size_t prefix{ 0 };
+    if (text.size() > 1 && text[0] == '0')
     {
-        char* endptr;
-        f64   num{ (f64) strtol(word.c_str(), &endptr, 0) };
-        if (*endptr != 0)
+        switch (text[1])
         {
-            num = strtod(word.c_str(), &endptr);
-            if (*endptr != 0)
+        case 'x':
+        case 'X': base = 16; break;
+        case 'b':
+        case 'B': base = 2; break;
+        default: break;
+        }
+        prefix = base == 10 ? 0 : 2;
+    }
+
+    std::string_view digits{ text.substr(prefix) };
+
+    // Digit separators may only sit between two digits and are stripped into a stack buffer before parsing. A
+    // misplaced one cuts the copy short, so that an earlier bad character is still the one reported
+    std::array<char, 128> scratch{};
+    const bool            has_separators{ digits.find('_') != std::string_view::npos };
+    size_t                bad_separator{ std::string_view::npos };
+    if (has_separators)
+    {
+        if (digits.size() > scratch.size())
+        {
+            diag.report(error::parsing("Number literal is too long", line_number, char_index));
+            return 0.0;
+        }
+
+        u32 size{ 0 };
+        for (size_t i{ 0 }; i < digits.size(); ++i)
+        {
+            if (digits[i] != '_')
+            {
+                scratch[size++] = digits[i];
+                continue;
+            }
+            if (i == 0 || i + 1 == digits.size() || !is_digit(digits[i - 1], base) || !is_digit(digits[i + 1], base))
             {
-                const size_t remaining{ word.size() - (endptr - word.c_str()) };
-                throw error::unexpected(std::string{ 1, *endptr }, stream.line_number(), stream.char_index() - (u32) remaining);
+                bad_separator = prefix + i;
+                break;
             }
         }
+        digits = { scratch.data(), size };
+    }
+
+    // Maps a position in digits back to a position in text
+    const auto position{ [&](const char* ptr) {
+        size_t pos{ (size_t) (ptr - digits.data()) };
+        if (has_separators)
+        {
+            for (size_t i{ 0 }, kept{ 0 }; i < text.size() - prefix; ++i)
+            {
+                if (kept == pos)
+                {
+                    pos = i;
+                    break;
+                }
+                if (text[prefix + i] != '_')
+                    ++kept;
+            }
+        }
+        return prefix + pos;
+    } };
+
+    const char* const first{ digits.data() };
+    const char* const last{ digits.data() + digits.size() };
+
+    f64                    ret{};
+    std::from_chars_result result{};
+    if (base == 10)
+    {
+        result = std::from_chars(first, last, ret, std::chars_format::general);
+    } else
+    {
+        u64 value{};
+        result = std::from_chars(first, last, value, (i32) base);
+        ret    = (f64) value;
+    }
+
+    if (result.ec == std::errc::invalid_argument)
+        report_unexpected_char(diag, text, std::min(position(first), bad_separator), line_number, char_index);
+    else if (result.ptr != last)
+        report_unexpected_char(diag, text, position(result.ptr), line_number, char_index);
+    else if (bad_separator != std::string_view::npos)
+        report_unexpected_char(diag, text, bad_separator, line_number, char_index);
+    else if (result.ec == std::errc::result_out_of_range)
+        diag.report(error::parsing("Number literal is out of range", line_number, char_index));
+    else
+        return ret;
+
+    return 0.0;
+}
+
+// Numbers are scanned separately from words since '.' and an exponent sign can be part of them
+token fetch_number(push_back_stream& stream, error::diagnostics& diag)
+{
+    const u32 line_number{ stream.line_number() };
+    const u32 char_index{ stream.char_index() };
+
+    const i32  first{ stream() };
+    i32        c{ stream() };
+    const bool has_radix{ first == '0' && (c == 'x' || c == 'X' || c == 'b' || c == 'B') };
 
-        return token{ num, line_number, char_index };
+    for (i32 prev{ first }; get_character_type(c) == character_type::alphanum || c == '.'
+                            || (!has_radix && (c == '+' || c == '-') && (prev == 'e' || prev == 'E'));
+         c = stream())
+    {
+        prev = c;
     }
 
-    return token{ identifier{ std::move(word) }, line_number, char_index };
+    stream.push_back(c);
+
+    return token{ parse_number(stream.slice(char_index, stream.char_index()), line_number, char_index, diag), line_number,
+                  char_index };
 }
 
-token fetch_operator(push_back_stream& stream)
+// Reports and skips a run of characters that start no operator. The run ends at the first character that starts a
+// token again, so "@;" still ends the statement: an operator there is the token, otherwise there is none
+std::optional<token> fetch_operator(push_back_stream& stream, error::diagnostics& diag)
 {
     const u32 line_number{ stream.line_number() };
     const u32 char_index{ stream.char_index() };
@@ -216,90 +495,121 @@ token fetch_operator(push_back_stream& stream)
     if (const std::optional tk{ get_operator(stream) })
         return token{ *tk, line_number, char_index };
 
-    std::string unexpected{};
-    const u32   error_line_number{ stream.line_number() };
-    const u32   error_char_index{ stream.char_index() };
-
-    for (i32 c = stream(); get_character_type(c) == character_type::punct; c = stream())
+    std::string          unexpected(1, (char) stream());
+    std::optional<token> ret{};
+    for (;;)
     {
-        unexpected.push_back((char) c);
+        const i32 c{ stream() };
+        stream.push_back(c);
+
+        // Strings and comments are left to the caller
+        if (get_character_type(c) != character_type::punct || c == '"' || c == '/')
+            break;
+
+        const u32 next_line{ stream.line_number() };
+        const u32 next_index{ stream.char_index() };
+        if (const std::optional tk{ get_operator(stream) })
+        {
+            ret = token{ *tk, next_line, next_index };
+            break;
+        }
+        unexpected.push_back((char) stream());
     }
 
-    throw error::unexpected(unexpected, error_line_number, error_char_index);
+    diag.report(error::unexpected(unexpected, line_number, char_index));
+    return ret;
 }
 
-token fetch_string(push_back_stream& stream)
+// An unterminated literal is reported and ends where the line or the input does
+token fetch_string(push_back_stream& stream, symbol_table& symbols, error::diagnostics& diag)
 {
     const u32 line_number{ stream.line_number() };
     const u32 char_index{ stream.char_index() };
 
-    std::string str{};
+    // Opening '"'
+    stream();
 
-    bool escaped{ false };
-    i32  c{ stream() };
+    // Plain runs are found with utl::find_string_special and copied in bulk. A literal without escapes is interned
+    // straight from the source buffer without building str at all
+    std::string str{};
+    bool        escaped{ false };
+    u32         run_begin{ stream.char_index() };
 
-    for (; get_character_type(c) != character_type::eof; c = stream())
+    while (true)
     {
-        if (c == '\\')
-            escaped = true;
-        else if (escaped)
+        // The whole literal has to stay in the window, the mark is on the opening '"'
+        stream.scan_to([](std::string_view text, size_t pos) { return utl::find_string_special(text, pos); }, true);
+        const u32 special{ stream.char_index() };
+
+        const i32 c{ stream() };
+        switch (c)
         {
-            switch (c)
+        case '"':
+        {
+            const std::string_view run{ stream.slice(run_begin, special) };
+            if (!escaped)
+                return token{ string_literal{ symbols.intern(run) }, line_number, char_index };
+
+            str += run;
+            return token{ string_literal{ symbols.intern(str) }, line_number, char_index };
+        }
+        case '\\':
+        {
+            str += stream.slice(run_begin, special);
+            escaped = true;
+
+            switch (const i32 e{ stream() })
             {
             case tab: str.push_back('\t'); break;
             case new_line: str.push_back('\n'); break;
             case carriage_return: str.push_back('\r'); break;
             case null_term: str.push_back('\0'); break;
-            default: str.push_back(c);
-            }
-        } else
-        {
-            switch (c)
-            {
-            case '\t':
-            case '\n':
-            case '\r':
-                stream.push_back(c);
-                throw error::parsing("Expected closing '\"'", stream.line_number(), stream.char_index());
-            case '"': return token{ std::move(str), line_number, char_index };
-            default: str.push_back(c);
+            default:
+                if (get_character_type(e) == character_type::eof)
+                {
+                    stream.push_back(e);
+                    diag.report(error::parsing("Expected closing '\"'", stream.line_number(), stream.char_index()));
+                    return token{ string_literal{ symbols.intern(str) }, line_number, char_index };
+                }
+                str.push_back((char) e);
             }
+
+            run_begin = stream.char_index();
+            break;
+        }
+        default:
+            // \t, \n, \r or the end of the buffer
+            stream.push_back(c);
+            diag.report(error::parsing("Expected closing '\"'", stream.line_number(), stream.char_index()));
+            str += stream.slice(run_begin, special);
+            return token{ string_literal{ symbols.intern(str) }, line_number, char_index };
         }
     }
-
-    stream.push_back(c);
-    throw error::parsing("Expected closing '\"'", stream.line_number(), stream.char_index());
 }
 
 // Skip over a line a single line, convention is that Petal comments are like C/C++ comments. I.e, it begins with //
 void skip_line_comment(push_back_stream& stream)
 {
-    i32 c;
-    do
-    {
-        c = stream();
-    } while (c != '\n' && get_character_type(c) != character_type::eof);
-
-    if (c != '\n')
-        stream.push_back(c);
+    // Past the '\n' if there is one
+    if (stream.scan_to([](std::string_view text, size_t pos) { return utl::find_byte(text, pos, '\n'); }))
+        stream();
 }
 
 // Skip over a block of lines, convention is that Petal comments are like C/C++ comments. I.e, it begins with /* and ends with */
-void skip_block_comment(push_back_stream& stream)
+void skip_block_comment(push_back_stream& stream, error::diagnostics& diag)
 {
-    bool closing = false;
-    i32  c;
-    do
+    // A "*/" can straddle the end of the stream window, so only the '*' is scanned for and the '/' is read normally
+    while (stream.scan_to([](std::string_view text, size_t pos) { return utl::find_byte(text, pos, '*'); }))
     {
-        c = stream();
-        if (closing && c == '/')
+        stream();
+        const i32 c{ stream() };
+        if (c == '/')
             return;
-        closing = c == '*';
-    } while (get_character_type(c) != character_type::eof);
+        stream.push_back(c);
+    }
 
     // If we reach here, it means the eof was met, but a closing */ was never encountered
-    stream.push_back(c);
-    throw error::parsing("Expected closing '*/'", stream.line_number(), stream.char_index());
+    diag.report(error::parsing("Expected closing '*/'", stream.line_number(), stream.char_index()));
 }
 
 } // anonymous namespace
@@ -312,66 +622,80 @@ std::ostream& operator<<(std::ostream& os, reserved_token tk)
 
 std::optional<reserved_token> get_keyword(std::string_view word)
 {
-    const auto it{ keyword_token_map.find(word) };
-    return it == keyword_token_map.end() ? std::nullopt : std::make_optional(it->second);
+    return keyword_table.find(word);
+}
+
+std::span<const std::pair<std::string_view, reserved_token>> operator_spellings()
+{
+    return operator_tokens;
 }
 
 
 std::optional<reserved_token> get_operator(push_back_stream& stream)
 {
-    auto                          candidates{ std::make_pair(operator_token_map.begin(), operator_token_map.end()) };
-    std::optional<reserved_token> ret;
-    u32                           match_size{ 0 };
-    std::stack<i32>               chars;
+    std::optional<reserved_token>            ret;
+    u32                                      match_size{ 0 };
+    std::array<i32, max_operator_length + 1> chars{};
+    u32                                      read{ 0 };
 
-    for (u32 i{ 0 }; candidates.first != candidates.second; ++i)
+    for (u8 state{ operator_dfa::start }; read < chars.size();)
     {
-        chars.push(stream());
-        candidates = std::equal_range(candidates.first, candidates.second, (char) chars.top(), comparator{ i });
+        chars[read] = stream();
+        state       = operator_table.step(state, chars[read++]);
 
-        if (candidates.first != candidates.second && candidates.first->first.size() == i + 1)
+        if (state == operator_dfa::dead)
+            break;
+        if (operator_table.accepting(state))
         {
-            match_size = i + 1;
-            ret        = candidates.first->second;
+            match_size = read;
+            ret        = operator_table.token(state);
         }
     }
 
-    while (chars.size() > match_size)
+    while (read > match_size)
     {
-        stream.push_back(chars.top());
-        chars.pop();
+        stream.push_back(chars[--read]);
     }
 
     return ret;
 }
 
 
-token tokenize(push_back_stream& stream)
+token tokenize(push_back_stream& stream, symbol_table& symbols, error::diagnostics& diag)
 {
     while (true)
     {
+        stream.mark();
         u32 line_number{ stream.line_number() };
         u32 char_index{ stream.char_index() };
         switch (const i32 c{ stream() }; get_character_type(c))
         {
         case character_type::eof: return { eof{}, line_number, char_index };
-        case character_type::space: continue;
-        case character_type::alphanum: stream.push_back(c); return fetch_word(stream);
+        case character_type::space:
+            stream.scan_to([](std::string_view text, size_t pos) { return utl::skip_whitespace(text, pos); });
+            continue;
+        case character_type::alphanum:
+            stream.push_back(c);
+            return std::isdigit(c) ? fetch_number(stream, diag) : fetch_word(stream, symbols);
         case character_type::punct:
             //{
             switch (c)
             {
-            case '"': return fetch_string(stream);
+            case '"': stream.push_back(c); return fetch_string(stream, symbols, diag);
             case '/':
             {
                 switch (const i32 ch{ stream() })
                 {
                 case '/': skip_line_comment(stream); continue;
-                case '*': skip_block_comment(stream); continue;
+                case '*': skip_block_comment(stream, diag); continue;
                 default: stream.push_back(ch);
                 }
             }
-            default: stream.push_back(c); return fetch_operator(stream);
+            default:
+                stream.push_back(c);
+                if (const std::optional tk{ fetch_operator(stream, diag) })
+                    return *tk;
+                continue;
             }
             //}
             break;
@@ -396,7 +720,7 @@ bool token::is_number() const
 
 bool token::is_string() const
 {
-    return std::holds_alternative<std::string>(m_value);
+    return std::holds_alternative<string_literal>(m_value);
 }
 
 bool token::is_eof() const
@@ -409,7 +733,7 @@ reserved_token token::reserved_token() const
     return std::get<enum reserved_token>(m_value);
 }
 
-std::string_view token::identifier() const
+symbol_id token::identifier() const
 {
     return std::get<struct identifier>(m_value).name;
 }
@@ -419,9 +743,9 @@ f64 token::number() const
     return std::get<f64>(m_value);
 }
 
-std::string_view token::string() const
+symbol_id token::string() const
 {
-    return std::get<std::string>(m_value);
+    return std::get<string_literal>(m_value).value;
 }
 
 } // namespace ptl
\ No newline at end of file
@@ -28,10 +28,13 @@
 
 #include <optional>
 #include <ostream>
+#include <span>
 #include <variant>
 #include <string_view>
 
 #include "PushBackStream.h"
+#include "SymbolTable.h"
+#include "Debug/Errors.h"
 
 namespace ptl
 {
@@ -106,7 +109,12 @@ enum struct reserved_token
 
 struct identifier
 {
-    std::string name{};
+    symbol_id name{};
+};
+
+struct string_literal
+{
+    symbol_id value{};
 };
 
 struct eof
@@ -117,11 +125,15 @@ std::ostream& operator<<(std::ostream& os, reserved_token tk);
 std::optional<reserved_token> get_keyword(std::string_view word);
 std::optional<reserved_token> get_operator(push_back_stream& stream);
 
+// Every operator with its spelling, the table get_operator is built from
+std::span<const std::pair<std::string_view, reserved_token>> operator_spellings();
+
 class token
 {
 private:
-    using token_v = std::variant<reserved_token, identifier, f64, std::string, eof>;
+    using token_v = std::variant<reserved_token, identifier, f64, string_literal, eof>;
 public:
+    token() : m_value{ eof{} } {}
     token(token_v value, u32 line_number, u32 char_index) : m_value{std::move(value)}, m_line_number{ line_number }, m_char_index{ char_index }{}
 
     [[nodiscard]] bool is_reserved_token() const;
@@ -131,9 +143,9 @@ public:
     [[nodiscard]] bool is_eof() const;
 
     [[nodiscard]] reserved_token reserved_token() const;
-    [[nodiscard]] std::string_view identifier() const;
+    [[nodiscard]] symbol_id identifier() const;
     [[nodiscard]] f64 number() const;
-    [[nodiscard]] std::string_view string() const;
+    [[nodiscard]] symbol_id string() const;
 
     [[nodiscard]] u32 line_number() const { return m_line_number; }
     [[nodiscard]] u32 char_index() const { return m_char_index; }
@@ -144,6 +156,7 @@ private:
 };
 
 
-token tokenize(push_back_stream& stream);
+// Next token of stream. Lexing errors go to diag and the lexer carries on after them, so this always returns a token
+token tokenize(push_back_stream& stream, symbol_table& symbols, error::diagnostics& diag);
 
 } // namespace ptl
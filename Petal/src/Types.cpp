@@ -23,127 +23,131 @@
 
 #include "Types.h"
 
+#include <cassert>
+#include <memory>
+
 namespace ptl
 {
 
 namespace
 {
-type_t void_type;
-type_t number_type;
-type_t string_type;
-} // anonymous namespace
-
 
-type_registry::type_registry()
+u64 mix(u64 hash, u64 value)
 {
-    m_types.emplace(simple_type::nothing);
-    m_types.emplace(simple_type::number);
-    m_types.emplace(simple_type::string);
+    hash ^= value + 0x9E3779B97F4A7C15ull + (hash << 6) + (hash >> 2);
+    return hash;
 }
 
-
-type_handle type_registry::get_handle(const type_t& t)
+u64 hash_type(const type_t& t)
 {
     return std::visit(overloaded{
-                          [](const simple_type st) {
-                              switch (st)
+                          [](const simple_type st) { return mix(0, (u64) st); },
+                          [](const array_type& at) { return mix(1, (u64) at.inner_type_id); },
+                          [](const function_type& ft) {
+                              u64 ret{ mix(2, (u64) ft.return_type_id) };
+                              for (const auto& [type_id, by_ref] : ft.parameter_type_id)
                               {
-                              case simple_type::nothing: return void_handle();
-                              case simple_type::number: return number_handle();
-                              case simple_type::string: return string_handle();
+                                  ret = mix(ret, ((u64) type_id << 1) | by_ref);
                               }
+                              return ret;
                           },
-                          [this](const auto& tt) { return &*m_types.insert(tt).first; },
                       },
                       t);
 }
 
-type_handle type_registry::void_handle()
-{
-    return &void_type;
-}
+} // anonymous namespace
+
 
-type_handle type_registry::number_handle()
+type_registry::type_registry()
 {
-    return &number_type;
+    append(simple_type::nothing);
+    append(simple_type::number);
+    append(simple_type::string);
 }
 
-type_handle type_registry::string_handle()
+type_registry::~type_registry()
 {
-    return &string_type;
+    for (std::atomic<entry*>& chunk : m_chunks)
+    {
+        delete[] chunk.load(std::memory_order_relaxed);
+    }
 }
 
-bool type_registry::types_less::operator()(const type_t& t1, const type_t& t2) const
+
+type_handle type_registry::get_handle(const type_t& t)
 {
-    const size_t idx1{ t1.index() };
+    if (const simple_type* st{ std::get_if<simple_type>(&t) })
+        return type_handle{ (u32) *st };
 
-    if (const size_t idx2{ t2.index() }; idx1 != idx2)
-        return idx1 < idx2;
+    const u64 hash{ hash_type(t) };
+    shard&    s{ m_shards[hash % shard_count] };
 
-    switch (idx1)
-    {
-    case 0: return std::get<0>(t1) < std::get<0>(t2);
-    case 1: return std::get<1>(t1).inner_type_id < std::get<1>(t2).inner_type_id;
-    case 2:
+    const std::lock_guard lock{ s.mutex };
+    for (auto [it, end]{ s.handles.equal_range(hash) }; it != end; ++it)
     {
-        const auto& [return_type_id1, parameter_type_id1]{ std::get<2>(t1) };
-        const auto& [return_type_id2, parameter_type_id2]{ std::get<2>(t2) };
-
-        if (return_type_id1 != return_type_id2)
-            return return_type_id1 < return_type_id2;
-        if (parameter_type_id1.size() != parameter_type_id2.size())
-            return parameter_type_id1.size() < parameter_type_id2.size();
-
-        for (u32 i{ 0 }; i < parameter_type_id1.size(); ++i)
-        {
-            if (parameter_type_id1[i].type_id != parameter_type_id2[i].type_id)
-                return parameter_type_id1[i].type_id < parameter_type_id2[i].type_id;
-            if (parameter_type_id1[i].by_ref != parameter_type_id2[i].by_ref)
-                return parameter_type_id1[i].by_ref < parameter_type_id2[i].by_ref;
-        }
-    }
-    break;
-    default: break;
+        if (get(it->second) == t)
+            return it->second;
     }
 
-    return false;
+    const type_handle ret{ append(t) };
+    s.handles.emplace(hash, ret);
+    return ret;
 }
 
-} // namespace ptl::type
-
-namespace std
+type_handle type_registry::append(type_t t)
 {
-using namespace ptl;
+    const u32 id{ m_size.fetch_add(1, std::memory_order_relaxed) };
+    assert(id < chunk_size * max_chunks);
 
-std::string to_string(type_handle t)
-{
-    return std::visit(overloaded{
-                          [](const simple_type st) {
-                              switch (st)
-                              {
-                              case simple_type::nothing: return std::string{ "void" };
-                              case simple_type::number: return std::string{ "number" };
-                              case simple_type::string: return std::string{ "string" };
-                              }
-                          },
-                          [](const array_type& at) {
-                              std::string ret{ to_string(at.inner_type_id) };
-                              ret += "[]";
-                              return ret;
-                          },
-                          [](const function_type& ft) {
-                              std::string ret{ to_string(ft.return_type_id) + "(" };
-                              auto        separator{ "" };
-                              for (const auto& [type_id, by_ref] : ft.parameter_type_id)
-                              {
-                                  ret += separator + to_string(type_id) + (by_ref ? "&" : "");
-                                  separator = ",";
-                              }
-                              ret += ")";
-                              return ret;
-                          },
-                      },
-                      *t);
+    std::atomic<entry*>& chunk{ m_chunks[id / chunk_size] };
+    entry*               entries{ chunk.load(std::memory_order_acquire) };
+    if (!entries)
+    {
+        const std::lock_guard lock{ m_chunk_mutex };
+        entries = chunk.load(std::memory_order_acquire);
+        if (!entries)
+        {
+            entries = new entry[chunk_size];
+            chunk.store(entries, std::memory_order_release);
+        }
+    }
+
+    // Inner types are always registered first, so their names are already there to be pasted together
+    entry& e{ entries[id % chunk_size] };
+    e.name = std::visit(overloaded{
+                            [](const simple_type st) {
+                                switch (st)
+                                {
+                                case simple_type::nothing: return std::string{ "void" };
+                                case simple_type::number: return std::string{ "number" };
+                                case simple_type::string: return std::string{ "string" };
+                                }
+                                return std::string{};
+                            },
+                            [this](const array_type& at) {
+                                std::string ret{ name(at.inner_type_id) };
+                                ret += "[]";
+                                return ret;
+                            },
+                            [this](const function_type& ft) {
+                                std::string ret{ name(ft.return_type_id) };
+                                ret += "(";
+                                auto separator{ "" };
+                                for (const auto& [type_id, by_ref] : ft.parameter_type_id)
+                                {
+                                    ret += separator;
+                                    ret += name(type_id);
+                                    ret += by_ref ? "&" : "";
+                                    separator = ",";
+                                }
+                                ret += ")";
+                                return ret;
+                            },
+                        },
+                        t);
+    e.type = std::move(t);
+
+    return type_handle{ id };
 }
 
-} // namespace std
+} // namespace ptl
@@ -22,8 +22,12 @@
 //  ------------------------------------------------------------------------------
 
 #pragma once
-#include <set>
+#include <array>
+#include <atomic>
+#include <mutex>
 #include <string>
+#include <string_view>
+#include <unordered_map>
 #include <variant>
 #include <vector>
 
@@ -42,10 +46,10 @@ enum struct simple_type
 };
 
 
-struct function_type;
-struct array_type;
-using type_t      = std::variant<simple_type, array_type, function_type>;
-using type_handle = const type_t*;
+// Dense id of a type in its type_registry, two types are the same exactly when their handles are equal
+enum struct type_handle : u32
+{
+};
 
 struct function_type
 {
@@ -53,41 +57,105 @@ struct function_type
     {
         type_handle type_id{};
         bool        by_ref{};
+
+        bool operator==(const parameter&) const = default;
     };
 
     type_handle            return_type_id{};
     std::vector<parameter> parameter_type_id{};
+
+    bool operator==(const function_type&) const = default;
 };
 
 struct array_type
 {
     type_handle inner_type_id{};
+
+    bool operator==(const array_type&) const = default;
 };
 
+using type_t = std::variant<simple_type, array_type, function_type>;
+
 
+// Hash-consed types: every distinct type is stored once and gets the next dense id, void, number and string have the
+// fixed ids 0, 1 and 2. get_handle can be called from several threads at once, it only locks one of shard_count
+// shards picked by the type's hash. Reading a type or its name back from a handle never locks: entries live in
+// fixed-size chunks that are never moved and are complete before their handle is handed out
 class type_registry
 {
 public:
     type_registry();
+    ~type_registry();
+
+    type_registry(const type_registry&)            = delete;
+    type_registry& operator=(const type_registry&) = delete;
 
     [[nodiscard]] type_handle get_handle(const type_t& t);
 
-    static type_handle void_handle();
-    static type_handle number_handle();
-    static type_handle string_handle();
+    [[nodiscard]] const type_t& get(type_handle t) const { return at(t).type; }
+
+    template<typename T>
+    [[nodiscard]] const T* get_if(type_handle t) const
+    {
+        return std::get_if<T>(&get(t));
+    }
+
+    // Petal spelling of the type, e.g. number[] or void(string,number&), built once when the type is first seen
+    [[nodiscard]] std::string_view name(type_handle t) const { return at(t).name; }
+
+    [[nodiscard]] u32 size() const { return m_size.load(std::memory_order_relaxed); }
+
+    static constexpr type_handle void_handle() { return type_handle{ 0 }; }
+    static constexpr type_handle number_handle() { return type_handle{ 1 }; }
+    static constexpr type_handle string_handle() { return type_handle{ 2 }; }
+
+    // Whether a value of type from can be used where to is expected: everything converts to void, number converts to
+    // string and any other type only to itself. Between the fixed ids this is one table lookup
+    static constexpr bool is_convertible(type_handle from, type_handle to)
+    {
+        if ((u32) from < fixed_count && (u32) to < fixed_count)
+            return conversions[(u32) from][(u32) to];
+        return to == void_handle() || from == to;
+    }
 
 private:
-    struct types_less
+    static constexpr u32 fixed_count{ 3 };
+
+    // [from][to] over void, number and string
+    static constexpr bool conversions[fixed_count][fixed_count]{
+        { true, false, false },
+        { true, true, true },
+        { true, false, true },
+    };
+
+    struct entry
     {
-        bool operator()(const type_t& t1, const type_t& t2) const;
+        type_t      type{};
+        std::string name{};
     };
 
-    std::set<type_t, types_less> m_types{};
-};
+    struct shard
+    {
+        std::mutex                                 mutex{};
+        std::unordered_multimap<u64, type_handle> handles{}; // by hash of the type
+    };
 
-} // namespace ptl::type
+    static constexpr u32 chunk_size{ 256 };
+    static constexpr u32 max_chunks{ 4 * 1024 };
+    static constexpr u32 shard_count{ 16 };
 
-namespace std
-{
-std::string to_string(ptl::type_handle t);
-}
+    [[nodiscard]] const entry& at(type_handle t) const
+    {
+        const u32 id{ (u32) t };
+        return m_chunks[id / chunk_size].load(std::memory_order_acquire)[id % chunk_size];
+    }
+
+    type_handle append(type_t t);
+
+    std::array<std::atomic<entry*>, max_chunks> m_chunks{};
+    std::atomic<u32>                            m_size{};
+    std::mutex                                  m_chunk_mutex{};
+    std::array<shard, shard_count>              m_shards{};
+};
+
+} // namespace ptl
@@ -0,0 +1,68 @@
+// ------------------------------------------------------------------------------
+//
+// Petal
+//    Copyright 2023 Matthew Rogers
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//
+//        http://www.apache.org/licenses/LICENSE-2.0
+//
+//    Unless required by applicable law or agreed to in writing, software
+//    distributed under the License is distributed on an "AS IS" BASIS,
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//    See the License for the specific language governing permissions and
+//    limitations under the License.
+//
+// File Name: Arena.cpp
+// Date File Created: 10/17/2026
+// Author: Matt
+//
+// ------------------------------------------------------------------------------
+
+#include "Arena.h"
+
+#include <algorithm>
+
+namespace ptl::utl
+{
+
+void arena::release()
+{
+    m_blocks.clear();
+    reset();
+}
+
+size_t arena::used() const
+{
+    size_t ret{ m_used };
+    for (size_t i{ 0 }; i < m_block && i < m_blocks.size(); ++i)
+    {
+        ret += m_blocks[i].size;
+    }
+    return ret;
+}
+
+void* arena::allocate_slow(size_t size, size_t alignment)
+{
+    // Move on to the next block that fits, blocks kept from before a reset are reused in order
+    const size_t needed{ size + alignment - 1 };
+    for (++m_block; m_block < m_blocks.size(); ++m_block)
+    {
+        if (m_blocks[m_block].size >= needed)
+            break;
+    }
+
+    if (m_block >= m_blocks.size())
+    {
+        const size_t new_size{ std::max(block_size, needed) };
+        m_blocks.push_back({ create_scope<std::byte[]>(new_size), new_size });
+        m_block = m_blocks.size() - 1;
+    }
+
+    m_used = 0;
+    return allocate(size, alignment);
+}
+
+} // namespace ptl::utl
@@ -0,0 +1,110 @@
+// ------------------------------------------------------------------------------
+//
+// Petal
+//    Copyright 2023 Matthew Rogers
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//
+//        http://www.apache.org/licenses/LICENSE-2.0
+//
+//    Unless required by applicable law or agreed to in writing, software
+//    distributed under the License is distributed on an "AS IS" BASIS,
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//    See the License for the specific language governing permissions and
+//    limitations under the License.
+//
+// File Name: Arena.h
+// Date File Created: 10/17/2026
+// Author: Matt
+//
+// ------------------------------------------------------------------------------
+
+#pragma once
+
+#include "Common.h"
+
+#include <cstring>
+#include <new>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+namespace ptl::utl
+{
+
+// Bump allocator for data that lives exactly as long as one compilation. Objects are never destroyed one by one, so
+// only trivially destructible types can be created in it. reset() rewinds to the first block and keeps every block
+// for the next compilation, release() gives the memory back
+class arena
+{
+public:
+    static constexpr size_t block_size{ 64 * 1024 };
+
+    arena() = default;
+
+    arena(arena&&) noexcept            = default;
+    arena& operator=(arena&&) noexcept = default;
+
+    arena(const arena&)            = delete;
+    arena& operator=(const arena&) = delete;
+
+    void* allocate(size_t size, size_t alignment)
+    {
+        const size_t pos{ (m_used + alignment - 1) & ~(alignment - 1) };
+        if (m_block < m_blocks.size() && pos + size <= m_blocks[m_block].size)
+        {
+            m_used = pos + size;
+            return m_blocks[m_block].data.get() + pos;
+        }
+
+        return allocate_slow(size, alignment);
+    }
+
+    template<typename T, typename... Args>
+    T* create(Args&&... args)
+    {
+        static_assert(std::is_trivially_destructible_v<T>, "arena objects are never destroyed");
+        return new (allocate(sizeof(T), alignof(T))) T{ std::forward<Args>(args)... };
+    }
+
+    // Copy of values in the arena
+    template<typename T>
+    std::span<T> copy(std::span<const T> values)
+    {
+        static_assert(std::is_trivially_copyable_v<T>, "arena arrays are copied bytewise");
+        if (values.empty())
+            return {};
+
+        T* ret{ (T*) allocate(values.size_bytes(), alignof(T)) };
+        std::memcpy(ret, values.data(), values.size_bytes());
+        return { ret, values.size() };
+    }
+
+    void reset()
+    {
+        m_block = 0;
+        m_used  = 0;
+    }
+
+    void release();
+
+    // Bytes handed out since the last reset, padding included
+    [[nodiscard]] size_t used() const;
+
+private:
+    struct block
+    {
+        scope<std::byte[]> data{};
+        size_t             size{};
+    };
+
+    void* allocate_slow(size_t size, size_t alignment);
+
+    std::vector<block> m_blocks{};
+    size_t             m_block{};
+    size_t             m_used{};
+};
+
+} // namespace ptl::utl
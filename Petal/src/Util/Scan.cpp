@@ -0,0 +1,306 @@
+// ------------------------------------------------------------------------------
+//
+// Petal
+//    Copyright 2023 Matthew Rogers
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//
+//        http://www.apache.org/licenses/LICENSE-2.0
+//
+//    Unless required by applicable law or agreed to in writing, software
+//    distributed under the License is distributed on an "AS IS" BASIS,
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//    See the License for the specific language governing permissions and
+//    limitations under the License.
+//
+// File Name: Scan.cpp
+// Date File Created: 10/17/2026
+// Author: Matt
+//
+// ------------------------------------------------------------------------------
+
+#include "Scan.h"
+
+#include <bit>
+
+#if defined(_M_X64) || defined(__x86_64__)
+    #define PTL_SCAN_X86
+    #include <immintrin.h>
+    #ifdef _MSC_VER
+        #include <intrin.h>
+    #endif
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+    #define PTL_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+    #define PTL_TARGET_AVX2
+#endif
+
+namespace ptl::utl
+{
+namespace
+{
+
+struct scan_kernels
+{
+    size_t (*skip_whitespace)(const char* data, size_t size, size_t pos);
+    size_t (*find_byte)(const char* data, size_t size, size_t pos, char c);
+    size_t (*find_string_special)(const char* data, size_t size, size_t pos);
+    u32 (*count_newlines)(const char* data, size_t begin, size_t end);
+    const char* name;
+};
+
+// Scalar ----------------------------------------------------------------------
+
+constexpr bool is_whitespace(char c)
+{
+    return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+constexpr bool is_string_special(char c)
+{
+    return c == '"' || c == '\\' || c == '\t' || c == '\n' || c == '\r';
+}
+
+size_t skip_whitespace_scalar(const char* data, size_t size, size_t pos)
+{
+    while (pos < size && is_whitespace(data[pos]))
+    {
+        ++pos;
+    }
+    return pos;
+}
+
+size_t find_byte_scalar(const char* data, size_t size, size_t pos, char c)
+{
+    while (pos < size && data[pos] != c)
+    {
+        ++pos;
+    }
+    return pos;
+}
+
+size_t find_string_special_scalar(const char* data, size_t size, size_t pos)
+{
+    while (pos < size && !is_string_special(data[pos]))
+    {
+        ++pos;
+    }
+    return pos;
+}
+
+u32 count_newlines_scalar(const char* data, size_t begin, size_t end)
+{
+    u32 ret{ 0 };
+    for (size_t i{ begin }; i < end; ++i)
+    {
+        ret += data[i] == '\n';
+    }
+    return ret;
+}
+
+#ifdef PTL_SCAN_X86
+
+// SSE2, always available on x64 ----------------------------------------------
+
+u32 whitespace_mask_sse2(__m128i v)
+{
+    // \t..\r is a contiguous range, shift it down to 0..4 and do an unsigned <= through min
+    const __m128i shifted{ _mm_sub_epi8(v, _mm_set1_epi8('\t')) };
+    const __m128i control{ _mm_cmpeq_epi8(_mm_min_epu8(shifted, _mm_set1_epi8(4)), shifted) };
+    const __m128i space{ _mm_cmpeq_epi8(v, _mm_set1_epi8(' ')) };
+    return (u32) _mm_movemask_epi8(_mm_or_si128(control, space));
+}
+
+u32 string_special_mask_sse2(__m128i v)
+{
+    const __m128i quote{ _mm_cmpeq_epi8(v, _mm_set1_epi8('"')) };
+    const __m128i backslash{ _mm_cmpeq_epi8(v, _mm_set1_epi8('\\')) };
+    const __m128i tab{ _mm_cmpeq_epi8(v, _mm_set1_epi8('\t')) };
+    const __m128i new_line{ _mm_cmpeq_epi8(v, _mm_set1_epi8('\n')) };
+    const __m128i carriage_return{ _mm_cmpeq_epi8(v, _mm_set1_epi8('\r')) };
+    return (u32) _mm_movemask_epi8(
+        _mm_or_si128(_mm_or_si128(quote, backslash), _mm_or_si128(tab, _mm_or_si128(new_line, carriage_return))));
+}
+
+size_t skip_whitespace_sse2(const char* data, size_t size, size_t pos)
+{
+    for (; pos + 16 <= size; pos += 16)
+    {
+        const u32 mask{ ~whitespace_mask_sse2(_mm_loadu_si128((const __m128i*) (data + pos))) & 0xFFFFu };
+        if (mask)
+            return pos + std::countr_zero(mask);
+    }
+    return skip_whitespace_scalar(data, size, pos);
+}
+
+size_t find_byte_sse2(const char* data, size_t size, size_t pos, char c)
+{
+    const __m128i needle{ _mm_set1_epi8(c) };
+    for (; pos + 16 <= size; pos += 16)
+    {
+        const __m128i v{ _mm_loadu_si128((const __m128i*) (data + pos)) };
+        if (const u32 mask{ (u32) _mm_movemask_epi8(_mm_cmpeq_epi8(v, needle)) })
+            return pos + std::countr_zero(mask);
+    }
+    return find_byte_scalar(data, size, pos, c);
+}
+
+size_t find_string_special_sse2(const char* data, size_t size, size_t pos)
+{
+    for (; pos + 16 <= size; pos += 16)
+    {
+        if (const u32 mask{ string_special_mask_sse2(_mm_loadu_si128((const __m128i*) (data + pos))) })
+            return pos + std::countr_zero(mask);
+    }
+    return find_string_special_scalar(data, size, pos);
+}
+
+u32 count_newlines_sse2(const char* data, size_t begin, size_t end)
+{
+    const __m128i new_line{ _mm_set1_epi8('\n') };
+    u32           ret{ 0 };
+    for (; begin + 16 <= end; begin += 16)
+    {
+        const __m128i v{ _mm_loadu_si128((const __m128i*) (data + begin)) };
+        ret += (u32) std::popcount((u32) _mm_movemask_epi8(_mm_cmpeq_epi8(v, new_line)));
+    }
+    return ret + count_newlines_scalar(data, begin, end);
+}
+
+// AVX2 -----------------------------------------------------------------------
+
+PTL_TARGET_AVX2 u32 whitespace_mask_avx2(__m256i v)
+{
+    const __m256i shifted{ _mm256_sub_epi8(v, _mm256_set1_epi8('\t')) };
+    const __m256i control{ _mm256_cmpeq_epi8(_mm256_min_epu8(shifted, _mm256_set1_epi8(4)), shifted) };
+    const __m256i space{ _mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')) };
+    return (u32) _mm256_movemask_epi8(_mm256_or_si256(control, space));
+}
+
+PTL_TARGET_AVX2 u32 string_special_mask_avx2(__m256i v)
+{
+    const __m256i quote{ _mm256_cmpeq_epi8(v, _mm256_set1_epi8('"')) };
+    const __m256i backslash{ _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\\')) };
+    const __m256i tab{ _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\t')) };
+    const __m256i new_line{ _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n')) };
+    const __m256i carriage_return{ _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\r')) };
+    return (u32) _mm256_movemask_epi8(
+        _mm256_or_si256(_mm256_or_si256(quote, backslash), _mm256_or_si256(tab, _mm256_or_si256(new_line, carriage_return))));
+}
+
+PTL_TARGET_AVX2 size_t skip_whitespace_avx2(const char* data, size_t size, size_t pos)
+{
+    for (; pos + 32 <= size; pos += 32)
+    {
+        const u32 mask{ ~whitespace_mask_avx2(_mm256_loadu_si256((const __m256i*) (data + pos))) };
+        if (mask)
+            return pos + std::countr_zero(mask);
+    }
+    return skip_whitespace_sse2(data, size, pos);
+}
+
+PTL_TARGET_AVX2 size_t find_byte_avx2(const char* data, size_t size, size_t pos, char c)
+{
+    const __m256i needle{ _mm256_set1_epi8(c) };
+    for (; pos + 32 <= size; pos += 32)
+    {
+        const __m256i v{ _mm256_loadu_si256((const __m256i*) (data + pos)) };
+        if (const u32 mask{ (u32) _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, needle)) })
+            return pos + std::countr_zero(mask);
+    }
+    return find_byte_sse2(data, size, pos, c);
+}
+
+PTL_TARGET_AVX2 size_t find_string_special_avx2(const char* data, size_t size, size_t pos)
+{
+    for (; pos + 32 <= size; pos += 32)
+    {
+        if (const u32 mask{ string_special_mask_avx2(_mm256_loadu_si256((const __m256i*) (data + pos))) })
+            return pos + std::countr_zero(mask);
+    }
+    return find_string_special_sse2(data, size, pos);
+}
+
+PTL_TARGET_AVX2 u32 count_newlines_avx2(const char* data, size_t begin, size_t end)
+{
+    const __m256i new_line{ _mm256_set1_epi8('\n') };
+    u32           ret{ 0 };
+    for (; begin + 32 <= end; begin += 32)
+    {
+        const __m256i v{ _mm256_loadu_si256((const __m256i*) (data + begin)) };
+        ret += (u32) std::popcount((u32) _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, new_line)));
+    }
+    return ret + count_newlines_sse2(data, begin, end);
+}
+
+bool has_avx2()
+{
+    #ifdef _MSC_VER
+    i32 info[4]{};
+    __cpuid(info, 0);
+    if (info[0] < 7)
+        return false;
+
+    // AVX2 also needs the OS to save the upper halves of the ymm registers
+    __cpuid(info, 1);
+    const bool os_saves_ymm{ (info[2] & (1 << 27)) != 0 && (info[2] & (1 << 28)) != 0 && (_xgetbv(0) & 6) == 6 };
+    if (!os_saves_ymm)
+        return false;
+
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+    #else
+    return __builtin_cpu_supports("avx2");
+    #endif
+}
+
+#endif
+
+const scan_kernels& kernels()
+{
+    static const scan_kernels ret{ [] {
+#ifdef PTL_SCAN_X86
+        if (has_avx2())
+            return scan_kernels{ skip_whitespace_avx2, find_byte_avx2, find_string_special_avx2, count_newlines_avx2, "avx2" };
+        return scan_kernels{ skip_whitespace_sse2, find_byte_sse2, find_string_special_sse2, count_newlines_sse2, "sse2" };
+#else
+        return scan_kernels{ skip_whitespace_scalar, find_byte_scalar, find_string_special_scalar, count_newlines_scalar,
+                             "scalar" };
+#endif
+    }() };
+
+    return ret;
+}
+
+} // anonymous namespace
+
+size_t skip_whitespace(std::string_view text, size_t pos)
+{
+    return kernels().skip_whitespace(text.data(), text.size(), pos);
+}
+
+size_t find_byte(std::string_view text, size_t pos, char c)
+{
+    return kernels().find_byte(text.data(), text.size(), pos, c);
+}
+
+size_t find_string_special(std::string_view text, size_t pos)
+{
+    return kernels().find_string_special(text.data(), text.size(), pos);
+}
+
+u32 count_newlines(std::string_view text, size_t begin, size_t end)
+{
+    return kernels().count_newlines(text.data(), begin, end);
+}
+
+const char* scan_implementation()
+{
+    return kernels().name;
+}
+
+} // namespace ptl::utl
@@ -0,0 +1,52 @@
+// ------------------------------------------------------------------------------
+//
+// Petal
+//    Copyright 2023 Matthew Rogers
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//
+//        http://www.apache.org/licenses/LICENSE-2.0
+//
+//    Unless required by applicable law or agreed to in writing, software
+//    distributed under the License is distributed on an "AS IS" BASIS,
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//    See the License for the specific language governing permissions and
+//    limitations under the License.
+//
+// File Name: Scan.h
+// Date File Created: 10/17/2026
+// Author: Matt
+//
+// ------------------------------------------------------------------------------
+
+#pragma once
+
+#include "Common.h"
+
+#include <string_view>
+
+namespace ptl::utl
+{
+
+// Byte scanning kernels used by the lexer. On x86 they run 32 (AVX2) or 16 (SSE2) bytes at a time, the
+// implementation is picked once at runtime and there is a scalar fallback for everything else.
+// Positions are indices into text, text.size() is returned when nothing matches
+
+// First index at or after pos that is not whitespace (' ', \t, \n, \v, \f, \r)
+size_t skip_whitespace(std::string_view text, size_t pos);
+
+// First index at or after pos holding c
+size_t find_byte(std::string_view text, size_t pos, char c);
+
+// First index at or after pos that ends the plain part of a string literal: '"', '\\', \t, \n or \r
+size_t find_string_special(std::string_view text, size_t pos);
+
+// Number of '\n' in [begin, end)
+u32 count_newlines(std::string_view text, size_t begin, size_t end);
+
+// Name of the implementation in use, "avx2", "sse2" or "scalar"
+const char* scan_implementation();
+
+} // namespace ptl::utl
@@ -0,0 +1,174 @@
+// ------------------------------------------------------------------------------
+//
+// Petal
+//    Copyright 2023 Matthew Rogers
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//
+//        http://www.apache.org/licenses/LICENSE-2.0
+//
+//    Unless required by applicable law or agreed to in writing, software
+//    distributed under the License is distributed on an "AS IS" BASIS,
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//    See the License for the specific language governing permissions and
+//    limitations under the License.
+//
+// File Name: ThreadPool.cpp
+// Date File Created: 10/17/2026
+// Author: Matt
+//
+// ------------------------------------------------------------------------------
+
+#include "ThreadPool.h"
+
+#include <algorithm>
+
+namespace ptl::utl
+{
+
+thread_pool::thread_pool(u32 worker_count)
+{
+    worker_count = std::max(worker_count, 1u);
+
+    m_queues.reserve(worker_count);
+    for (u32 i{ 0 }; i < worker_count; ++i)
+    {
+        m_queues.push_back(create_scope<queue>());
+    }
+
+    m_threads.reserve(worker_count - 1);
+    for (u32 i{ 1 }; i < worker_count; ++i)
+    {
+        m_threads.emplace_back([this, i] { worker_loop(i); });
+    }
+}
+
+thread_pool::~thread_pool()
+{
+    {
+        std::lock_guard lock{ m_mutex };
+        m_stop = true;
+    }
+    m_start.notify_all();
+
+    for (std::thread& t : m_threads)
+    {
+        t.join();
+    }
+}
+
+void thread_pool::run(u32 task_count, const job_t& job)
+{
+    if (task_count == 0)
+        return;
+
+    // The job has to be visible before any task is, a worker still finishing the previous batch may pick tasks up early
+    m_job       = &job;
+    m_exception = nullptr;
+    m_pending   = task_count;
+
+    // Contiguous blocks per worker, neighbouring tasks tend to be similar in size
+    const u32 workers{ size() };
+    for (u32 w{ 0 }; w < workers; ++w)
+    {
+        std::lock_guard lock{ m_queues[w]->mutex };
+        for (u32 task{ (u32) ((u64) task_count * w / workers) }; task < (u32) ((u64) task_count * (w + 1) / workers); ++task)
+        {
+            m_queues[w]->tasks.push_back(task);
+        }
+    }
+
+    {
+        std::lock_guard lock{ m_mutex };
+        ++m_generation;
+    }
+    m_start.notify_all();
+
+    execute(0);
+
+    std::unique_lock lock{ m_mutex };
+    m_done.wait(lock, [this] { return m_pending == 0 && m_active == 0; });
+    m_job = nullptr;
+
+    if (m_exception)
+        std::rethrow_exception(m_exception);
+}
+
+void thread_pool::worker_loop(u32 worker)
+{
+    u64 seen_generation{ 0 };
+    while (true)
+    {
+        {
+            std::unique_lock lock{ m_mutex };
+            m_start.wait(lock, [&] { return m_stop || m_generation != seen_generation; });
+            if (m_stop)
+                return;
+
+            seen_generation = m_generation;
+            ++m_active;
+        }
+
+        execute(worker);
+
+        std::lock_guard lock{ m_mutex };
+        if (--m_active == 0)
+            m_done.notify_all();
+    }
+}
+
+void thread_pool::execute(u32 worker)
+{
+    u32 task{};
+    while (next_task(worker, task))
+    {
+        try
+        {
+            (*m_job)(task, worker);
+        } catch (...)
+        {
+            std::lock_guard lock{ m_mutex };
+            if (!m_exception)
+                m_exception = std::current_exception();
+        }
+
+        if (m_pending.fetch_sub(1) == 1)
+        {
+            std::lock_guard lock{ m_mutex };
+            m_done.notify_all();
+        }
+    }
+}
+
+bool thread_pool::next_task(u32 worker, u32& task)
+{
+    {
+        queue& own{ *m_queues[worker] };
+        std::lock_guard lock{ own.mutex };
+        if (!own.tasks.empty())
+        {
+            task = own.tasks.back();
+            own.tasks.pop_back();
+            return true;
+        }
+    }
+
+    const u32 workers{ size() };
+    for (u32 i{ 1 }; i < workers; ++i)
+    {
+        queue&          victim{ *m_queues[(worker + i) % workers] };
+        std::lock_guard lock{ victim.mutex };
+        if (!victim.tasks.empty())
+        {
+            task = victim.tasks.front();
+            victim.tasks.pop_front();
+            return true;
+        }
+    }
+
+    return false;
+}
+
+} // namespace ptl::utl
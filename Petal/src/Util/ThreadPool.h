@@ -0,0 +1,82 @@
+// ------------------------------------------------------------------------------
+//
+// Petal
+//    Copyright 2023 Matthew Rogers
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//
+//        http://www.apache.org/licenses/LICENSE-2.0
+//
+//    Unless required by applicable law or agreed to in writing, software
+//    distributed under the License is distributed on an "AS IS" BASIS,
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//    See the License for the specific language governing permissions and
+//    limitations under the License.
+//
+// File Name: ThreadPool.h
+// Date File Created: 10/17/2026
+// Author: Matt
+//
+// ------------------------------------------------------------------------------
+
+#pragma once
+
+#include "Common.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ptl::utl
+{
+
+// Fixed set of workers for data parallel batches. Every worker owns a task queue, takes work from the back of its own
+// queue and steals from the front of the others once it runs dry. The thread calling run() is worker 0
+class thread_pool
+{
+public:
+    using job_t = std::function<void(u32 task, u32 worker)>;
+
+    explicit thread_pool(u32 worker_count = std::thread::hardware_concurrency());
+    ~thread_pool();
+
+    thread_pool(const thread_pool&)            = delete;
+    thread_pool& operator=(const thread_pool&) = delete;
+
+    [[nodiscard]] u32 size() const { return (u32) m_queues.size(); }
+
+    // Calls job for every task in [0, task_count) and returns once all of them are done. The first exception thrown by
+    // a job is rethrown here after the batch finished. Not reentrant
+    void run(u32 task_count, const job_t& job);
+
+private:
+    struct queue
+    {
+        std::mutex      mutex{};
+        std::deque<u32> tasks{};
+    };
+
+    void worker_loop(u32 worker);
+    void execute(u32 worker);
+    bool next_task(u32 worker, u32& task);
+
+    std::vector<scope<queue>> m_queues{};
+    std::vector<std::thread>  m_threads{};
+    const job_t*              m_job{};
+    std::exception_ptr        m_exception{};
+    std::mutex                m_mutex{};
+    std::condition_variable   m_start{};
+    std::condition_variable   m_done{};
+    std::atomic<u32>          m_pending{};
+    u32                       m_active{};
+    u64                       m_generation{};
+    bool                      m_stop{};
+};
+
+} // namespace ptl::utl
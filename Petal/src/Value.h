@@ -0,0 +1,144 @@
+﻿//  ------------------------------------------------------------------------------
+//
+//  Petal
+//     Copyright 2023 Matthew Rogers
+//
+//     Licensed under the Apache License, Version 2.0 (the "License");
+//     you may not use this file except in compliance with the License.
+//     You may obtain a copy of the License at
+//
+//         http://www.apache.org/licenses/LICENSE-2.0
+//
+//     Unless required by applicable law or agreed to in writing, software
+//     distributed under the License is distributed on an "AS IS" BASIS,
+//     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//     See the License for the specific language governing permissions and
+//     limitations under the License.
+//
+//  File Name: Value.h
+//  Date File Created: 10/17/2026
+//  Author: Matt
+//
+//  ------------------------------------------------------------------------------
+
+#pragma once
+
+#include "Common.h"
+
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace ptl
+{
+
+struct function_code;
+struct instruction;
+
+// What a value holds at runtime, one for every kind of type_t a variable can have
+enum struct value_kind : u8
+{
+    number,
+    string,
+    array,
+    function,
+};
+
+// Header of every object on the heap, strings and arrays are garbage collected
+struct object
+{
+    object*    next{};
+    value_kind kind{};
+    bool       marked{};
+};
+
+struct string_object;
+struct array_object;
+struct function_object;
+
+// One register, global or array element, NaN-boxed into 64 bits. Numbers are stored as they are. Pointers to heap
+// objects hide in the negative quiet NaNs from 0xFFFC up, with the kind in the top 16 bits and the address in the low
+// 48. Arithmetic never produces those NaNs from numbers (x86 and ARM make 0xFFF8... or 0x7FF8... or keep an input's
+// payload), so only NaN constants have to be made canonical when they are loaded.
+// The compiler has already checked every operation, so the accessors do not check the kind. Reading a number out of
+// a string value is a compiler bug
+class value
+{
+public:
+    constexpr value() : m_bits{ 0 } {}
+    constexpr value(f64 number) : m_bits{ std::bit_cast<u64>(number) } {}
+    value(string_object* str) : m_bits{ string_tag | (u64) (uintptr_t) str } {}
+    value(array_object* arr) : m_bits{ array_tag | (u64) (uintptr_t) arr } {}
+    value(const function_object* fn) : m_bits{ function_tag | (u64) (uintptr_t) fn } {}
+
+    // Same number, with NaNs turned into the one quiet NaN so they cannot be mistaken for a pointer
+    static value canonical(f64 number)
+    {
+        return std::isnan(number) ? value{ std::numeric_limits<f64>::quiet_NaN() } : value{ number };
+    }
+
+    [[nodiscard]] value_kind kind() const
+    {
+        return is_number() ? value_kind::number : (value_kind) ((m_bits >> 48) - (string_tag >> 48) + 1);
+    }
+
+    [[nodiscard]] bool is_number() const { return m_bits < string_tag; }
+    [[nodiscard]] bool is_string() const { return (m_bits & tag_mask) == string_tag; }
+    [[nodiscard]] bool is_array() const { return (m_bits & tag_mask) == array_tag; }
+    [[nodiscard]] bool is_function() const { return (m_bits & tag_mask) == function_tag; }
+
+    [[nodiscard]] f64                    as_number() const { return std::bit_cast<f64>(m_bits); }
+    [[nodiscard]] string_object*         as_string() const { return (string_object*) pointer(); }
+    [[nodiscard]] array_object*          as_array() const { return (array_object*) pointer(); }
+    [[nodiscard]] const function_object* as_function() const { return (const function_object*) pointer(); }
+
+    // The heap object behind a string or array, nullptr for everything else. Strings and arrays share all tag bits
+    // but the lowest one
+    [[nodiscard]] object* as_object() const
+    {
+        return (m_bits >> 49) == (string_tag >> 49) ? (object*) pointer() : nullptr;
+    }
+
+    [[nodiscard]] u64 bits() const { return m_bits; }
+
+private:
+    static constexpr u64 tag_mask{ 0xFFFF'0000'0000'0000 };
+    static constexpr u64 string_tag{ 0xFFFC'0000'0000'0000 };
+    static constexpr u64 array_tag{ 0xFFFD'0000'0000'0000 };
+    static constexpr u64 function_tag{ 0xFFFE'0000'0000'0000 };
+    static constexpr u64 pointer_mask{ 0x0000'FFFF'FFFF'FFFF };
+
+    [[nodiscard]] void* pointer() const { return (void*) (uintptr_t) (m_bits & pointer_mask); }
+
+    u64 m_bits;
+};
+
+static_assert(sizeof(value) == 8);
+static_assert(std::is_trivially_copyable_v<value>);
+
+// Strings are immutable, concatenation makes a new one
+struct string_object : object
+{
+    std::string text{};
+};
+
+// Arrays have a fixed size once created
+struct array_object : object
+{
+    std::vector<value> elements{};
+};
+
+// A function of the running program. These live as long as the virtual machine and are not collected
+struct function_object
+{
+    const function_code* code{};
+    const instruction*   loaded{};  // the instructions of code the constants were loaded for
+    std::vector<value>   numbers{}; // the number constants of code, made canonical
+    std::vector<value>   strings{}; // the string constants of code, as heap strings
+};
+
+} // namespace ptl
@@ -0,0 +1,442 @@
+﻿//  ------------------------------------------------------------------------------
+//
+//  Petal
+//     Copyright 2023 Matthew Rogers
+//
+//     Licensed under the Apache License, Version 2.0 (the "License");
+//     you may not use this file except in compliance with the License.
+//     You may obtain a copy of the License at
+//
+//         http://www.apache.org/licenses/LICENSE-2.0
+//
+//     Unless required by applicable law or agreed to in writing, software
+//     distributed under the License is distributed on an "AS IS" BASIS,
+//     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//     See the License for the specific language governing permissions and
+//     limitations under the License.
+//
+//  File Name: VirtualMachine.cpp
+//  Date File Created: 10/17/2026
+//  Author: Matt
+//
+//  ------------------------------------------------------------------------------
+
+#include "VirtualMachine.h"
+#include "Operations.h"
+#include "Debug/Errors.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace ptl
+{
+namespace
+{
+
+[[noreturn]] void fail(const char* msg, const function_object* function, const instruction* pc)
+{
+    const function_code& code{ *function->code };
+    throw error::runtime(msg, code.lines[pc - 1 - code.code.data()]);
+}
+
+f64 from_bool(bool b)
+{
+    return b ? 1.0 : 0.0;
+}
+
+} // anonymous namespace
+
+virtual_machine::virtual_machine(const program& prog, u32 stack_size) :
+    m_program{ prog }, m_globals(prog.global_count), m_stack(stack_size)
+{
+    m_functions.reserve(prog.functions.size());
+    for (const function_code& code : prog.functions)
+    {
+        function_object& fn{ m_functions.emplace_back() };
+        fn.code = &code;
+        load_constants(fn);
+    }
+
+    m_empty_string = m_heap.new_string({});
+    m_frames.reserve(max_call_depth);
+}
+
+value virtual_machine::run(u32 function, std::span<const value> args)
+{
+    u64 executed{};
+    return execute<false>(function, args, executed);
+}
+
+value virtual_machine::run_counted(u32 function, std::span<const value> args, u64& executed)
+{
+    executed = 0;
+    return execute<true>(function, args, executed);
+}
+
+void virtual_machine::load_constants(function_object& fn)
+{
+    const function_code& code{ *fn.code };
+    fn.loaded = code.code.data();
+    fn.numbers.clear();
+    fn.strings.clear();
+
+    for (const f64 number : code.numbers)
+    {
+        fn.numbers.push_back(value::canonical(number));
+    }
+    for (u32 i{ 0 }; i < (u32) code.strings.size(); ++i)
+    {
+        fn.strings.emplace_back(m_heap.new_string(std::string{ code.string(i) }));
+    }
+}
+
+void virtual_machine::collect(const value* top)
+{
+    m_heap.mark({ m_stack.data(), top });
+    m_heap.mark(m_globals);
+    for (const function_object& fn : m_functions)
+    {
+        m_heap.mark(fn.strings);
+    }
+    m_heap.mark(m_empty_string);
+
+    m_heap.sweep();
+}
+
+template<bool Count>
+value virtual_machine::execute(u32 function, std::span<const value> args, u64& executed)
+{
+    const function_object* fn{ &m_functions[function] };
+    if (fn->loaded != fn->code->code.data())
+        load_constants(m_functions[function]);
+    if (args.size() != fn->code->param_count)
+        throw error::runtime("Wrong number of arguments", 0);
+    if (args.size() + fn->code->frame_size > m_stack.size())
+        throw error::runtime("Stack overflow", 0);
+
+    // The entry frame is laid out like any callee's: arguments below the frame pointer, the first one right below
+    value* fp{ m_stack.data() + args.size() };
+    for (size_t i{ 0 }; i < args.size(); ++i)
+    {
+        fp[-1 - (i64) i] = args[i];
+    }
+    std::fill_n(fp, fn->code->frame_size, value{});
+    m_frames.clear();
+
+    const value* const stack_end{ m_stack.data() + m_stack.size() };
+    value* const       globals{ m_globals.data() };
+    const instruction* pc{ fn->code->code.data() };
+    const value*       numbers{ fn->numbers.data() };
+    instruction        ins{};
+    u64                count{ 0 };
+
+    // Allocation is the only point where a collection can start, everything live is in a register below the current
+    // frame's top, a global or a constant at that point
+    const auto maybe_collect = [&] {
+        if (m_heap.should_collect())
+            collect(fp + fn->code->frame_size);
+    };
+
+    const auto element = [&](value arr, value index) -> value& {
+        std::vector<value>& elements{ arr.as_array()->elements };
+        const f64           i{ index.as_number() };
+        if (!(i >= 0.0 && i < (f64) elements.size()))
+            fail("Array index out of range", fn, pc);
+        return elements[(size_t) i];
+    };
+
+#if PTL_COMPUTED_GOTO
+    // Same order as opcode
+    static const void* const dispatch_table[]{
+        &&op_move,     &&op_load_number, &&op_load_string, &&op_load_function, &&op_load_global, &&op_store_global,
+        &&op_add,      &&op_sub,         &&op_mul,         &&op_div,           &&op_idiv,        &&op_mod,
+        &&op_band,     &&op_bor,         &&op_bxor,        &&op_bsl,           &&op_bsr,
+        &&op_eq,       &&op_ne,          &&op_lt,          &&op_gt,            &&op_le,          &&op_ge,
+        &&op_neg,      &&op_bnot,        &&op_lnot,        &&op_truth,         &&op_inc,         &&op_dec,
+        &&op_concat,   &&op_to_string,
+        &&op_eq_str,   &&op_ne_str,      &&op_lt_str,      &&op_gt_str,        &&op_le_str,      &&op_ge_str,
+        &&op_new_array, &&op_array_get,  &&op_array_set,   &&op_array_size,
+        &&op_jump,     &&op_jump_if,     &&op_jump_if_not, &&op_call,          &&op_ret,         &&op_ret_void,
+        &&op_compile_lazy,
+    };
+    static_assert(std::size(dispatch_table) == opcode_count);
+
+    // Every handler jumps straight to the next one, which gives the branch predictor one indirect jump per opcode
+    #define VM_CASE(name) op_##name:
+    #define VM_NEXT()                                                                                                  \
+        do                                                                                                             \
+        {                                                                                                              \
+            ins = *pc++;                                                                                               \
+            if constexpr (Count)                                                                                       \
+                ++count;                                                                                               \
+            goto* dispatch_table[(u8) ins.op];                                                                         \
+        } while (false)
+#else
+    #define VM_CASE(name) case opcode::name:
+    #define VM_NEXT()     continue
+#endif
+
+#define VM_NUMBER(name, expr)                                                                                          \
+    VM_CASE(name)                                                                                                      \
+    {                                                                                                                  \
+        const f64 x{ fp[ins.b].as_number() };                                                                          \
+        const f64 y{ fp[ins.c].as_number() };                                                                          \
+        fp[ins.a] = value{ expr };                                                                                     \
+        VM_NEXT();                                                                                                     \
+    }
+
+#define VM_STRING(name, expr)                                                                                          \
+    VM_CASE(name)                                                                                                      \
+    {                                                                                                                  \
+        const std::string& x{ fp[ins.b].as_string()->text };                                                           \
+        const std::string& y{ fp[ins.c].as_string()->text };                                                           \
+        fp[ins.a] = value{ from_bool(expr) };                                                                          \
+        VM_NEXT();                                                                                                     \
+    }
+
+    for (;;)
+    {
+#if PTL_COMPUTED_GOTO
+        VM_NEXT();
+#else
+        ins = *pc++;
+        if constexpr (Count)
+            ++count;
+        switch (ins.op)
+#endif
+        {
+            VM_CASE(move)
+            {
+                fp[ins.a] = fp[ins.b];
+                VM_NEXT();
+            }
+            VM_CASE(load_number)
+            {
+                fp[ins.a] = numbers[(u16) ins.b];
+                VM_NEXT();
+            }
+            VM_CASE(load_string)
+            {
+                fp[ins.a] = fn->strings[(u16) ins.b];
+                VM_NEXT();
+            }
+            VM_CASE(load_function)
+            {
+                fp[ins.a] = value{ &m_functions[(u16) ins.b] };
+                VM_NEXT();
+            }
+            VM_CASE(load_global)
+            {
+                fp[ins.a] = globals[(u16) ins.b];
+                VM_NEXT();
+            }
+            VM_CASE(store_global)
+            {
+                globals[(u16) ins.b] = fp[ins.a];
+                VM_NEXT();
+            }
+
+            VM_NUMBER(add, x + y)
+            VM_NUMBER(sub, x - y)
+            VM_NUMBER(mul, x * y)
+            VM_NUMBER(div, x / y)
+            VM_NUMBER(idiv, ops::idiv(x, y))
+            VM_NUMBER(mod, ops::mod(x, y))
+            VM_NUMBER(band, ops::band(x, y))
+            VM_NUMBER(bor, ops::bor(x, y))
+            VM_NUMBER(bxor, ops::bxor(x, y))
+            VM_NUMBER(bsl, ops::bsl(x, y))
+            VM_NUMBER(bsr, ops::bsr(x, y))
+            VM_NUMBER(eq, from_bool(x == y))
+            VM_NUMBER(ne, from_bool(x != y))
+            VM_NUMBER(lt, from_bool(x < y))
+            VM_NUMBER(gt, from_bool(x > y))
+            VM_NUMBER(le, from_bool(x <= y))
+            VM_NUMBER(ge, from_bool(x >= y))
+
+            VM_CASE(neg)
+            {
+                fp[ins.a] = value{ -fp[ins.b].as_number() };
+                VM_NEXT();
+            }
+            VM_CASE(bnot)
+            {
+                fp[ins.a] = value{ ops::bnot(fp[ins.b].as_number()) };
+                VM_NEXT();
+            }
+            VM_CASE(lnot)
+            {
+                fp[ins.a] = value{ from_bool(!ops::truth(fp[ins.b].as_number())) };
+                VM_NEXT();
+            }
+            VM_CASE(truth)
+            {
+                fp[ins.a] = value{ from_bool(ops::truth(fp[ins.b].as_number())) };
+                VM_NEXT();
+            }
+            VM_CASE(inc)
+            {
+                fp[ins.a] = value{ fp[ins.a].as_number() + 1.0 };
+                VM_NEXT();
+            }
+            VM_CASE(dec)
+            {
+                fp[ins.a] = value{ fp[ins.a].as_number() - 1.0 };
+                VM_NEXT();
+            }
+
+            VM_CASE(concat)
+            {
+                maybe_collect();
+                const std::string& x{ fp[ins.b].as_string()->text };
+                const std::string& y{ fp[ins.c].as_string()->text };
+
+                std::string text{};
+                text.reserve(x.size() + y.size());
+                text.append(x).append(y);
+                fp[ins.a] = value{ m_heap.new_string(std::move(text)) };
+                VM_NEXT();
+            }
+            VM_CASE(to_string)
+            {
+                maybe_collect();
+                fp[ins.a] = value{ m_heap.new_string(ops::to_string(fp[ins.b].as_number())) };
+                VM_NEXT();
+            }
+
+            VM_STRING(eq_str, x == y)
+            VM_STRING(ne_str, x != y)
+            VM_STRING(lt_str, x < y)
+            VM_STRING(gt_str, x > y)
+            VM_STRING(le_str, x <= y)
+            VM_STRING(ge_str, x >= y)
+
+            VM_CASE(new_array)
+            {
+                const f64 size{ fp[ins.b].as_number() };
+                if (!(size >= 0.0 && size <= (f64) max_array_size) || size != std::trunc(size))
+                    fail("Invalid array size", fn, pc);
+
+                maybe_collect();
+                const value fill{ (array_fill) ins.c == array_fill::string ? m_empty_string : value{} };
+                fp[ins.a] = value{ m_heap.new_array((size_t) size, fill) };
+                VM_NEXT();
+            }
+            VM_CASE(array_get)
+            {
+                fp[ins.a] = element(fp[ins.b], fp[ins.c]);
+                VM_NEXT();
+            }
+            VM_CASE(array_set)
+            {
+                element(fp[ins.a], fp[ins.b]) = fp[ins.c];
+                VM_NEXT();
+            }
+            VM_CASE(array_size)
+            {
+                fp[ins.a] = value{ (f64) fp[ins.b].as_array()->elements.size() };
+                VM_NEXT();
+            }
+
+            VM_CASE(jump)
+            {
+                pc += ins.offset();
+                VM_NEXT();
+            }
+            VM_CASE(jump_if)
+            {
+                if (ops::truth(fp[ins.a].as_number()))
+                    pc += ins.offset();
+                VM_NEXT();
+            }
+            VM_CASE(jump_if_not)
+            {
+                if (!ops::truth(fp[ins.a].as_number()))
+                    pc += ins.offset();
+                VM_NEXT();
+            }
+
+            VM_CASE(call)
+            {
+                const value callee{ fp[ins.a] };
+                if (!callee.is_function())
+                    fail("Called an uninitialized function", fn, pc);
+
+                const function_object* next{ callee.as_function() };
+                value*                 next_fp{ fp + ins.b + ins.c };
+                if (m_frames.size() == max_call_depth || next_fp + next->code->frame_size > stack_end)
+                    fail("Stack overflow", fn, pc);
+
+                // A body compiled while another machine ran it has its code swapped under this one's constants
+                if (next->loaded != next->code->code.data()) [[unlikely]]
+                    load_constants(m_functions[next - m_functions.data()]);
+
+                m_frames.push_back({ fn, pc, fp });
+                std::fill_n(next_fp, next->code->frame_size, value{});
+
+                fn      = next;
+                fp      = next_fp;
+                pc      = fn->code->code.data();
+                numbers = fn->numbers.data();
+                VM_NEXT();
+            }
+            VM_CASE(ret)
+            {
+                fp[0] = fp[ins.a];
+                if (m_frames.empty())
+                {
+                    executed = count;
+                    return fp[0];
+                }
+
+                const frame& caller{ m_frames.back() };
+                fn      = caller.function;
+                pc      = caller.pc;
+                fp      = caller.fp;
+                numbers = fn->numbers.data();
+                m_frames.pop_back();
+                VM_NEXT();
+            }
+            VM_CASE(ret_void)
+            {
+                if (m_frames.empty())
+                {
+                    executed = count;
+                    return value{};
+                }
+
+                const frame& caller{ m_frames.back() };
+                fn      = caller.function;
+                pc      = caller.pc;
+                fp      = caller.fp;
+                numbers = fn->numbers.data();
+                m_frames.pop_back();
+                VM_NEXT();
+            }
+
+            VM_CASE(compile_lazy)
+            {
+                // The frame is already set up for the stub, which has no registers of its own
+                function_object& compiled{ m_functions[(u16) ins.a] };
+                if (!m_lazy_compiler || !m_lazy_compiler((u16) ins.a))
+                    fail("Function failed to compile", fn, pc);
+
+                // The stub's code is gone, errors from here on point at the first line of the compiled body
+                load_constants(compiled);
+                pc      = compiled.code->code.data();
+                numbers = compiled.numbers.data();
+                if (fp + compiled.code->frame_size > stack_end)
+                    fail("Stack overflow", fn, pc + 1);
+                std::fill_n(fp, compiled.code->frame_size, value{});
+                VM_NEXT();
+            }
+        }
+    }
+
+#undef VM_STRING
+#undef VM_NUMBER
+#undef VM_NEXT
+#undef VM_CASE
+}
+
+} // namespace ptl
@@ -0,0 +1,110 @@
+﻿//  ------------------------------------------------------------------------------
+//
+//  Petal
+//     Copyright 2023 Matthew Rogers
+//
+//     Licensed under the Apache License, Version 2.0 (the "License");
+//     you may not use this file except in compliance with the License.
+//     You may obtain a copy of the License at
+//
+//         http://www.apache.org/licenses/LICENSE-2.0
+//
+//     Unless required by applicable law or agreed to in writing, software
+//     distributed under the License is distributed on an "AS IS" BASIS,
+//     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//     See the License for the specific language governing permissions and
+//     limitations under the License.
+//
+//  File Name: VirtualMachine.h
+//  Date File Created: 10/17/2026
+//  Author: Matt
+//
+//  ------------------------------------------------------------------------------
+
+#pragma once
+
+#include "Common.h"
+#include "Bytecode.h"
+#include "Heap.h"
+#include "Value.h"
+
+#include <functional>
+#include <span>
+#include <vector>
+
+// Threaded dispatch through a table of label addresses where the compiler supports it (GCC and Clang), a switch
+// everywhere else
+#if !defined(PTL_COMPUTED_GOTO)
+    #if defined(__GNUC__) || defined(__clang__)
+        #define PTL_COMPUTED_GOTO 1
+    #else
+        #define PTL_COMPUTED_GOTO 0
+    #endif
+#endif
+
+namespace ptl
+{
+
+// Runs one program. All frames share a single register stack: a call moves the frame pointer up to the callee's
+// window, so arguments are passed in place and nothing is copied or allocated per call. Globals, strings and arrays
+// live as long as the machine, one machine per running script instance
+class virtual_machine
+{
+public:
+    static constexpr u32 default_stack_size{ 64 * 1024 };
+    static constexpr u32 max_call_depth{ 4 * 1024 };
+    static constexpr u32 max_array_size{ 1u << 28 };
+
+    // Compiles function index of the program in place, false when it has errors
+    using lazy_compiler = std::function<bool(u32 function)>;
+
+    explicit virtual_machine(const program& prog, u32 stack_size = default_stack_size);
+
+    // Calls function index of the program and returns its result, a number 0 for functions that return nothing.
+    // Strings and arrays in the result stay valid until the next call. Number arguments that may be NaN have to go
+    // through value::canonical. Runtime errors throw error::error
+    value run(u32 function, std::span<const value> args = {});
+
+    // Same as run, but also counts the executed instructions into executed
+    value run_counted(u32 function, std::span<const value> args, u64& executed);
+
+    [[nodiscard]] std::span<value>       globals() { return m_globals; }
+    [[nodiscard]] std::span<const value> globals() const { return m_globals; }
+
+    heap& get_heap() { return m_heap; }
+
+    // Called the first time a function whose code is a compile_lazy stub runs. The function's code is replaced by
+    // then, the machine picks up its new constants and starts it over. Without one, or when it fails, the call is a
+    // runtime error. Code replaced some other way, like through another machine's lazy compiler, has its constants
+    // picked up on its next call
+    void set_lazy_compiler(lazy_compiler compiler) { m_lazy_compiler = std::move(compiler); }
+
+    string_object* new_string(std::string text) { return m_heap.new_string(std::move(text)); }
+
+    // Marks the stack below top, the globals and the constants, then sweeps
+    void collect(const value* top);
+
+private:
+    struct frame
+    {
+        const function_object* function{};
+        const instruction*     pc{};
+        value*                 fp{};
+    };
+
+    template<bool Count>
+    value execute(u32 function, std::span<const value> args, u64& executed);
+
+    void load_constants(function_object& fn);
+
+    const program&               m_program;
+    heap                         m_heap{};
+    std::vector<function_object> m_functions{};
+    std::vector<value>           m_globals{};
+    std::vector<value>           m_stack{};
+    std::vector<frame>           m_frames{};
+    value                        m_empty_string{};
+    lazy_compiler                m_lazy_compiler{};
+};
+
+} // namespace ptl
@@ -0,0 +1,111 @@
+﻿//  ------------------------------------------------------------------------------
+//
+//  Petal
+//     Copyright 2023 Matthew Rogers
+//
+//     Licensed under the Apache License, Version 2.0 (the "License");
+//     you may not use this file except in compliance with the License.
+//     You may obtain a copy of the License at
+//
+//         http://www.apache.org/licenses/LICENSE-2.0
+//
+//     Unless required by applicable law or agreed to in writing, software
+//     distributed under the License is distributed on an "AS IS" BASIS,
+//     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//     See the License for the specific language governing permissions and
+//     limitations under the License.
+//
+//  File Name: Bench.cpp
+//  Date File Created: 10/17/2026
+//  Author: Matt
+//
+//  ------------------------------------------------------------------------------
+
+#include "Bench.h"
+#include "Util/Scan.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+namespace
+{
+std::atomic<u64> allocations{ 0 };
+} // anonymous namespace
+
+// Every allocation in the process goes through here so a benchmark can report how many it made. Array and nothrow
+// new forward to this one in both the MSVC and the GNU standard library
+void* operator new(std::size_t size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* ptr{ std::malloc(size ? size : 1) })
+        return ptr;
+
+    throw std::bad_alloc{};
+}
+
+void operator delete(void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+namespace ptl::bench
+{
+namespace
+{
+
+constexpr f64 megabyte{ 1024.0 * 1024.0 };
+
+f64 per_second(u64 count, f64 seconds)
+{
+    return seconds > 0.0 ? (f64) count / seconds : 0.0;
+}
+
+} // anonymous namespace
+
+u64 allocation_count()
+{
+    return allocations.load(std::memory_order_relaxed);
+}
+
+void print_table(const std::vector<result>& results, std::ostream& os)
+{
+    char line[256];
+    std::snprintf(line, sizeof(line), "%-16s %-12s %12s %12s %16s %12s\n", "benchmark", "corpus", "bytes", "MB/s", "items/s",
+                  "allocs/item");
+    os << line;
+
+    for (const result& r : results)
+    {
+        std::snprintf(line, sizeof(line), "%-16s %-12s %12llu %12.1f %16.0f %12.4f\n", r.benchmark.c_str(), r.corpus.c_str(),
+                      (unsigned long long) r.bytes, per_second(r.bytes, r.seconds) / megabyte, per_second(r.items, r.seconds),
+                      r.items ? (f64) r.allocations / (f64) r.items : 0.0);
+        os << line;
+    }
+}
+
+void write_json(const std::vector<result>& results, std::ostream& os)
+{
+    // Benchmark and corpus names are plain identifiers, so no string escaping is needed
+    os << "{\n  \"scan_implementation\": \"" << utl::scan_implementation() << "\",\n  \"results\": [";
+
+    for (size_t i{ 0 }; i < results.size(); ++i)
+    {
+        const result& r{ results[i] };
+        os << (i ? ",\n" : "\n") << "    { \"benchmark\": \"" << r.benchmark << "\", \"corpus\": \"" << r.corpus
+           << "\", \"unit\": \"" << r.unit << "\", \"bytes\": " << r.bytes << ", \"items\": " << r.items
+           << ", \"seconds\": " << r.seconds << ", \"mb_per_s\": " << per_second(r.bytes, r.seconds) / megabyte
+           << ", \"items_per_s\": " << per_second(r.items, r.seconds) << ", \"allocations\": " << r.allocations
+           << ", \"allocations_per_item\": " << (r.items ? (f64) r.allocations / (f64) r.items : 0.0) << " }";
+    }
+
+    os << "\n  ]\n}\n";
+}
+
+} // namespace ptl::bench
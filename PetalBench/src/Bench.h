@@ -0,0 +1,112 @@
+﻿//  ------------------------------------------------------------------------------
+//
+//  Petal
+//     Copyright 2023 Matthew Rogers
+//
+//     Licensed under the Apache License, Version 2.0 (the "License");
+//     you may not use this file except in compliance with the License.
+//     You may obtain a copy of the License at
+//
+//         http://www.apache.org/licenses/LICENSE-2.0
+//
+//     Unless required by applicable law or agreed to in writing, software
+//     distributed under the License is distributed on an "AS IS" BASIS,
+//     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//     See the License for the specific language governing permissions and
+//     limitations under the License.
+//
+//  File Name: Bench.h
+//  Date File Created: 10/17/2026
+//  Author: Matt
+//
+//  ------------------------------------------------------------------------------
+
+#pragma once
+
+#include "Common.h"
+
+#include <algorithm>
+#include <chrono>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace ptl::bench
+{
+
+struct options
+{
+    size_t min_size{ 1024 };
+    size_t max_size{ 100 * 1024 * 1024 };
+    f64    min_seconds{ 0.25 };
+};
+
+// One measurement. items is whatever the benchmark counts (tokens, lookups, nodes...), named by unit. bytes is the
+// input size, 0 when throughput in MB/s makes no sense. allocations are the operator new calls of a single run
+struct result
+{
+    std::string benchmark{};
+    std::string corpus{};
+    std::string unit{};
+    u64         bytes{};
+    u64         items{};
+    f64         seconds{};
+    u64         allocations{};
+};
+
+// Number of global operator new calls so far, counted by the replacement operator new in Bench.cpp
+u64 allocation_count();
+
+class timer
+{
+public:
+    timer() : m_start{ std::chrono::steady_clock::now() } {}
+
+    [[nodiscard]] f64 seconds() const
+    {
+        return std::chrono::duration<f64>(std::chrono::steady_clock::now() - m_start).count();
+    }
+
+private:
+    std::chrono::steady_clock::time_point m_start;
+};
+
+// Calls run() until at least opts.min_seconds went by (and at least once) and returns the fastest run in seconds.
+// allocations receives the operator new calls of the first run
+template<typename Run>
+f64 measure(const options& opts, u64& allocations, Run&& run)
+{
+    const u64 before{ allocation_count() };
+    f64       best{ 0.0 };
+    f64       total{ 0.0 };
+
+    for (u32 i{ 0 }; i == 0 || total < opts.min_seconds; ++i)
+    {
+        const timer t{};
+        run();
+        const f64 elapsed{ t.seconds() };
+
+        if (i == 0)
+        {
+            allocations = allocation_count() - before;
+            best        = elapsed;
+        }
+        best = std::min(best, elapsed);
+        total += elapsed;
+    }
+
+    return best;
+}
+
+// Human readable table, one line per result
+void print_table(const std::vector<result>& results, std::ostream& os);
+
+// All results as one JSON document, including the derived MB/s, items/s and allocations per item
+void write_json(const std::vector<result>& results, std::ostream& os);
+
+// Benchmark groups, each appends its results
+void run_lexer(const options& opts, std::vector<result>& results);
+void run_parser(const options& opts, std::vector<result>& results);
+void run_vm(const options& opts, std::vector<result>& results);
+
+} // namespace ptl::bench
@@ -0,0 +1,289 @@
+﻿//  ------------------------------------------------------------------------------
+//
+//  Petal
+//     Copyright 2023 Matthew Rogers
+//
+//     Licensed under the Apache License, Version 2.0 (the "License");
+//     you may not use this file except in compliance with the License.
+//     You may obtain a copy of the License at
+//
+//         http://www.apache.org/licenses/LICENSE-2.0
+//
+//     Unless required by applicable law or agreed to in writing, software
+//     distributed under the License is distributed on an "AS IS" BASIS,
+//     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//     See the License for the specific language governing permissions and
+//     limitations under the License.
+//
+//  File Name: Corpus.cpp
+//  Date File Created: 10/17/2026
+//  Author: Matt
+//
+//  ------------------------------------------------------------------------------
+
+#include "Corpus.h"
+
+namespace ptl::bench
+{
+namespace
+{
+
+constexpr std::string_view keywords[]{ "if",  "else", "elif", "while",  "for",    "return", "var",
+                                       "fun", "void", "break", "number", "string", "do",     "continue" };
+
+constexpr std::string_view operators[]{ "+",  "-",  "*",  "/",  "%",  "&",  "|",  "^",  "<<", ">>", "&&", "||",
+                                        "==", "!=", "<",  ">",  "<=", ">=", "..", "+=", "-=", "*=", "<<=", ">>=" };
+
+constexpr std::string_view unary_operators[]{ "-", "!", "~", "++", "--" };
+
+// xorshift32, spelled out so the corpora are identical with every standard library
+class random
+{
+public:
+    explicit random(u32 seed) : m_state{ seed ? seed : 1 } {}
+
+    u32 operator()()
+    {
+        m_state ^= m_state << 13;
+        m_state ^= m_state >> 17;
+        m_state ^= m_state << 5;
+        return m_state;
+    }
+
+    u32 below(u32 bound) { return (*this)() % bound; }
+
+    template<typename T, size_t N>
+    const T& pick(const T (&values)[N])
+    {
+        return values[below((u32) N)];
+    }
+
+private:
+    u32 m_state;
+};
+
+void append_identifier(std::string& out, random& rng)
+{
+    constexpr std::string_view first{ "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ_" };
+    constexpr std::string_view rest{ "abcdefghijklmnopqrstuvwxyz0123456789_" };
+
+    out.push_back(first[rng.below((u32) first.size())]);
+    for (u32 i{ rng.below(12) }; i > 0; --i)
+    {
+        out.push_back(rest[rng.below((u32) rest.size())]);
+    }
+}
+
+void append_number(std::string& out, random& rng)
+{
+    switch (rng.below(6))
+    {
+    case 0: out += std::to_string(rng.below(10)); break;
+    case 1: out += std::to_string(rng()); break;
+    case 2: out += std::to_string(rng.below(100000)) + "." + std::to_string(rng.below(1000)); break;
+    case 3: out += std::to_string(rng.below(10)) + "." + std::to_string(rng.below(100)) + "e-" + std::to_string(rng.below(30)); break;
+    case 4:
+    {
+        constexpr std::string_view hex{ "0123456789ABCDEF" };
+        out += "0x";
+        for (u32 i{ 0 }; i < 8; ++i)
+        {
+            if (i == 4)
+                out.push_back('_');
+            out.push_back(hex[rng.below(16)]);
+        }
+        break;
+    }
+    default: out += std::to_string(rng.below(1000)) + "_" + std::to_string(100 + rng.below(900)); break;
+    }
+}
+
+void append_string(std::string& out, random& rng)
+{
+    constexpr std::string_view words[]{ "lorem", "ipsum", "dolor", "sit", "amet", "petal", "lotus", "engine", "script" };
+    constexpr std::string_view escapes[]{ "\\n", "\\t", "\\\"", "\\\\" };
+
+    out.push_back('"');
+    for (u32 i{ 8 + rng.below(40) }; i > 0; --i)
+    {
+        out += rng.pick(words);
+        out.push_back(' ');
+        if (rng.below(16) == 0)
+            out += rng.pick(escapes);
+    }
+    out.push_back('"');
+}
+
+// var name = a + b * (c - d);
+void append_expression_line(std::string& out, random& rng)
+{
+    append_identifier(out, rng);
+    out += " = ";
+    for (u32 i{ 4 + rng.below(12) }; i > 0; --i)
+    {
+        if (rng.below(4) == 0)
+            out += rng.pick(unary_operators);
+        if (rng.below(6) == 0)
+        {
+            out.push_back('(');
+            append_identifier(out, rng);
+            out += rng.pick(operators);
+            append_number(out, rng);
+            out.push_back(')');
+        } else
+        {
+            append_identifier(out, rng);
+        }
+        out += i > 1 ? rng.pick(operators) : std::string_view{ ";\n" };
+    }
+}
+
+constexpr std::string_view arithmetic_operators[]{ "+", "-", "*", "/", "%", "&", "|", "^", "<<", ">>", "&&", "||",
+                                                   "==", "!=", "<", ">", "<=", ">=" };
+
+void append_variable(std::string& out, random& rng)
+{
+    out.push_back('v');
+    out += std::to_string(rng.below(expression_variables));
+}
+
+// Random arithmetic over the declared variables, depth keeps the nesting bounded
+void append_expression(std::string& out, random& rng, u32 depth)
+{
+    const u32 operands{ 2 + rng.below(4) };
+    for (u32 i{ 0 }; i < operands; ++i)
+    {
+        if (i > 0)
+        {
+            out.push_back(' ');
+            out += rng.pick(arithmetic_operators);
+            out.push_back(' ');
+        }
+
+        switch (depth > 0 ? rng.below(8) : rng.below(3))
+        {
+        case 0: append_variable(out, rng); break;
+        case 1: out += std::to_string(rng.below(1000)); break;
+        case 2:
+            out.push_back('-');
+            append_variable(out, rng);
+            break;
+        case 3:
+            append_variable(out, rng);
+            out += "++";
+            break;
+        case 4:
+        case 5:
+            out.push_back('(');
+            append_expression(out, rng, depth - 1);
+            out.push_back(')');
+            break;
+        default:
+            out.push_back('(');
+            append_variable(out, rng);
+            out += " < ";
+            append_variable(out, rng);
+            out += " ? ";
+            append_expression(out, rng, depth - 1);
+            out += " : ";
+            append_variable(out, rng);
+            out.push_back(')');
+            break;
+        }
+    }
+}
+
+void append_line(std::string& out, corpus_kind kind, random& rng)
+{
+    switch (kind)
+    {
+    case corpus_kind::identifiers:
+        for (u32 i{ 4 + rng.below(8) }; i > 0; --i)
+        {
+            if (rng.below(4) == 0)
+                out += rng.pick(keywords);
+            else
+                append_identifier(out, rng);
+            out.push_back(rng.below(8) == 0 ? ';' : ' ');
+        }
+        out.push_back('\n');
+        break;
+    case corpus_kind::operators: append_expression_line(out, rng); break;
+    case corpus_kind::numbers:
+        out += "    ";
+        for (u32 i{ 0 }; i < 8; ++i)
+        {
+            append_number(out, rng);
+            out += ", ";
+        }
+        out.push_back('\n');
+        break;
+    case corpus_kind::strings:
+        out += "var ";
+        append_identifier(out, rng);
+        out += " = ";
+        append_string(out, rng);
+        out += ";\n";
+        break;
+    case corpus_kind::comments:
+        if (rng.below(3) == 0)
+        {
+            out += "/* ";
+            for (u32 i{ 2 + rng.below(6) }; i > 0; --i)
+            {
+                out += "   * block comment line describing the next function in some detail\n";
+            }
+            out += " */\n";
+        } else
+        {
+            out += "// line comment explaining the statement below, which is kept deliberately long\n";
+        }
+        append_expression_line(out, rng);
+        break;
+    case corpus_kind::expressions:
+        append_variable(out, rng);
+        out += " = ";
+        append_expression(out, rng, 3);
+        out += ";\n";
+        break;
+    }
+}
+
+} // anonymous namespace
+
+std::string_view corpus_name(corpus_kind kind)
+{
+    switch (kind)
+    {
+    case corpus_kind::identifiers: return "identifiers";
+    case corpus_kind::operators: return "operators";
+    case corpus_kind::numbers: return "numbers";
+    case corpus_kind::strings: return "strings";
+    case corpus_kind::comments: return "comments";
+    case corpus_kind::expressions: return "expressions";
+    }
+
+    return "unknown";
+}
+
+std::string generate_corpus(corpus_kind kind, size_t size, u32 seed)
+{
+    random      rng{ seed * 2654435761u + (u32) kind };
+    std::string out{};
+    out.reserve(size + 4096);
+
+    size_t line_end{ 0 };
+    while (out.size() < size)
+    {
+        line_end = out.size();
+        append_line(out, kind, rng);
+    }
+
+    // Drop the last line if it went past size, unless it is the only one
+    if (out.size() > size && line_end > 0)
+        out.resize(line_end);
+
+    return out;
+}
+
+} // namespace ptl::bench
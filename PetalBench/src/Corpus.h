@@ -0,0 +1,57 @@
+﻿//  ------------------------------------------------------------------------------
+//
+//  Petal
+//     Copyright 2023 Matthew Rogers
+//
+//     Licensed under the Apache License, Version 2.0 (the "License");
+//     you may not use this file except in compliance with the License.
+//     You may obtain a copy of the License at
+//
+//         http://www.apache.org/licenses/LICENSE-2.0
+//
+//     Unless required by applicable law or agreed to in writing, software
+//     distributed under the License is distributed on an "AS IS" BASIS,
+//     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//     See the License for the specific language governing permissions and
+//     limitations under the License.
+//
+//  File Name: Corpus.h
+//  Date File Created: 10/17/2026
+//  Author: Matt
+//
+//  ------------------------------------------------------------------------------
+
+#pragma once
+
+#include "Common.h"
+
+#include <span>
+#include <string>
+#include <string_view>
+
+namespace ptl::bench
+{
+
+enum struct corpus_kind : u8
+{
+    identifiers,
+    operators,
+    numbers,
+    strings,
+    comments,
+    // Expression statements over the number variables v0 .. v(expression_variables - 1), for the parser
+    expressions,
+};
+
+inline constexpr u32 expression_variables{ 32 };
+
+inline constexpr corpus_kind all_corpora[]{ corpus_kind::identifiers, corpus_kind::operators, corpus_kind::numbers,
+                                            corpus_kind::strings, corpus_kind::comments, corpus_kind::expressions };
+
+std::string_view corpus_name(corpus_kind kind);
+
+// Deterministic synthetic Petal source of kind, size bytes long (cut at a line end so every token is complete).
+// The same kind, size and seed always give the same text
+std::string generate_corpus(corpus_kind kind, size_t size, u32 seed = 1);
+
+} // namespace ptl::bench
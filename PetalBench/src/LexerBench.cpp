@@ -0,0 +1,293 @@
+﻿//  ------------------------------------------------------------------------------
+//
+//  Petal
+//     Copyright 2023 Matthew Rogers
+//
+//     Licensed under the Apache License, Version 2.0 (the "License");
+//     you may not use this file except in compliance with the License.
+//     You may obtain a copy of the License at
+//
+//         http://www.apache.org/licenses/LICENSE-2.0
+//
+//     Unless required by applicable law or agreed to in writing, software
+//     distributed under the License is distributed on an "AS IS" BASIS,
+//     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//     See the License for the specific language governing permissions and
+//     limitations under the License.
+//
+//  File Name: LexerBench.cpp
+//  Date File Created: 10/17/2026
+//  Author: Matt
+//
+//  ------------------------------------------------------------------------------
+
+#include "Bench.h"
+#include "Corpus.h"
+#include "ModuleCache.h"
+#include "TokenBuffer.h"
+#include "Util/Lookup.h"
+
+#include <filesystem>
+#include <random>
+#include <stack>
+#include <stdexcept>
+#include <vector>
+
+namespace ptl::bench
+{
+namespace
+{
+
+void bench_tokenize(const options& opts, corpus_kind kind, size_t size, std::vector<result>& results)
+{
+    const std::string text{ generate_corpus(kind, size) };
+
+    // Fresh tables every run, so the allocation count includes growing them like a real compile does
+    u32       tokens{ 0 };
+    u64       allocations{ 0 };
+    const f64 seconds{ measure(opts, allocations, [&] {
+        symbol_table       symbols{};
+        token_buffer       buffer{};
+        error::diagnostics diag{};
+        tokenize(text, symbols, buffer, diag);
+        tokens = buffer.size();
+    }) };
+
+    results.push_back({ "tokenize", std::string{ corpus_name(kind) }, "tokens", text.size(), tokens, seconds, allocations });
+}
+
+// get_keyword's perfect hash against the sorted utl::lookup it replaced, over every word of the identifier corpus
+void bench_keywords(const options& opts, std::vector<result>& results)
+{
+    const std::string text{ generate_corpus(corpus_kind::identifiers, 1024 * 1024) };
+
+    std::vector<std::string_view> words{};
+    for (size_t pos{ 0 }; pos < text.size();)
+    {
+        const size_t begin{ text.find_first_not_of(" ;\n", pos) };
+        if (begin == std::string::npos)
+            break;
+        pos = std::min(text.find_first_of(" ;\n", begin), text.size());
+        words.push_back(std::string_view{ text }.substr(begin, pos - begin));
+    }
+
+    std::vector<std::pair<std::string_view, reserved_token>> container{};
+    for (const std::string_view word : words)
+    {
+        if (const std::optional<reserved_token> kw{ get_keyword(word) })
+            container.emplace_back(word, *kw);
+    }
+    std::sort(container.begin(), container.end());
+    container.erase(std::unique(container.begin(), container.end()), container.end());
+    const utl::lookup<std::string_view, reserved_token> keyword_lookup{ std::move(container) };
+
+    u64 found{ 0 };
+    u64 allocations{ 0 };
+
+    f64 seconds{ measure(opts, allocations, [&] {
+        for (const std::string_view word : words)
+        {
+            found += get_keyword(word).has_value();
+        }
+    }) };
+    results.push_back({ "keyword_hash", "identifiers", "lookups", 0, words.size(), seconds, allocations });
+
+    seconds = measure(opts, allocations, [&] {
+        for (const std::string_view word : words)
+        {
+            found += keyword_lookup.find(word) != keyword_lookup.end();
+        }
+    });
+    results.push_back({ "keyword_lookup", "identifiers", "lookups", 0, words.size(), seconds, allocations });
+
+    // Keeps the loops from being optimized away
+    if (found == 0)
+        results.back().items = 0;
+}
+
+// The equal_range walk over the sorted operators that get_operator's transition table replaced, kept as the reference
+// its maximal munch is checked against
+class reference_operators
+{
+public:
+    reference_operators() : m_operators{ operator_spellings().begin(), operator_spellings().end() }
+    {
+        std::sort(m_operators.begin(), m_operators.end());
+    }
+
+    std::optional<reserved_token> match(push_back_stream& stream) const
+    {
+        auto                          candidates{ std::make_pair(m_operators.begin(), m_operators.end()) };
+        std::optional<reserved_token> ret;
+        u32                           match_size{ 0 };
+        std::stack<i32>               chars;
+
+        for (u32 i{ 0 }; candidates.first != candidates.second; ++i)
+        {
+            chars.push(stream());
+            candidates = std::equal_range(candidates.first, candidates.second, (char) chars.top(), comparator{ i });
+
+            if (candidates.first != candidates.second && candidates.first->first.size() == i + 1)
+            {
+                match_size = i + 1;
+                ret        = candidates.first->second;
+            }
+        }
+
+        while (chars.size() > match_size)
+        {
+            stream.push_back(chars.top());
+            chars.pop();
+        }
+
+        return ret;
+    }
+
+private:
+    using entry = std::pair<std::string_view, reserved_token>;
+
+    // Orders operators by their character at index
+    class comparator
+    {
+    public:
+        constexpr comparator(u32 index) : m_index{ index } {}
+
+        bool operator()(const entry& l, char r) const { return l.first.size() <= m_index || l.first[m_index] < r; }
+        bool operator()(char l, const entry& r) const { return r.first.size() > m_index && l < r.first[m_index]; }
+
+    private:
+        u32 m_index;
+    };
+
+    std::vector<entry> m_operators;
+};
+
+// Random runs of operator characters, so most operators touch the next one and every prefix of a longer operator
+// shows up
+std::string generate_operator_soup(size_t size)
+{
+    std::string alphabet{};
+    for (const auto& [spelling, tk] : operator_spellings())
+    {
+        for (const char c : spelling)
+        {
+            if (alphabet.find(c) == std::string::npos)
+                alphabet += c;
+        }
+    }
+
+    std::mt19937                          rng{ 1 };
+    std::uniform_int_distribution<size_t> pick{ 0, alphabet.size() - 1 };
+    std::string                           ret(size, ' ');
+    for (char& c : ret)
+    {
+        c = alphabet[pick(rng)];
+    }
+    return ret;
+}
+
+// Splits text into operators with match, stepping over a character nothing matches. Calls found(tk, end) for each
+template<typename Match, typename Found>
+void split_operators(std::string_view text, Match&& match, Found&& found)
+{
+    push_back_stream stream{ text };
+    while (stream.char_index() < text.size())
+    {
+        const std::optional<reserved_token> tk{ match(stream) };
+        if (!tk)
+            (void) stream();
+        found(tk, stream.char_index());
+    }
+}
+
+// get_operator against the reference matcher: both have to split the soup into the same operators, then both are timed
+void bench_operators(const options& opts, std::vector<result>& results)
+{
+    const std::string         text{ generate_operator_soup(256 * 1024) };
+    const reference_operators reference{};
+
+    std::vector<std::pair<std::optional<reserved_token>, u32>> expected{};
+    split_operators(text, [&](push_back_stream& stream) { return reference.match(stream); },
+                    [&](std::optional<reserved_token> tk, u32 end) { expected.emplace_back(tk, end); });
+
+    size_t next{ 0 };
+    split_operators(text, get_operator, [&](std::optional<reserved_token> tk, u32 end) {
+        if (next == expected.size() || expected[next] != std::make_pair(tk, end))
+            throw std::runtime_error{ "get_operator disagrees with the reference matcher before byte " +
+                                      std::to_string(end) };
+        ++next;
+    });
+    if (next != expected.size())
+        throw std::runtime_error{ "get_operator stopped before the reference matcher" };
+
+    u64 found{ 0 };
+    u64 allocations{ 0 };
+
+    f64 seconds{ measure(opts, allocations, [&] {
+        split_operators(text, get_operator, [&](std::optional<reserved_token> tk, u32) { found += tk.has_value(); });
+    }) };
+    results.push_back({ "operator_dfa", "operators", "matches", text.size(), expected.size(), seconds, allocations });
+
+    seconds = measure(opts, allocations, [&] {
+        split_operators(text, [&](push_back_stream& stream) { return reference.match(stream); },
+                        [&](std::optional<reserved_token> tk, u32) { found += tk.has_value(); });
+    });
+    results.push_back({ "operator_lookup", "operators", "matches", text.size(), expected.size(), seconds, allocations });
+
+    if (found == 0)
+        results.back().items = 0;
+}
+
+// A warm start: tokens of the expression corpus from its module image (mapping, checking the header and interning the
+// symbols, the arrays are used where they are), against lexing it in bench_tokenize
+void bench_module_cache(const options& opts, size_t size, std::vector<result>& results)
+{
+    const std::string text{ generate_corpus(corpus_kind::expressions, size) };
+    const u64         key{ module_key(text) };
+
+    const module_cache cache{ std::filesystem::temp_directory_path() / "petal_bench_cache" };
+    {
+        symbol_table       symbols{};
+        token_buffer       buffer{};
+        error::diagnostics diag{};
+        tokenize(text, symbols, buffer, diag);
+        if (!cache.store(key, { symbols, buffer }))
+            return;
+    }
+
+    u32       tokens{ 0 };
+    u64       allocations{ 0 };
+    const f64 seconds{ measure(opts, allocations, [&] {
+        symbol_table                      symbols{};
+        token_buffer                      buffer{};
+        const std::optional<module_image> image{ cache.open(key) };
+        buffer.view(image->tokens(), image->intern_symbols(symbols));
+        tokens = buffer.size();
+    }) };
+
+    std::filesystem::remove(cache.path(key));
+    results.push_back({ "module_image", "expressions", "tokens", text.size(), tokens, seconds, allocations });
+}
+
+} // anonymous namespace
+
+void run_lexer(const options& opts, std::vector<result>& results)
+{
+    for (const corpus_kind kind : all_corpora)
+    {
+        for (size_t size{ opts.min_size }; size <= opts.max_size; size *= 10)
+        {
+            bench_tokenize(opts, kind, size, results);
+        }
+    }
+
+    for (size_t size{ opts.min_size }; size <= opts.max_size; size *= 10)
+    {
+        bench_module_cache(opts, size, results);
+    }
+
+    bench_keywords(opts, results);
+    bench_operators(opts, results);
+}
+
+} // namespace ptl::bench
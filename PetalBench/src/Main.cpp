@@ -0,0 +1,90 @@
+﻿//  ------------------------------------------------------------------------------
+//
+//  Petal
+//     Copyright 2023 Matthew Rogers
+//
+//     Licensed under the Apache License, Version 2.0 (the "License");
+//     you may not use this file except in compliance with the License.
+//     You may obtain a copy of the License at
+//
+//         http://www.apache.org/licenses/LICENSE-2.0
+//
+//     Unless required by applicable law or agreed to in writing, software
+//     distributed under the License is distributed on an "AS IS" BASIS,
+//     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//     See the License for the specific language governing permissions and
+//     limitations under the License.
+//
+//  File Name: Main.cpp
+//  Date File Created: 10/17/2026
+//  Author: Matt
+//
+//  ------------------------------------------------------------------------------
+
+#include "Bench.h"
+
+#include <cstdlib>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <string_view>
+
+namespace
+{
+
+void usage()
+{
+    std::cerr << "PetalBench [--max-size bytes] [--min-time seconds] [--json path]\n"
+                 "  Results are printed as a table on stderr and as JSON on stdout, or in path with --json\n";
+}
+
+} // anonymous namespace
+
+int main(int argc, char* argv[])
+{
+    using namespace ptl;
+
+    bench::options   opts{};
+    std::string_view json_path{};
+
+    for (int i{ 1 }; i < argc; ++i)
+    {
+        const std::string_view arg{ argv[i] };
+        if (i + 1 < argc && arg == "--max-size")
+            opts.max_size = std::strtoull(argv[++i], nullptr, 10);
+        else if (i + 1 < argc && arg == "--min-time")
+            opts.min_seconds = std::strtod(argv[++i], nullptr);
+        else if (i + 1 < argc && arg == "--json")
+            json_path = argv[++i];
+        else
+        {
+            usage();
+            return 1;
+        }
+    }
+
+    // Some benchmarks first check their subject against a reference and throw when they disagree
+    std::vector<bench::result> results{};
+    try
+    {
+        bench::run_lexer(opts, results);
+        bench::run_parser(opts, results);
+        bench::run_vm(opts, results);
+    } catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    bench::print_table(results, std::cerr);
+
+    if (json_path.empty())
+    {
+        bench::write_json(results, std::cout);
+        return 0;
+    }
+
+    std::ofstream file{ std::string{ json_path } };
+    bench::write_json(results, file);
+    return file ? 0 : 1;
+}
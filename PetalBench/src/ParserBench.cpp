@@ -0,0 +1,241 @@
+﻿//  ------------------------------------------------------------------------------
+//
+//  Petal
+//     Copyright 2023 Matthew Rogers
+//
+//     Licensed under the Apache License, Version 2.0 (the "License");
+//     you may not use this file except in compliance with the License.
+//     You may obtain a copy of the License at
+//
+//         http://www.apache.org/licenses/LICENSE-2.0
+//
+//     Unless required by applicable law or agreed to in writing, software
+//     distributed under the License is distributed on an "AS IS" BASIS,
+//     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//     See the License for the specific language governing permissions and
+//     limitations under the License.
+//
+//  File Name: ParserBench.cpp
+//  Date File Created: 10/17/2026
+//  Author: Matt
+//
+//  ------------------------------------------------------------------------------
+
+#include "Bench.h"
+#include "Corpus.h"
+#include "FlatTree.h"
+#include "Parser.h"
+#include "Script.h"
+#include "VirtualMachine.h"
+
+namespace ptl::bench
+{
+namespace
+{
+
+u64 count_nodes(const node& n)
+{
+    u64 ret{ 1 };
+    for (const node_ptr& child : n.children())
+    {
+        ret += count_nodes(*child);
+    }
+    return ret;
+}
+
+// Lexes and parses every statement of text into context, flattening them into flat when it is given
+std::vector<node_ptr> parse_all(compiler_context& context, std::string_view text)
+{
+    for (u32 i{ 0 }; i < expression_variables; ++i)
+    {
+        const symbol_id name{ context.symbols().intern("v" + std::to_string(i)) };
+        (void) context.create_identifier(name, type_registry::number_handle(), false);
+    }
+
+    push_back_stream stream{ text };
+    token_stream     tokens{ stream, context.symbols(), context.diagnostics() };
+
+    std::vector<node_ptr> statements{};
+    while (!tokens.is_eof())
+    {
+        statements.push_back(parse_expression(context, tokens));
+        tokens.match(reserved_token::semicolon);
+    }
+
+    return statements;
+}
+
+// Stand-in for a pass over the whole program: sums the number literals and counts the lvalue nodes
+f64 walk_tree(const node& n, u64& lvalues)
+{
+    f64 ret{ n.is_number() ? n.get_number() : 0.0 };
+    lvalues += n.lvalue();
+    for (const node_ptr child : n.children())
+    {
+        ret += walk_tree(*child, lvalues);
+    }
+    return ret;
+}
+
+void bench_parse(const options& opts, size_t size, std::vector<result>& results)
+{
+    const std::string text{ generate_corpus(corpus_kind::expressions, size) };
+
+    u64 nodes{ 0 };
+    {
+        compiler_context context{};
+        for (const node_ptr statement : parse_all(context, text))
+        {
+            nodes += count_nodes(*statement);
+        }
+    }
+
+    u64 allocations{ 0 };
+    f64 seconds{ measure(opts, allocations, [&] {
+        compiler_context context{};
+        parse_all(context, text);
+    }) };
+    results.push_back({ "parse", "expressions", "nodes", text.size(), nodes, seconds, allocations });
+
+    // The same pass over the pointer tree and over its post-order flat_tree
+    compiler_context            context{};
+    const std::vector<node_ptr> statements{ parse_all(context, text) };
+
+    flat_tree flat{};
+    seconds = measure(opts, allocations, [&] {
+        flat.clear();
+        for (const node_ptr statement : statements)
+        {
+            flat.append(*statement);
+        }
+    });
+    results.push_back({ "flatten", "expressions", "nodes", 0, nodes, seconds, allocations });
+
+    f64 sum{ 0.0 };
+    u64 lvalues{ 0 };
+    seconds = measure(opts, allocations, [&] {
+        for (const node_ptr statement : statements)
+        {
+            sum += walk_tree(*statement, lvalues);
+        }
+    });
+    results.push_back({ "walk_tree", "expressions", "nodes", 0, nodes, seconds, allocations });
+
+    seconds = measure(opts, allocations, [&] {
+        const std::span<const flat_kind> kinds{ flat.kinds() };
+        for (flat_index i{ 0 }; i < flat.size(); ++i)
+        {
+            sum += kinds[i] == flat_kind::number ? flat.get_number(i) : 0.0;
+            lvalues += flat.lvalue(i);
+        }
+    });
+    results.push_back({ "walk_flat", "expressions", "nodes", 0, nodes, seconds, allocations });
+
+    // Keeps the walks from being optimized away
+    if (sum == 0.0 && lvalues == 0)
+        results.back().items = 0;
+}
+
+// Declares a few names in each of depth nested scopes, every name shadowing the one outside, and resolves all of them
+// at the innermost level before leaving the scopes again
+void bench_scopes(const options& opts, u32 depth, std::vector<result>& results)
+{
+    constexpr u32 names_per_scope{ 8 };
+
+    compiler_context       context{};
+    std::vector<symbol_id> names{};
+    for (u32 i{ 0 }; i < names_per_scope; ++i)
+    {
+        names.push_back(context.symbols().intern("v" + std::to_string(i)));
+    }
+
+    u64 found{ 0 };
+    u64 allocations{ 0 };
+    const auto run = [&] {
+        for (u32 d{ 0 }; d < depth; ++d)
+        {
+            context.enter_scope();
+            for (const symbol_id name : names)
+            {
+                (void) context.create_identifier(name, type_registry::number_handle(), false);
+            }
+        }
+        for (u32 d{ 0 }; d < depth; ++d)
+        {
+            for (const symbol_id name : names)
+            {
+                found += context.find(name)->index;
+            }
+        }
+        while (context.leave_scope()) {}
+    };
+
+    run();
+    const f64 seconds{ measure(opts, allocations, run) };
+    results.push_back({ "scopes", "depth " + std::to_string(depth), "lookups", 0, (u64) depth * names_per_scope, seconds,
+                        allocations });
+
+    if (found == 0)
+        results.back().items = 0;
+}
+
+// A library of small functions of which main only calls the first, like a script that pulls in far more than it uses
+std::string generate_library(size_t size)
+{
+    std::string ret{};
+    for (u32 i{ 0 }; ret.size() < size; ++i)
+    {
+        ret += "fun number f" + std::to_string(i) + "(number a, number& b)\n{\n";
+        ret += "    number t = a * 3 + b;\n";
+        ret += "    for (number i = 0; i < a; ++i)\n    {\n";
+        ret += "        if (i % 2 == 0) t += i; else t -= b;\n    }\n";
+        ret += "    b = t;\n    return t ? t : -1;\n}\n\n";
+    }
+    ret += "fun number main()\n{\n    number b = 2;\n    return f0(10, b);\n}\n";
+    return ret;
+}
+
+// Compiles the library and runs main, with the bodies compiled on their first call or all of them up front
+void bench_script(const options& opts, size_t size, bool strict, std::vector<result>& results)
+{
+    const std::string text{ generate_library(size) };
+
+    u64        functions{ 0 };
+    u64        allocations{ 0 };
+    const auto run = [&] {
+        script scr{ source::from_view(text), { strict } };
+        virtual_machine vm{ scr.code() };
+        scr.attach(vm);
+        vm.run(0);
+        (void) vm.run(*scr.find_function("main"));
+        functions = scr.diagnostics().has_errors() ? 0 : scr.code().functions.size();
+    };
+
+    const f64 seconds{ measure(opts, allocations, run) };
+    results.push_back({ strict ? "compile_strict" : "compile_lazy", "library", "functions", text.size(), functions,
+                        seconds, allocations });
+}
+
+} // anonymous namespace
+
+void run_parser(const options& opts, std::vector<result>& results)
+{
+    for (size_t size{ opts.min_size }; size <= opts.max_size; size *= 10)
+    {
+        bench_parse(opts, size, results);
+    }
+
+    for (const u32 depth : { 4u, 64u, 1024u })
+    {
+        bench_scopes(opts, depth, results);
+    }
+
+    // Strict compiles go through every body, so the library stays smaller than the largest corpora
+    for (size_t size{ opts.min_size }; size <= std::min<size_t>(opts.max_size, 10 * 1024 * 1024); size *= 10)
+    {
+        bench_script(opts, size, false, results);
+        bench_script(opts, size, true, results);
+    }
+}
+
+} // namespace ptl::bench
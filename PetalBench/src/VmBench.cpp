@@ -0,0 +1,369 @@
+﻿//  ------------------------------------------------------------------------------
+//
+//  Petal
+//     Copyright 2023 Matthew Rogers
+//
+//     Licensed under the Apache License, Version 2.0 (the "License");
+//     you may not use this file except in compliance with the License.
+//     You may obtain a copy of the License at
+//
+//         http://www.apache.org/licenses/LICENSE-2.0
+//
+//     Unless required by applicable law or agreed to in writing, software
+//     distributed under the License is distributed on an "AS IS" BASIS,
+//     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//     See the License for the specific language governing permissions and
+//     limitations under the License.
+//
+//  File Name: VmBench.cpp
+//  Date File Created: 10/17/2026
+//  Author: Matt
+//
+//  ------------------------------------------------------------------------------
+
+#include "Bench.h"
+#include "Bytecode.h"
+#include "ModuleCache.h"
+#include "Script.h"
+#include "TokenBuffer.h"
+#include "VirtualMachine.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <filesystem>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+namespace ptl::bench
+{
+namespace
+{
+
+// The scripts are assembled by hand with code_builder, the way the compiler would lower them. Every one is function 0
+// of its program and returns a value to check
+
+// fun fib(n) { if (n < 2) return n; return fib(n - 1) + fib(n - 2); }, called as fib(n)
+program fib_program(f64 n)
+{
+    program prog{};
+    prog.functions.resize(2);
+
+    {
+        code_builder code{ prog.functions[0] };
+        const i16    callee{ code.allocate_temp() };
+        const i16    window{ code.allocate_temp() };
+        code.allocate_temp();
+
+        code.emit(opcode::load_function, callee, 1);
+        code.emit(opcode::load_number, window, code.number_constant(n));
+        code.emit(opcode::call, callee, window, 1);
+        code.emit(opcode::ret, window + 1);
+        code.finish(0);
+    }
+
+    function_code& fib{ prog.functions[1] };
+    fib.name        = "fib";
+    fib.param_count = 1;
+
+    code_builder code{ fib };
+    const i16    n_reg{ -1 };
+    const i16    condition{ code.allocate_temp() };
+
+    code.emit(opcode::load_number, condition, code.number_constant(2));
+    code.emit(opcode::lt, condition, n_reg, condition);
+    const u32 recurse{ code.emit_jump(opcode::jump_if_not, condition) };
+    code.emit(opcode::ret, n_reg);
+    code.patch_jump(recurse, code.here());
+
+    const i16 callee{ code.allocate_temp() };
+    const i16 first{ code.allocate_temp() };
+    code.allocate_temp();
+    const i16 second{ code.allocate_temp() };
+    code.allocate_temp();
+
+    code.emit(opcode::load_function, callee, 1);
+    code.emit(opcode::load_number, first, code.number_constant(1));
+    code.emit(opcode::sub, first, n_reg, first);
+    code.emit(opcode::call, callee, first, 1);
+    code.emit(opcode::load_number, second, code.number_constant(2));
+    code.emit(opcode::sub, second, n_reg, second);
+    code.emit(opcode::call, callee, second, 1);
+    code.emit(opcode::add, first + 1, first + 1, second + 1);
+    code.emit(opcode::ret, first + 1);
+    code.finish(0);
+
+    return prog;
+}
+
+// sum = 0; for (i = 0; i < n; ++i) sum += i * 2 % 7; return sum;
+program loop_program(f64 n)
+{
+    program      prog{};
+    code_builder code{ prog.functions.emplace_back() };
+
+    const i16 sum{ 1 };
+    const i16 i{ 2 };
+    const i16 limit{ 3 };
+    const i16 temp{ code.allocate_temp() };
+    const i16 other{ code.allocate_temp() };
+
+    code.emit(opcode::load_number, sum, code.number_constant(0));
+    code.emit(opcode::load_number, i, code.number_constant(0));
+    code.emit(opcode::load_number, limit, code.number_constant(n));
+
+    const u32 top{ code.here() };
+    code.emit(opcode::lt, temp, i, limit);
+    const u32 done{ code.emit_jump(opcode::jump_if_not, temp) };
+    code.emit(opcode::load_number, other, code.number_constant(2));
+    code.emit(opcode::mul, temp, i, other);
+    code.emit(opcode::load_number, other, code.number_constant(7));
+    code.emit(opcode::mod, temp, temp, other);
+    code.emit(opcode::add, sum, sum, temp);
+    code.emit(opcode::inc, i);
+    code.emit_jump_to(opcode::jump, top);
+    code.patch_jump(done, code.here());
+
+    code.emit(opcode::ret, sum);
+    code.finish(3);
+    return prog;
+}
+
+// for (i = 0; i < n; ++i) s = "item " .. i; return s;
+program string_program(f64 n)
+{
+    program      prog{};
+    code_builder code{ prog.functions.emplace_back() };
+
+    const i16 i{ 1 };
+    const i16 limit{ 2 };
+    const i16 str{ 3 };
+    const i16 temp{ code.allocate_temp() };
+    const i16 other{ code.allocate_temp() };
+
+    code.emit(opcode::load_number, i, code.number_constant(0));
+    code.emit(opcode::load_number, limit, code.number_constant(n));
+    code.emit(opcode::load_string, str, code.string_constant(""));
+
+    const u32 top{ code.here() };
+    code.emit(opcode::lt, temp, i, limit);
+    const u32 done{ code.emit_jump(opcode::jump_if_not, temp) };
+    code.emit(opcode::load_string, temp, code.string_constant("item "));
+    code.emit(opcode::to_string, other, i);
+    code.emit(opcode::concat, str, temp, other);
+    code.emit(opcode::inc, i);
+    code.emit_jump_to(opcode::jump, top);
+    code.patch_jump(done, code.here());
+
+    code.emit(opcode::ret, str);
+    code.finish(3);
+    return prog;
+}
+
+// a = number[n]; for (i = 0; i < n; ++i) a[i] = i; sum = 0; for (i = 0; i < n; ++i) sum += a[i]; return sum;
+program array_program(f64 n)
+{
+    program      prog{};
+    code_builder code{ prog.functions.emplace_back() };
+
+    const i16 arr{ 1 };
+    const i16 i{ 2 };
+    const i16 limit{ 3 };
+    const i16 sum{ 4 };
+    const i16 temp{ code.allocate_temp() };
+
+    code.emit(opcode::load_number, limit, code.number_constant(n));
+    code.emit(opcode::new_array, arr, limit, (i16) array_fill::number);
+
+    code.emit(opcode::load_number, i, code.number_constant(0));
+    const u32 fill{ code.here() };
+    code.emit(opcode::lt, temp, i, limit);
+    const u32 filled{ code.emit_jump(opcode::jump_if_not, temp) };
+    code.emit(opcode::array_set, arr, i, i);
+    code.emit(opcode::inc, i);
+    code.emit_jump_to(opcode::jump, fill);
+    code.patch_jump(filled, code.here());
+
+    code.emit(opcode::load_number, i, code.number_constant(0));
+    code.emit(opcode::load_number, sum, code.number_constant(0));
+    const u32 add{ code.here() };
+    code.emit(opcode::lt, temp, i, limit);
+    const u32 added{ code.emit_jump(opcode::jump_if_not, temp) };
+    code.emit(opcode::array_get, temp, arr, i);
+    code.emit(opcode::add, sum, sum, temp);
+    code.emit(opcode::inc, i);
+    code.emit_jump_to(opcode::jump, add);
+    code.patch_jump(added, code.here());
+
+    code.emit(opcode::ret, sum);
+    code.finish(4);
+    return prog;
+}
+
+void bench_program(const options& opts, const char* name, const program& prog, std::vector<result>& results)
+{
+    virtual_machine vm{ prog };
+
+    u64 instructions{ 0 };
+    vm.run_counted(0, {}, instructions);
+
+    u64       allocations{ 0 };
+    const f64 seconds{ measure(opts, allocations, [&] { vm.run(0); }) };
+    results.push_back({ "vm", name, "instructions", 0, instructions, seconds, allocations });
+}
+
+// A loop full of constant expressions, as scripts write them for readability
+constexpr std::string_view constants_script{ R"(
+fun number main()
+{
+    number total = 0;
+    for (number i = 0; i < 100000; i += 1 * 1)
+    {
+        total += i % (60 * 60 * 24) + (1 << 4) * 2 - 8 / 2;
+        if ("ab" .. "c" == "abc" && !(2 > 3))
+            total -= 1 + 0;
+    }
+    return total;
+}
+)" };
+
+// The script compiled with and without folding its constants, items are the instructions executed by main
+void bench_folding(const options& opts, bool fold, std::vector<result>& results)
+{
+    script scr{ source::from_view(constants_script), { .fold = fold } };
+    if (scr.diagnostics().has_errors())
+        throw std::runtime_error{ "The constants script does not compile" };
+
+    virtual_machine vm{ scr.code() };
+    scr.attach(vm);
+    vm.run(0);
+    const u32 main{ *scr.find_function("main") };
+
+    u64 instructions{ 0 };
+    vm.run_counted(main, {}, instructions);
+
+    u64       allocations{ 0 };
+    const f64 seconds{ measure(opts, allocations, [&] { vm.run(main); }) };
+    results.push_back({ "vm", fold ? "constants" : "constants_unfolded", "instructions", 0, instructions, seconds,
+                        allocations });
+}
+
+// A chain of functions, each calls the one before it, and a main that calls the last
+std::string chain_script(u32 functions)
+{
+    std::string ret{};
+    for (u32 i{ 0 }; i < functions; ++i)
+    {
+        const std::string name{ "f" + std::to_string(i) };
+        ret += "fun number " + name + "(number x)\n{\n    number y = x * 2 + " + std::to_string(i) + " * (60 * 60);\n";
+        ret += "    if (y > 1000) y -= 1000;\n    string s = \"" + name + "\" .. y;\n";
+        ret += i == 0 ? "    return y;\n}\n" : "    return f" + std::to_string(i - 1) + "(y) + x;\n}\n";
+    }
+    ret += "fun number main() { return f" + std::to_string(functions - 1) + "(1); }\n";
+    return ret;
+}
+
+// Throws unless warm, loaded from the image of cold, has the same code and the same expressions
+void check_round_trip(const script& cold, const script& warm)
+{
+    const auto fail = [](const char* what) {
+        throw std::runtime_error{ std::string{ "Script image round trip: " } + what };
+    };
+
+    const program& a{ cold.code() };
+    const program& b{ warm.code() };
+    if (a.global_count != b.global_count || a.functions.size() != b.functions.size())
+        fail("different programs");
+    for (size_t i{ 0 }; i < a.functions.size(); ++i)
+    {
+        const function_code& fa{ a.functions[i] };
+        const function_code& fb{ b.functions[i] };
+
+        // The listing covers the instructions and the constants they use, the numbers are compared bit for bit on top
+        std::ostringstream listing_a{};
+        std::ostringstream listing_b{};
+        disassemble(fa, listing_a);
+        disassemble(fb, listing_b);
+        if (listing_a.str() != listing_b.str() || !std::ranges::equal(fa.lines, fb.lines) ||
+            fa.numbers.size() != fb.numbers.size() ||
+            std::memcmp(fa.numbers.data(), fb.numbers.data(), fa.numbers.size() * sizeof(f64)) != 0)
+            fail("different code");
+    }
+
+    const flat_tree& x{ cold.tree() };
+    const flat_tree& y{ warm.tree() };
+    if (x.size() == 0 || x.size() != y.size() || !std::ranges::equal(x.roots(), y.roots()))
+        fail("different trees");
+    for (flat_index i{ 0 }; i < x.size(); ++i)
+    {
+        bool same{ x.kind(i) == y.kind(i) && x.operation(i) == y.operation(i) &&
+                   std::ranges::equal(x.children(i), y.children(i)) && x.line_number(i) == y.line_number(i) &&
+                   x.char_index(i) == y.char_index(i) && x.lvalue(i) == y.lvalue(i) &&
+                   cold.types().name(x.type_id(i)) == warm.types().name(y.type_id(i)) };
+        if (x.kind(i) == flat_kind::number)
+            same = same && std::bit_cast<u64>(x.get_number(i)) == std::bit_cast<u64>(y.get_number(i));
+        else if (x.kind(i) == flat_kind::identifier || x.kind(i) == flat_kind::string)
+            same = same && cold.symbols().name(x.get_symbol(i)) == warm.symbols().name(y.get_symbol(i));
+        if (!same)
+            fail("different trees");
+    }
+}
+
+// Compiling every body of a script against loading it from its module image, items are the functions. The image is
+// checked to give back what was stored first
+void bench_script_cache(const options& opts, std::vector<result>& results)
+{
+    const std::string     text{ chain_script(500) };
+    const compile_options compile{ .strict = true, .keep_tree = true };
+    const u64             key{ module_key(text, compile) };
+    const u32             functions{ 501 };
+
+    const module_cache cache{ std::filesystem::temp_directory_path() / "petal_bench_cache" };
+    const script       cold{ source::from_view(text), compile };
+    if (cold.diagnostics().has_errors())
+        throw std::runtime_error{ "The chain script does not compile" };
+
+    symbol_table       symbols{};
+    token_buffer       tokens{};
+    error::diagnostics diag{};
+    tokenize(text, symbols, tokens, diag);
+    const module_contents contents{ cold.image_contents(symbols, tokens) };
+    if (!contents.code || !contents.tree)
+        throw std::runtime_error{ "The chain script has no image contents" };
+    if (!cache.store(key, contents))
+        return;
+
+    const std::optional<module_image> image{ cache.open(key) };
+    check_round_trip(cold, script{ source::from_view(text), *image });
+
+    u64       allocations{ 0 };
+    const f64 compile_seconds{ measure(opts, allocations, [&] {
+        const script scr{ source::from_view(text), compile };
+    }) };
+    results.push_back({ "script_compile", "chain", "functions", text.size(), functions, compile_seconds, allocations });
+
+    const f64 load_seconds{ measure(opts, allocations, [&] {
+        const std::optional<module_image> warm{ cache.open(key) };
+        const script                      scr{ source::from_view(text), *warm };
+    }) };
+    results.push_back({ "script_image", "chain", "functions", text.size(), functions, load_seconds, allocations });
+
+    std::filesystem::remove(cache.path(key));
+}
+
+} // anonymous namespace
+
+void run_vm(const options& opts, std::vector<result>& results)
+{
+    bench_program(opts, "fib", fib_program(25), results);
+    bench_program(opts, "loop", loop_program(1000000), results);
+    bench_program(opts, "strings", string_program(100000), results);
+    bench_program(opts, "arrays", array_program(1000000), results);
+    bench_folding(opts, true, results);
+    bench_folding(opts, false, results);
+    bench_script_cache(opts, results);
+}
+
+} // namespace ptl::bench